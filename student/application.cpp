@@ -7,6 +7,7 @@
 
 #include <assert.h>
 #include <student/application.hpp>
+#include <student/trace.hpp>
 
 /**
  * @brief Constructor
@@ -50,6 +51,27 @@ void Application::setMethod(uint32_t m){
   selectedMethod = m;
 }
 
+/**
+ * @brief This function registers list of rendering methods, see registeredMethods
+ *
+ * @param methods methods with their names
+ */
+void Application::registerMethods(std::vector<RegisteredMethod> const&methods){
+  for(auto const&m:methods){
+    methodFactories.push_back(m.factory);
+    methodName.push_back(m.name);
+  }
+}
+
+/**
+ * @brief This function sets file into which chrome trace is written
+ *
+ * @param file name of the file
+ */
+void Application::setTraceFile(std::string const&file){
+  traceFile = file;
+}
+
 void Application::createMethodIfItDoesNotExist(){
   if(method)return;
   method = methodFactories[selectedMethod]();
@@ -60,6 +82,7 @@ void Application::createMethodIfItDoesNotExist(){
 }
 
 void Application::idle(){
+  TRACE_SCOPE("frame","application");
   createMethodIfItDoesNotExist();
 
   method->onUpdate(timer.elapsedFromLast());
@@ -67,6 +90,7 @@ void Application::idle(){
   auto const proj = perspectiveCamera.getProjection();
   auto const view = orbitCamera      .getView      ();
   auto const camera = glm::vec3(glm::inverse(view)*glm::vec4(0.f,0.f,0.f,1.f));
+  method->gpu.resetFrameStatistics();
   method->onDraw(proj,view,light,camera);
 
   swap();
@@ -131,14 +155,33 @@ void Application::quit      (uint32_t key){
   running = false;
 }
 
+void Application::printFrameInfo(uint32_t key){
+  if (key != SDLK_i)return;
+  if (!method)return;
+  std::cout << methodName.at(selectedMethod) << std::endl;
+  printPipelineStatistics(std::cout,method->gpu.getFrameStatistics  ());
+  printStageTimings      (std::cout,method->gpu.getFrameStageTimings());
+}
+
+void Application::dumpTrace(uint32_t key){
+  if (key != SDLK_t)return;
+  if(Trace::dumpChromeTrace(traceFile))
+    std::cout << "trace written into " << traceFile << std::endl;
+  else
+    std::cerr << "cannot write trace into " << traceFile << std::endl;
+}
+
 void Application::keyDown(SDL_Event const&event){
   auto key = event.key.keysym.sym;
-  nextMethod(key);
-  prevMethod(key);
-  quit      (key);
+  nextMethod    (key);
+  prevMethod    (key);
+  quit          (key);
+  printFrameInfo(key);
+  dumpTrace     (key);
 }
 
 void Application::swap(){
+  TRACE_SCOPE("swap","application");
   auto&gpu = method->gpu;
 
   auto frame = gpu.getFramebufferColor();
@@ -16,6 +16,7 @@
 #include <student/gpu.hpp>
 #include <student/window.hpp>
 #include <student/method.hpp>
+#include <student/methodRegistry.hpp>
 #include <student/timer.hpp>
 
 /**
@@ -27,8 +28,12 @@ class Application: protected Window{
     ~Application();
     template<typename CLASS>
     void registerMethod(std::string const&name);
+    template<typename CLASS,typename ARG,typename... ARGS>
+    void registerMethod(std::string const&name,ARG const&arg,ARGS const&...args);
+    void registerMethods(std::vector<RegisteredMethod> const&methods);
     void start();
     void setMethod(uint32_t m);
+    void setTraceFile(std::string const&file);
   private:
     void idle();
     void resize(SDL_Event const&event);
@@ -40,11 +45,11 @@ class Application: protected Window{
     void nextMethod(uint32_t key);
     void prevMethod(uint32_t key);
     void quit      (uint32_t key);
+    void printFrameInfo(uint32_t key);
+    void dumpTrace     (uint32_t key);
     void createMethodIfItDoesNotExist();
     void swap();
 
-    using MethodFactory = std::function<std::shared_ptr<Method>()>;
-
     basicCamera::OrbitCamera       orbitCamera                                  ;
     basicCamera::PerspectiveCamera perspectiveCamera                            ;
     glm::vec3                      light             = glm::vec3(10.f,10.f,10.f);
@@ -59,6 +64,7 @@ class Application: protected Window{
     float                          orbitZoomSpeed    = 0.1f                     ;
 
     Timer<float>                   timer                                        ;
+    std::string                    traceFile         = "trace.json"             ;
 
 
 };
@@ -84,3 +90,19 @@ void Application::registerMethod(std::string const&name){
   methodFactories.push_back([&](){return std::make_shared<CLASS>();});
   methodName.push_back(name);
 }
+
+/**
+ * @brief This method registers new rendering method that is constructed with arguments
+ *
+ * @tparam CLASS method class
+ * @tparam ARG type of the first constructor argument
+ * @tparam ARGS types of other constructor arguments
+ * @param name name of the method
+ * @param arg the first constructor argument, it is copied
+ * @param args other constructor arguments, they are copied
+ */
+template<typename CLASS,typename ARG,typename... ARGS>
+void Application::registerMethod(std::string const&name,ARG const&arg,ARGS const&...args){
+  methodFactories.push_back([arg,args...](){return std::make_shared<CLASS>(arg,args...);});
+  methodName.push_back(name);
+}
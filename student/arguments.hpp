@@ -31,6 +31,26 @@ class Arguments{
       method              = args->getu32   ("-m",0,"selects a rendering method");
       groundTruthFile     = args->gets     ("-g","../tests/output.bmp","specify groundTruth image");
       perfTests           = args->getu32   ("-f",10,"number of frames that are tests during performance tests");
+      traceFile           = args->gets     ("--trace","trace.json","file into which chrome trace is written (key t)");
+      runBenchmark        = args->isPresent("-b","runs benchmark of all methods over resolutions and thread counts");
+      benchFrames         = args->getu32   ("--bench-frames",10,"number of measured frames per benchmark configuration");
+      benchResolutions    = args->geti32v  ("--bench-resolutions",{500,500,1920,1080,3840,2160},"benchmarked resolutions (pairs of width and height)");
+      benchThreads        = args->geti32v  ("--bench-threads",{1},"benchmarked numbers of concurrently rendering threads");
+      benchOutput         = args->gets     ("--bench-output","","file for benchmark results (standard output if empty)");
+      benchFormat         = args->gets     ("--bench-format","json","format of benchmark results (json or csv)");
+      benchBaseline       = args->gets     ("--bench-baseline","","csv file with stored benchmark results to compare with");
+      benchThreshold      = args->getf32   ("--bench-threshold",10.f,"allowed slowdown of median frame time against baseline in percent");
+      benchTrace          = args->isPresent("--bench-trace","writes chrome trace of benchmark into file given by --trace");
+      runKernelBenchmark  = args->isPresent("-k","runs microbenchmarks of pipeline kernels (uses --bench-output, --bench-format, --bench-baseline, --bench-threshold)");
+      kernelRepetitions   = args->getu32   ("--kernel-repetitions",15,"number of measured repetitions of each kernel microbenchmark case");
+      runStressTest       = args->isPresent("--stress","runs stress test of uploading threads next to drawing thread on one GPU");
+      stressThreads       = args->getu32   ("--stress-threads",8,"number of uploading threads of stress test");
+      stressIterations    = args->getu32   ("--stress-iterations",2000,"number of iterations of each uploading thread of stress test");
+      stressFrames        = args->getu32   ("--stress-frames",500,"number of frames of drawing thread of stress test");
+      meshFile            = args->gets     ("--mesh","","mesh file, .obj or binary .ply drawn by method \"phong mesh file\" (the method is added if it is set)");
+      convertMesh         = args->gets     ("--convert-mesh","","converts mesh given by --convert-input into mesh file");
+      convertInput        = args->gets     ("--convert-input","bunny","source mesh of --convert-mesh (bunny is built-in Stanford bunny, .obj and binary .ply files are imported)");
+      convertEncode       = args->isPresent("--convert-encode","compresses streams of converted mesh by vertex and index buffer codec");
 
       auto printHelp  = args->isPresent("-h"    ,"prints help");
       printHelp |= args->isPresent("--help","prints help");
@@ -50,5 +70,25 @@ class Arguments{
   bool takeScreenShot;///< should we take a screnshot
   bool stop = false; ///< should we immediately stop
   uint32_t perfTests; ///< number of frames in performance tests
+  std::string traceFile = "trace.json";///< chrome trace file
+  bool runBenchmark;///< should we run benchmark
+  uint32_t benchFrames;///< number of measured frames per benchmark configuration
+  std::vector<int32_t>benchResolutions;///< benchmarked resolutions
+  std::vector<int32_t>benchThreads;///< benchmarked numbers of threads
+  std::string benchOutput;///< file for benchmark results
+  std::string benchFormat;///< format of benchmark results
+  std::string benchBaseline;///< file with benchmark baseline
+  float benchThreshold;///< allowed slowdown against baseline in percent
+  bool benchTrace;///< should benchmark write chrome trace
+  bool runKernelBenchmark;///< should we run kernel microbenchmarks
+  uint32_t kernelRepetitions;///< number of measured repetitions of each kernel case
+  bool runStressTest;///< should we run stress test
+  uint32_t stressThreads;///< number of uploading threads of stress test
+  uint32_t stressIterations;///< number of iterations of each uploading thread
+  uint32_t stressFrames;///< number of frames of drawing thread
+  std::string meshFile;///< mesh file drawn by mesh method
+  std::string convertMesh;///< output of mesh converter
+  std::string convertInput;///< source mesh of mesh converter
+  bool convertEncode;///< should mesh converter compress streams
 };
 
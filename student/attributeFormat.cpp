@@ -0,0 +1,263 @@
+/*!
+ * @file
+ * @brief This file contains implementation of conversions of packed vertex attribute formats.
+ */
+
+#include <student/attributeFormat.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace {
+
+/**
+ * @brief Writes the first N components of value into attribute.
+ *
+ * @tparam N number of components
+ * @param attribute attribute
+ * @param value converted value
+ */
+template<uint32_t N>
+void storeComponents(Attribute &attribute, glm::vec4 const &value){
+    float components[4] = {value.x, value.y, value.z, value.w};
+    std::memcpy((void *) &attribute, components, N * sizeof(float));
+}
+
+template<uint32_t N>
+void fetchFloat32(Attribute &attribute, uint8_t const *data){
+    std::memcpy((void *) &attribute, data, N * sizeof(float));
+}
+
+template<uint32_t N>
+void fetchHalf(Attribute &attribute, uint8_t const *data){
+    uint16_t halfs[4]{};
+    std::memcpy(halfs, data, N * sizeof(uint16_t));
+    storeComponents<N>(attribute, glm::vec4(halfToFloat(halfs[0]), halfToFloat(halfs[1]), halfToFloat(halfs[2]), halfToFloat(halfs[3])));
+}
+
+/**
+ * @brief Reads normalized integers, all four lanes are converted at once.
+ * Signed values are clamped to -1 so that both minimal integers map to -1.
+ *
+ * @tparam T integer type of component
+ * @tparam N number of components
+ */
+template<typename T, uint32_t N>
+void fetchNormalized(Attribute &attribute, uint8_t const *data){
+    T integers[4]{};
+    std::memcpy(integers, data, N * sizeof(T));
+    glm::vec4 value = glm::vec4(integers[0], integers[1], integers[2], integers[3]) * (1.f / (float) std::numeric_limits<T>::max());
+    if (std::is_signed<T>::value)
+        value = glm::max(value, glm::vec4(-1.f));
+    storeComponents<N>(attribute, value);
+}
+
+/**
+ * @brief Reads 10-10-10-2 packed word.
+ *
+ * @tparam SIGNED true for snorm, false for unorm
+ * @tparam N number of components
+ */
+template<bool SIGNED, uint32_t N>
+void fetchPacked(Attribute &attribute, uint8_t const *data){
+    uint32_t word;
+    std::memcpy(&word, data, sizeof(word));
+    glm::vec4 value;
+    if (SIGNED){
+        // shifting the field to the top and back sign-extends it
+        value = glm::vec4((int32_t) (word << 22) >> 22, (int32_t) (word << 12) >> 22, (int32_t) (word << 2) >> 22, (int32_t) word >> 30) * glm::vec4(1.f / 511.f, 1.f / 511.f, 1.f / 511.f, 1.f);
+        value = glm::max(value, glm::vec4(-1.f));
+    }
+    else
+        value = glm::vec4(word & 0x3ff, (word >> 10) & 0x3ff, (word >> 20) & 0x3ff, word >> 30) * glm::vec4(1.f / 1023.f, 1.f / 1023.f, 1.f / 1023.f, 1.f / 3.f);
+    storeComponents<N>(attribute, value);
+}
+
+template<uint32_t N>
+AttributeFetch getFetch(AttributeFormat format){
+    switch (format){
+        case AttributeFormat::FLOAT32:          return fetchFloat32<N>;
+        case AttributeFormat::HALF:             return fetchHalf<N>;
+        case AttributeFormat::SNORM8:           return fetchNormalized<int8_t, N>;
+        case AttributeFormat::UNORM8:           return fetchNormalized<uint8_t, N>;
+        case AttributeFormat::SNORM16:          return fetchNormalized<int16_t, N>;
+        case AttributeFormat::UNORM16:          return fetchNormalized<uint16_t, N>;
+        case AttributeFormat::SNORM_10_10_10_2: return fetchPacked<true, N>;
+        case AttributeFormat::UNORM_10_10_10_2: return fetchPacked<false, N>;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Converts float to normalized integer with rounding to nearest.
+ *
+ * @param value value
+ * @param maximum maximal integer (2^(bits-1)-1 for signed, 2^bits-1 for unsigned)
+ * @param isSigned true for snorm
+ *
+ * @return integer
+ */
+int32_t toNormalized(float value, float maximum, bool isSigned){
+    return (int32_t) std::lround(glm::clamp(value, isSigned ? -1.f : 0.f, 1.f) * maximum);
+}
+
+}
+
+/**
+ * @brief Returns size of one attribute in buffer.
+ *
+ * @param format storage format
+ * @param type type of attribute
+ *
+ * @return size in bytes
+ */
+uint32_t attributeSize(AttributeFormat format, AttributeType type){
+    uint32_t const nofComponents = (uint32_t) type;
+    switch (format){
+        case AttributeFormat::FLOAT32:          return nofComponents * 4;
+        case AttributeFormat::HALF:             return nofComponents * 2;
+        case AttributeFormat::SNORM8:
+        case AttributeFormat::UNORM8:           return nofComponents;
+        case AttributeFormat::SNORM16:
+        case AttributeFormat::UNORM16:          return nofComponents * 2;
+        case AttributeFormat::SNORM_10_10_10_2:
+        case AttributeFormat::UNORM_10_10_10_2: return 4;
+    }
+    return 0;
+}
+
+/**
+ * @brief Selects conversion function of attribute, vertex puller selects it once per draw.
+ *
+ * @param format storage format
+ * @param type type of attribute
+ *
+ * @return conversion function, nullptr for empty attribute
+ */
+AttributeFetch getAttributeFetch(AttributeFormat format, AttributeType type){
+    switch (type){
+        case AttributeType::FLOAT: return getFetch<1>(format);
+        case AttributeType::VEC2:  return getFetch<2>(format);
+        case AttributeType::VEC3:  return getFetch<3>(format);
+        case AttributeType::VEC4:  return getFetch<4>(format);
+        default:                   return nullptr;
+    }
+}
+
+/**
+ * @brief Converts attribute to storage format, it is used to prepare vertex buffers on cpu.
+ *
+ * @param data output, attributeSize bytes are written
+ * @param value value of attribute, components not used by type are ignored
+ * @param format storage format
+ * @param type type of attribute
+ */
+void packAttribute(uint8_t *data, glm::vec4 const &value, AttributeFormat format, AttributeType type){
+    uint32_t const nofComponents = (uint32_t) type;
+    for (uint32_t i = 0; i < nofComponents; i++){
+        switch (format){
+            case AttributeFormat::FLOAT32:{
+                float const component = value[i];
+                std::memcpy(data + 4 * i, &component, 4);
+                break;
+            }
+            case AttributeFormat::HALF:{
+                uint16_t const half = floatToHalf(value[i]);
+                std::memcpy(data + 2 * i, &half, 2);
+                break;
+            }
+            case AttributeFormat::SNORM8:{
+                data[i] = (uint8_t) (int8_t) toNormalized(value[i], 127.f, true);
+                break;
+            }
+            case AttributeFormat::UNORM8:{
+                data[i] = (uint8_t) toNormalized(value[i], 255.f, false);
+                break;
+            }
+            case AttributeFormat::SNORM16:{
+                int16_t const integer = (int16_t) toNormalized(value[i], 32767.f, true);
+                std::memcpy(data + 2 * i, &integer, 2);
+                break;
+            }
+            case AttributeFormat::UNORM16:{
+                uint16_t const integer = (uint16_t) toNormalized(value[i], 65535.f, false);
+                std::memcpy(data + 2 * i, &integer, 2);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    if (format == AttributeFormat::SNORM_10_10_10_2 or format == AttributeFormat::UNORM_10_10_10_2){
+        bool const isSigned = format == AttributeFormat::SNORM_10_10_10_2;
+        uint32_t word = 0;
+        for (uint32_t i = 0; i < 4; i++){
+            float const component = i < nofComponents ? value[i] : 0.f;
+            uint32_t const bits = i < 3 ? 10 : 2;
+            float const maximum = (float) ((1u << (bits - (isSigned ? 1 : 0))) - 1);
+            word |= ((uint32_t) toNormalized(component, maximum, isSigned) & ((1u << bits) - 1)) << (10 * i);
+        }
+        std::memcpy(data, &word, 4);
+    }
+}
+
+/**
+ * @brief Converts 16-bit float to float, denormals, infinities and NaNs are preserved.
+ *
+ * @param value 16-bit float
+ *
+ * @return float
+ */
+float halfToFloat(uint16_t value){
+    // exponent and mantissa are moved to float positions and the exponent is rebased by multiplication with 2^112,
+    // this handles normals and denormals without branches, only infinities and NaNs need fixing
+    uint32_t const magnitude = (uint32_t) (value & 0x7fff) << 13;
+    float scaled;
+    std::memcpy(&scaled, &magnitude, 4);
+    scaled *= 5.192296858534828e33f;
+    uint32_t bits;
+    std::memcpy(&bits, &scaled, 4);
+    if ((value & 0x7c00) == 0x7c00)
+        bits = 0x7f800000 | (magnitude & 0x7fffff);
+    bits |= (uint32_t) (value & 0x8000) << 16;
+    float result;
+    std::memcpy(&result, &bits, 4);
+    return result;
+}
+
+/**
+ * @brief Converts float to 16-bit float with rounding to nearest even.
+ *
+ * @param value float
+ *
+ * @return 16-bit float
+ */
+uint16_t floatToHalf(float value){
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    uint32_t const sign     = (bits >> 16) & 0x8000;
+    uint32_t const exponent = (bits >> 23) & 0xff;
+    uint32_t       mantissa = bits & 0x7fffff;
+    if (exponent == 0xff)
+        return (uint16_t) (sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+    int32_t const halfExponent = (int32_t) exponent - 127 + 15;
+    if (halfExponent >= 0x1f)
+        return (uint16_t) (sign | 0x7c00);
+    uint32_t shift = 13;
+    uint32_t half  = ((uint32_t) std::max(halfExponent, 0) << 10);
+    if (halfExponent <= 0){
+        if (halfExponent < -10)
+            return (uint16_t) sign;
+        mantissa |= 0x800000;
+        shift = (uint32_t) (14 - halfExponent);
+    }
+    half |= mantissa >> shift;
+    uint32_t const rest    = mantissa & ((1u << shift) - 1);
+    uint32_t const halfway = 1u << (shift - 1);
+    // carry from mantissa may increment exponent, overflow correctly gives infinity
+    if (rest > halfway or (rest == halfway and (half & 1)))
+        half++;
+    return (uint16_t) (sign | half);
+}
@@ -0,0 +1,20 @@
+/*!
+ * @file
+ * @brief This file contains conversions of packed vertex attribute formats.
+ */
+
+#pragma once
+
+#include <student/fwd.hpp>
+
+/**
+ * @brief Function that reads one attribute from buffer and converts it to floats.
+ * Only components given by AttributeType are written.
+ */
+using AttributeFetch = void (*)(Attribute &attribute, uint8_t const *data);
+
+uint32_t       attributeSize     (AttributeFormat format, AttributeType type);
+AttributeFetch getAttributeFetch (AttributeFormat format, AttributeType type);
+void           packAttribute     (uint8_t *data, glm::vec4 const &value, AttributeFormat format, AttributeType type);
+float          halfToFloat       (uint16_t value);
+uint16_t       floatToHalf       (float value);
@@ -0,0 +1,348 @@
+/*!
+ * @file
+ * @brief This file contains implementation of benchmark driver.
+ *
+ * Every configuration (method, resolution, number of threads) renders warm-up frames and then measured frames.
+ * GPU renders on the calling thread, so N threads means N independent method instances
+ * rendering concurrently, each into its own framebuffer.
+ * Frame times of all threads are merged before percentiles are computed and
+ * throughput of all threads is summed.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+#include <BasicCamera/OrbitCamera.h>
+#include <BasicCamera/PerspectiveCamera.h>
+
+#include <student/benchmark.hpp>
+#include <student/methodRegistry.hpp>
+#include <student/trace.hpp>
+
+namespace {
+
+/**
+ * @brief Measurements of one thread.
+ */
+struct ThreadMeasurement {
+    std::vector<double> frameTimes;  ///< frame times in milliseconds
+    double time = 0.0;               ///< time of measured frames in seconds
+    uint64_t fragments = 0;          ///< rasterized fragments of measured frames
+    uint64_t vertices = 0;           ///< fetched vertices of measured frames
+    StageTimings stages;             ///< stage timings summed over measured frames
+};
+
+/**
+ * @brief Renders frames of one method instance with the same camera as the application uses at start.
+ * @param method rendering method with created framebuffer
+ * @param settings benchmark settings
+ * @param measurement output measurements
+ */
+void renderFrames(Method &method, BenchmarkSettings const &settings, ThreadMeasurement &measurement){
+    basicCamera::OrbitCamera orbitCamera;
+    basicCamera::PerspectiveCamera perspectiveCamera;
+    orbitCamera.addDistance(1.f);
+    perspectiveCamera.setNear(0.1f);
+    perspectiveCamera.setAspect(static_cast<float>(method.gpu.getFramebufferWidth()) /
+                                static_cast<float>(method.gpu.getFramebufferHeight()));
+    auto const proj   = perspectiveCamera.getProjection();
+    auto const view   = orbitCamera.getView();
+    auto const camera = glm::vec3(glm::inverse(view) * glm::vec4(0.f, 0.f, 0.f, 1.f));
+    auto const light  = glm::vec3(10.f, 10.f, 10.f);
+    float const dt = 1.f / 60.f;
+
+    for (uint32_t i = 0; i < settings.warmupFrames + settings.frames; i++){
+        TRACE_SCOPE("frame", "benchmark");
+        Timer<double> timer;
+        method.gpu.resetFrameStatistics();
+        method.onUpdate(dt);
+        method.onDraw(proj, view, light, camera);
+        double const frameTime = timer.elapsedFromStart();
+        if (i < settings.warmupFrames)
+            continue;
+        auto const statistics = method.gpu.getFrameStatistics();
+        measurement.frameTimes.push_back(frameTime * 1000.0);
+        measurement.time += frameTime;
+        measurement.fragments += statistics.fragmentsRasterized;
+        measurement.vertices += statistics.verticesFetched;
+        measurement.stages += method.gpu.getFrameStageTimings();
+    }
+}
+
+/**
+ * @brief Computes percentile using nearest-rank method.
+ * @param sorted sorted values
+ * @param percentile percentile in range (0,100]
+ * @return value of percentile
+ */
+double percentile(std::vector<double> const &sorted, double percentile){
+    if (sorted.empty())
+        return 0.0;
+    auto rank = (size_t) std::ceil(percentile / 100.0 * (double) sorted.size());
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+/**
+ * @brief Runs one configuration.
+ * @param name name of method
+ * @param factory factory of method
+ * @param resolution framebuffer resolution
+ * @param nofThreads number of concurrently rendering threads
+ * @param settings benchmark settings
+ * @return result of configuration
+ */
+BenchmarkResult runConfiguration(std::string const &name, MethodFactory const &factory, glm::uvec2 const &resolution,
+                                 uint32_t nofThreads, BenchmarkSettings const &settings){
+    std::vector<std::shared_ptr<Method>> methods;
+    for (uint32_t t = 0; t < nofThreads; t++){
+        methods.push_back(factory());
+        methods.back()->gpu.createFramebuffer(resolution.x, resolution.y);
+    }
+
+    std::vector<ThreadMeasurement> measurements(nofThreads);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 1; t < nofThreads; t++)
+        threads.emplace_back(renderFrames, std::ref(*methods[t]), std::cref(settings), std::ref(measurements[t]));
+    renderFrames(*methods[0], settings, measurements[0]);
+    for (auto &thread : threads)
+        thread.join();
+
+    BenchmarkResult result;
+    result.method = name;
+    result.width = resolution.x;
+    result.height = resolution.y;
+    result.threads = nofThreads;
+    std::vector<double> frameTimes;
+    for (auto const &measurement : measurements){
+        frameTimes.insert(frameTimes.end(), measurement.frameTimes.begin(), measurement.frameTimes.end());
+        if (measurement.time > 0.0){
+            result.fragmentsPerSecond += (double) measurement.fragments / measurement.time;
+            result.verticesPerSecond += (double) measurement.vertices / measurement.time;
+        }
+        result.stages += measurement.stages;
+    }
+    std::sort(frameTimes.begin(), frameTimes.end());
+    result.frames = (uint32_t) frameTimes.size();
+    result.p50 = percentile(frameTimes, 50.0);
+    result.p95 = percentile(frameTimes, 95.0);
+    result.p99 = percentile(frameTimes, 99.0);
+    for (double &stage : result.stages.stages)
+        stage = result.frames > 0 ? stage / result.frames : 0.0;
+    return result;
+}
+
+/**
+ * @brief Splits one line of csv file, quoted fields may contain commas.
+ * @param line line of csv file
+ * @return fields
+ */
+std::vector<std::string> splitCsvLine(std::string const &line){
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (char c : line){
+        if (c == '"')
+            quoted = not quoted;
+        else if (c == ',' and not quoted)
+            fields.emplace_back();
+        else if (c != '\r')
+            fields.back() += c;
+    }
+    return fields;
+}
+
+/**
+ * @brief Key identifying configuration in baseline.
+ */
+using ConfigurationKey = std::tuple<std::string, uint32_t, uint32_t, uint32_t>;
+
+ConfigurationKey configurationKey(BenchmarkResult const &result){
+    return ConfigurationKey{result.method, result.width, result.height, result.threads};
+}
+
+}
+
+/**
+ * @brief Runs all configurations of benchmark, progress is written into standard error output.
+ * @param settings benchmark settings
+ * @return results of all configurations
+ */
+std::vector<BenchmarkResult> runBenchmarkConfigurations(BenchmarkSettings const &settings){
+    std::vector<BenchmarkResult> results;
+    for (auto const &method : registeredMethods(settings.meshFile))
+        for (auto const &resolution : settings.resolutions)
+            for (uint32_t nofThreads : settings.threads){
+                if (nofThreads == 0)
+                    continue;
+                std::cerr << method.name << " " << resolution.x << "x" << resolution.y
+                          << " threads: " << nofThreads << std::endl;
+                results.push_back(runConfiguration(method.name, method.factory, resolution, nofThreads, settings));
+                std::cerr << "  p50: " << results.back().p50 << " ms" << std::endl;
+                printStageTimings(std::cerr, results.back().stages);
+            }
+    return results;
+}
+
+/**
+ * @brief Writes results of benchmark in JSON format.
+ * @param stream output stream
+ * @param results results of benchmark
+ */
+void writeBenchmarkJson(std::ostream &stream, std::vector<BenchmarkResult> const &results){
+    stream << std::setprecision(6) << "{\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++){
+        auto const &result = results[i];
+        stream << (i == 0 ? "\n" : ",\n")
+               << "    {\"method\": \"" << result.method << "\", \"width\": " << result.width
+               << ", \"height\": " << result.height << ", \"threads\": " << result.threads
+               << ", \"frames\": " << result.frames
+               << ", \"frameTimeMs\": {\"p50\": " << result.p50 << ", \"p95\": " << result.p95 << ", \"p99\": " << result.p99 << "}"
+               << ", \"fragmentsPerSecond\": " << result.fragmentsPerSecond
+               << ", \"verticesPerSecond\": " << result.verticesPerSecond
+               << ", \"stagesMs\": {";
+        for (uint32_t s = 0; s < nofPipelineStages; s++)
+            stream << (s == 0 ? "" : ", ") << "\"" << pipelineStageName((PipelineStage) s) << "\": "
+                   << result.stages.stages[s] * 1000.0;
+        stream << "}}";
+    }
+    stream << "\n  ]\n}" << std::endl;
+}
+
+/**
+ * @brief Writes results of benchmark in CSV format, the output can be used as baseline.
+ * @param stream output stream
+ * @param results results of benchmark
+ */
+void writeBenchmarkCsv(std::ostream &stream, std::vector<BenchmarkResult> const &results){
+    stream << std::setprecision(6) << "method,width,height,threads,frames,p50_ms,p95_ms,p99_ms,fragments_per_s,vertices_per_s";
+    for (uint32_t s = 0; s < nofPipelineStages; s++)
+        stream << ",\"" << pipelineStageName((PipelineStage) s) << " ms\"";
+    stream << std::endl;
+    for (auto const &result : results){
+        stream << "\"" << result.method << "\"," << result.width << "," << result.height << "," << result.threads << ","
+               << result.frames << "," << result.p50 << "," << result.p95 << "," << result.p99 << ","
+               << result.fragmentsPerSecond << "," << result.verticesPerSecond;
+        for (double stage : result.stages.stages)
+            stream << "," << stage * 1000.0;
+        stream << std::endl;
+    }
+}
+
+/**
+ * @brief Reads results written by writeBenchmarkCsv.
+ * @param stream input stream
+ * @return results stored in the stream
+ * @throw std::runtime_error if a number of a line cannot be parsed
+ */
+std::vector<BenchmarkResult> readBenchmarkCsv(std::istream &stream){
+    std::vector<BenchmarkResult> results;
+    std::string line;
+    std::getline(stream, line);
+    for (uint32_t lineNumber = 2; std::getline(stream, line); lineNumber++){
+        auto const fields = splitCsvLine(line);
+        if (fields.size() < 10)
+            continue;
+        BenchmarkResult result;
+        try{
+            result.method = fields[0];
+            result.width = (uint32_t) std::stoul(fields[1]);
+            result.height = (uint32_t) std::stoul(fields[2]);
+            result.threads = (uint32_t) std::stoul(fields[3]);
+            result.frames = (uint32_t) std::stoul(fields[4]);
+            result.p50 = std::stod(fields[5]);
+            result.p95 = std::stod(fields[6]);
+            result.p99 = std::stod(fields[7]);
+            result.fragmentsPerSecond = std::stod(fields[8]);
+            result.verticesPerSecond = std::stod(fields[9]);
+            for (uint32_t s = 0; s < nofPipelineStages and 10 + s < fields.size(); s++)
+                result.stages.stages[s] = std::stod(fields[10 + s]) / 1000.0;
+        }
+        catch (std::logic_error const &){
+            // invalid_argument and out_of_range of stoul and stod
+            throw std::runtime_error("invalid number on line " + std::to_string(lineNumber) + ": " + line);
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+/**
+ * @brief Compares median frame times with baseline, regressions are written into standard error output.
+ * @param results results of benchmark
+ * @param baseline stored results
+ * @param threshold allowed slowdown in percent
+ * @return true if no configuration is slower than baseline by more than threshold
+ */
+bool compareWithBaseline(std::vector<BenchmarkResult> const &results, std::vector<BenchmarkResult> const &baseline, float threshold){
+    std::map<ConfigurationKey, BenchmarkResult> stored;
+    for (auto const &result : baseline)
+        stored[configurationKey(result)] = result;
+
+    bool passed = true;
+    for (auto const &result : results){
+        auto it = stored.find(configurationKey(result));
+        if (it == stored.end() or it->second.p50 <= 0.0)
+            continue;
+        double const change = (result.p50 / it->second.p50 - 1.0) * 100.0;
+        if (change > threshold){
+            std::cerr << "regression: " << result.method << " " << result.width << "x" << result.height
+                      << " threads: " << result.threads << " p50 " << it->second.p50 << " ms -> " << result.p50
+                      << " ms (+" << change << " %)" << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+/**
+ * @brief Runs benchmark, writes results and compares them with baseline.
+ * @param settings benchmark settings
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if results could not be written or a regression against baseline was found
+ */
+int runBenchmark(BenchmarkSettings const &settings){
+    auto const results = runBenchmarkConfigurations(settings);
+
+    std::ofstream file;
+    if (not settings.outputFile.empty()){
+        file.open(settings.outputFile);
+        if (not file.is_open()){
+            std::cerr << "cannot write benchmark results into " << settings.outputFile << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream &output = settings.outputFile.empty() ? std::cout : file;
+    if (settings.format == "csv")
+        writeBenchmarkCsv(output, results);
+    else
+        writeBenchmarkJson(output, results);
+
+    if (not settings.traceFile.empty() and not Trace::dumpChromeTrace(settings.traceFile))
+        std::cerr << "cannot write trace into " << settings.traceFile << std::endl;
+
+    if (settings.baselineFile.empty())
+        return EXIT_SUCCESS;
+    std::ifstream baselineFile(settings.baselineFile);
+    if (not baselineFile.is_open()){
+        std::cerr << "cannot read benchmark baseline " << settings.baselineFile << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<BenchmarkResult> baseline;
+    try{
+        baseline = readBenchmarkCsv(baselineFile);
+    }
+    catch (std::runtime_error const &error){
+        std::cerr << "cannot read benchmark baseline " << settings.baselineFile << ": " << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return compareWithBaseline(results, baseline, settings.threshold) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,51 @@
+/*!
+ * @file
+ * @brief This file contains benchmark driver that sweeps rendering methods over resolutions and thread counts.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <student/gpu.hpp>
+
+/**
+ * @brief Settings of benchmark.
+ */
+struct BenchmarkSettings {
+    uint32_t frames = 10;                                ///< number of measured frames per configuration
+    uint32_t warmupFrames = 2;                           ///< number of frames rendered before measurement
+    std::vector<glm::uvec2> resolutions = {{500, 500}, {1920, 1080}, {3840, 2160}}; ///< framebuffer resolutions
+    std::vector<uint32_t> threads = {1};                 ///< numbers of concurrently rendering threads
+    std::string outputFile;                              ///< file for results, empty means standard output
+    std::string format = "json";                         ///< format of results: json or csv
+    std::string baselineFile;                            ///< csv file with stored results, empty means no comparison
+    float threshold = 10.f;                              ///< allowed slowdown of median frame time in percent
+    std::string traceFile;                               ///< file for chrome trace, empty means no trace
+    std::string meshFile;                                ///< mesh file of "phong mesh file" method, empty means the method is left out
+};
+
+/**
+ * @brief Result of one benchmark configuration.
+ */
+struct BenchmarkResult {
+    std::string method;                ///< name of rendering method
+    uint32_t width = 0;                ///< framebuffer width
+    uint32_t height = 0;               ///< framebuffer height
+    uint32_t threads = 0;              ///< number of concurrently rendering threads
+    uint32_t frames = 0;               ///< number of measured frames (of all threads)
+    double p50 = 0.0;                  ///< median frame time in milliseconds
+    double p95 = 0.0;                  ///< 95th percentile of frame time in milliseconds
+    double p99 = 0.0;                  ///< 99th percentile of frame time in milliseconds
+    double fragmentsPerSecond = 0.0;   ///< rasterized fragments per second (of all threads)
+    double verticesPerSecond = 0.0;    ///< fetched vertices per second (of all threads)
+    StageTimings stages;               ///< average time of pipeline stages per frame
+};
+
+std::vector<BenchmarkResult> runBenchmarkConfigurations(BenchmarkSettings const &settings);
+void writeBenchmarkJson(std::ostream &stream, std::vector<BenchmarkResult> const &results);
+void writeBenchmarkCsv(std::ostream &stream, std::vector<BenchmarkResult> const &results);
+std::vector<BenchmarkResult> readBenchmarkCsv(std::istream &stream);
+bool compareWithBaseline(std::vector<BenchmarkResult> const &results, std::vector<BenchmarkResult> const &baseline, float threshold);
+int runBenchmark(BenchmarkSettings const &settings);
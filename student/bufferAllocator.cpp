@@ -0,0 +1,128 @@
+/*!
+ * @file
+ * @brief This file contains implementation of allocator of GPU buffer memory.
+ */
+
+#include <student/bufferAllocator.hpp>
+#include <algorithm>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+/**
+ * @brief Destructor, it returns all pool slabs to the system.
+ * Mapped buffers are returned by deallocate.
+ */
+BufferAllocator::~BufferAllocator(){
+    for (auto &pool : pools)
+        for (void *slab : pool.slabs)
+            ::operator delete(slab, std::align_val_t(bufferAlignment));
+}
+
+/**
+ * @brief Allocates storage of buffer.
+ * @param size size in bytes
+ * @return pointer aligned to bufferAlignment, nullptr if the memory cannot be allocated
+ */
+void *BufferAllocator::allocate(uint64_t size){
+    void *data = nullptr;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size <= maxPooledBlockSize){
+        uint32_t const sc = sizeClass(size);
+        Pool &pool = pools[sc];
+        if (pool.freeBlocks.empty()){
+            uint64_t const blockSize = minPooledBlockSize << sc;
+            void *slab = ::operator new(poolSlabSize, std::align_val_t(bufferAlignment), std::nothrow);
+            if (slab == nullptr)
+                return nullptr;
+            pool.slabs.push_back(slab);
+            usage.bytesReserved += poolSlabSize;
+            // blocks are pushed in reverse so that they are handed out in address order
+            for (uint64_t offset = poolSlabSize; offset >= blockSize; offset -= blockSize)
+                pool.freeBlocks.push_back((uint8_t *) slab + offset - blockSize);
+        }
+        data = pool.freeBlocks.back();
+        pool.freeBlocks.pop_back();
+    }
+    else{
+        data = mapMemory(size);
+        if (data == nullptr)
+            return nullptr;
+        usage.bytesReserved += size;
+    }
+    usage.bytesUsed += size;
+    usage.peakBytesUsed = std::max(usage.peakBytesUsed, usage.bytesUsed);
+    usage.nofBuffers++;
+    return data;
+}
+
+/**
+ * @brief Releases storage of buffer.
+ * @param data pointer returned by allocate
+ * @param size size that was passed to allocate
+ */
+void BufferAllocator::deallocate(void *data, uint64_t size){
+    if (data == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size <= maxPooledBlockSize)
+        pools[sizeClass(size)].freeBlocks.push_back(data);
+    else{
+        unmapMemory(data, size);
+        usage.bytesReserved -= size;
+    }
+    usage.bytesUsed -= size;
+    usage.nofBuffers--;
+}
+
+/**
+ * @brief Returns memory usage.
+ * @return memory usage of all allocations
+ */
+MemoryUsage BufferAllocator::getUsage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usage;
+}
+
+/**
+ * @brief Selects size class of a small buffer.
+ * @param size size in bytes (at most maxPooledBlockSize)
+ * @return index of the smallest size class whose blocks can hold size bytes
+ */
+uint32_t BufferAllocator::sizeClass(uint64_t size){
+    uint32_t sc = 0;
+    while ((minPooledBlockSize << sc) < size)
+        sc++;
+    return sc;
+}
+
+/**
+ * @brief Maps memory of a large buffer directly from the system.
+ * @param size size in bytes
+ * @return page aligned memory, nullptr on failure
+ */
+void *BufferAllocator::mapMemory(uint64_t size){
+#ifdef _WIN32
+    return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return data == MAP_FAILED ? nullptr : data;
+#endif
+}
+
+/**
+ * @brief Returns memory of a large buffer to the system.
+ * @param data memory returned by mapMemory
+ * @param size size in bytes
+ */
+void BufferAllocator::unmapMemory(void *data, uint64_t size){
+#ifdef _WIN32
+    VirtualFree(data, 0, MEM_RELEASE);
+#else
+    munmap(data, size);
+#endif
+}
@@ -0,0 +1,62 @@
+/*!
+ * @file
+ * @brief This file contains allocator of GPU buffer memory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+uint64_t const bufferAlignment    = 64;        ///< alignment of buffer storage in bytes (cache line)
+uint64_t const minPooledBlockSize = 64;        ///< block size of the smallest size class
+uint64_t const maxPooledBlockSize = 64 * 1024; ///< block size of the largest size class, bigger buffers are mapped directly
+uint64_t const poolSlabSize       = 256 * 1024;///< size of memory that a size class reserves at once
+uint32_t const nofSizeClasses     = 11;        ///< number of size classes (64 B - 64 KiB, powers of two)
+
+/**
+ * @brief Memory usage of GPU buffers.
+ */
+struct MemoryUsage {
+    uint64_t bytesUsed     = 0; ///< bytes requested by existing buffers
+    uint64_t peakBytesUsed = 0; ///< maximum of bytesUsed
+    uint64_t bytesReserved = 0; ///< bytes reserved from the system (pool slabs and mapped buffers)
+    uint64_t nofBuffers    = 0; ///< number of existing allocations
+};
+
+/**
+ * @brief Allocator of buffer storage.
+ * Small buffers are taken from pools of power-of-two blocks, large buffers are mapped
+ * directly from the system (mmap, VirtualAlloc on Windows) and returned on release.
+ * All storage is aligned to bufferAlignment bytes.
+ * The allocator can be used from multiple threads.
+ */
+class BufferAllocator {
+    public:
+        BufferAllocator() = default;
+        BufferAllocator(BufferAllocator const &) = delete;
+        BufferAllocator &operator=(BufferAllocator const &) = delete;
+        ~BufferAllocator();
+
+        void *allocate(uint64_t size);
+        void deallocate(void *data, uint64_t size);
+        MemoryUsage getUsage() const;
+
+    private:
+        static uint32_t sizeClass(uint64_t size);
+        static void *mapMemory(uint64_t size);
+        static void unmapMemory(void *data, uint64_t size);
+
+        /**
+         * @brief Pool of equally sized blocks.
+         */
+        struct Pool {
+            std::vector<void *> freeBlocks; ///< blocks that can be reused
+            std::vector<void *> slabs;      ///< memory reserved by the pool
+        };
+
+        mutable std::mutex mutex;
+        Pool pools[nofSizeClasses];
+        MemoryUsage usage;
+};
@@ -0,0 +1,375 @@
+/*!
+ * @file
+ * @brief This file contains implementation of compression codec of vertex and index buffers.
+ *
+ * Encoded vertex buffer:
+ * header (nofVertices, vertexSize, blockVertices), offsets of blocks (nofBlocks + 1 entries) and blocks.
+ * Block stores every byte of vertex as a column, the column is split into groups of 16 vertices,
+ * 2-bit codes of groups (0, 2, 4 or 8 bits per value) precede packed zigzag deltas.
+ *
+ * Encoded index buffer:
+ * header (nofIndices), offsets of blocks (nofBlocks + 1 entries) and blocks of indexBlockSize indices,
+ * every index is zigzag delta from the previous index written as LEB128 varint.
+ *
+ * All values are little endian.
+ */
+
+#include <student/bufferCodec.hpp>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+uint32_t const groupSize      = 16;   ///< number of vertices in group sharing bit width
+uint32_t const blockBytes     = 8192; ///< target size of decoded vertex block
+uint32_t const indexBlockSize = 1024; ///< number of indices in index block
+uint32_t const groupBytes[4]  = {0, 4, 8, 16};
+
+void writeUint32(std::vector<uint8_t> &out, uint32_t value){
+    for (uint32_t i = 0; i < 4; i++)
+        out.push_back((uint8_t) (value >> (8 * i)));
+}
+
+uint32_t readUint32(uint8_t const *data){
+    return (uint32_t) data[0] | (uint32_t) data[1] << 8 | (uint32_t) data[2] << 16 | (uint32_t) data[3] << 24;
+}
+
+void patchUint32(std::vector<uint8_t> &out, size_t position, uint32_t value){
+    for (uint32_t i = 0; i < 4; i++)
+        out[position + i] = (uint8_t) (value >> (8 * i));
+}
+
+[[noreturn]] void corrupted(){
+    throw std::range_error("Encoded buffer is corrupted.");
+}
+
+uint8_t zigzag8(uint8_t delta){
+    return (uint8_t) ((delta << 1) ^ (uint8_t) ((int8_t) delta >> 7));
+}
+
+uint32_t zigzag32(uint32_t delta){
+    return (delta << 1) ^ (uint32_t) ((int32_t) delta >> 31);
+}
+
+uint32_t unzigzag32(uint32_t value){
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+/**
+ * @brief Header of encoded vertex buffer, it is validated when it is read.
+ */
+struct VertexHeader{
+    uint32_t nofVertices;
+    uint32_t vertexSize;
+    uint32_t blockVertices;
+    uint32_t nofBlocks;
+    uint8_t const *offsets;
+    uint64_t size;
+};
+
+VertexHeader readVertexHeader(uint8_t const *data, uint64_t size){
+    if (size < 12)
+        corrupted();
+    VertexHeader header{readUint32(data), readUint32(data + 4), readUint32(data + 8), 0, data + 12, size};
+    if (header.vertexSize == 0 or header.blockVertices == 0 or header.blockVertices % groupSize != 0)
+        corrupted();
+    header.nofBlocks = (uint32_t) (((uint64_t) header.nofVertices + header.blockVertices - 1) / header.blockVertices);
+    if (12 + 4 * ((uint64_t) header.nofBlocks + 1) > size or readUint32(header.offsets + 4 * header.nofBlocks) > size)
+        corrupted();
+    return header;
+}
+
+uint32_t blockVerticesFor(uint32_t vertexSize){
+    return std::min(std::max(blockBytes / vertexSize / groupSize * groupSize, groupSize), 256u);
+}
+
+/**
+ * @brief Encodes one block, columns are delta coded from the first vertex of the block.
+ */
+void encodeVertexBlock(std::vector<uint8_t> &out, uint8_t const *vertices, uint32_t nofVertices, uint32_t vertexSize){
+    uint32_t const nofGroups = (nofVertices + groupSize - 1) / groupSize;
+    std::vector<uint8_t> deltas(nofGroups * groupSize);
+    for (uint32_t k = 0; k < vertexSize; k++){
+        uint8_t last = 0;
+        std::fill(deltas.begin(), deltas.end(), 0);
+        for (uint32_t i = 0; i < nofVertices; i++){
+            uint8_t const value = vertices[(size_t) i * vertexSize + k];
+            deltas[i] = zigzag8((uint8_t) (value - last));
+            last = value;
+        }
+        size_t const codes = out.size();
+        out.resize(out.size() + (nofGroups + 3) / 4, 0);
+        for (uint32_t g = 0; g < nofGroups; g++){
+            uint8_t const *group = deltas.data() + g * groupSize;
+            uint8_t const maximum = *std::max_element(group, group + groupSize);
+            uint32_t const code = maximum == 0 ? 0 : maximum < 4 ? 1 : maximum < 16 ? 2 : 3;
+            out[codes + g / 4] |= (uint8_t) (code << (6 - 2 * (g % 4)));
+            uint32_t const bits = code == 3 ? 8 : 2 * code;
+            uint32_t const perByte = code == 0 ? 0 : 8 / bits;
+            for (uint32_t b = 0; b < groupBytes[code]; b++){
+                uint8_t packed = 0;
+                for (uint32_t j = 0; j < perByte; j++)
+                    packed |= (uint8_t) (group[b * perByte + j] << (8 - bits * (j + 1)));
+                out.push_back(packed);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Decodes one group of 16 values of a column.
+ * Values are unpacked, converted from zigzag and prefix summed.
+ *
+ * @param values output values
+ * @param packed packed zigzag deltas
+ * @param code bit width code of group
+ * @param last value preceding the group
+ */
+void decodeGroup(uint8_t *values, uint8_t const *packed, uint32_t code, uint8_t last){
+#ifdef __SSE2__
+    __m128i deltas = _mm_setzero_si128();
+    if (code == 3)
+        deltas = _mm_loadu_si128((__m128i const *) packed);
+    else if (code == 2){
+        __m128i const bytes = _mm_loadl_epi64((__m128i const *) packed);
+        __m128i const mask  = _mm_set1_epi8(0x0f);
+        deltas = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask), _mm_and_si128(bytes, mask));
+    }
+    else if (code == 1){
+        int32_t word;
+        std::memcpy(&word, packed, 4);
+        __m128i const bytes = _mm_cvtsi32_si128(word);
+        __m128i const mask  = _mm_set1_epi8(0x03);
+        __m128i const high = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(bytes, 6), mask), _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+        __m128i const low  = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(bytes, 2), mask), _mm_and_si128(bytes, mask));
+        deltas = _mm_unpacklo_epi16(high, low);
+    }
+    // (x >> 1) ^ -(x & 1), there is no 8-bit shift so the bit moved from the neighbour byte is masked out
+    __m128i const halves = _mm_and_si128(_mm_srli_epi16(deltas, 1), _mm_set1_epi8(0x7f));
+    deltas = _mm_xor_si128(halves, _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(deltas, _mm_set1_epi8(1))));
+    deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 1));
+    deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 2));
+    deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 4));
+    deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 8));
+    _mm_storeu_si128((__m128i *) values, _mm_add_epi8(deltas, _mm_set1_epi8((char) last)));
+#else
+    uint32_t const bits = code == 3 ? 8 : 2 * code;
+    for (uint32_t i = 0; i < groupSize; i++){
+        uint8_t delta = 0;
+        if (code != 0){
+            uint32_t const perByte = 8 / bits;
+            delta = (uint8_t) ((packed[i / perByte] >> (8 - bits * (i % perByte + 1))) & ((1u << bits) - 1));
+        }
+        last = (uint8_t) (last + ((delta >> 1) ^ (uint8_t) (0u - (delta & 1))));
+        values[i] = last;
+    }
+#endif
+}
+
+void decodeVertexBlock(uint8_t *vertices, uint8_t const *data, uint8_t const *end, uint32_t nofVertices, uint32_t vertexSize){
+    uint32_t const nofGroups = (nofVertices + groupSize - 1) / groupSize;
+    alignas(16) uint8_t values[groupSize];
+    for (uint32_t k = 0; k < vertexSize; k++){
+        uint8_t const *codes = data;
+        data += (nofGroups + 3) / 4;
+        if (data > end)
+            corrupted();
+        uint8_t last = 0;
+        for (uint32_t g = 0; g < nofGroups; g++){
+            uint32_t const code = (codes[g / 4] >> (6 - 2 * (g % 4))) & 3;
+            if (data + groupBytes[code] > end)
+                corrupted();
+            decodeGroup(values, data, code, last);
+            data += groupBytes[code];
+            last = values[groupSize - 1];
+            uint32_t const count = std::min(groupSize, nofVertices - g * groupSize);
+            uint8_t *column = vertices + (size_t) g * groupSize * vertexSize + k;
+            for (uint32_t i = 0; i < count; i++)
+                column[(size_t) i * vertexSize] = values[i];
+        }
+    }
+}
+
+void decodeBlock(uint8_t *vertices, VertexHeader const &header, uint8_t const *data, uint32_t block){
+    uint32_t const begin = readUint32(header.offsets + 4 * block);
+    uint32_t const end   = readUint32(header.offsets + 4 * (block + 1));
+    if (begin > end or end > header.size)
+        corrupted();
+    uint32_t const nofVertices = std::min(header.blockVertices, header.nofVertices - block * header.blockVertices);
+    decodeVertexBlock(vertices, data + begin, data + end, nofVertices, header.vertexSize);
+}
+
+}
+
+/**
+ * @brief Encodes vertex buffer.
+ *
+ * @param vertices interleaved vertices
+ * @param nofVertices number of vertices
+ * @param vertexSize size of one vertex in bytes
+ *
+ * @return encoded buffer
+ */
+std::vector<uint8_t> encodeVertexBuffer(void const *vertices, uint32_t nofVertices, uint32_t vertexSize){
+    if (vertexSize == 0)
+        throw std::range_error("Parameter vertexSize has invalid value.");
+    uint32_t const blockVertices = blockVerticesFor(vertexSize);
+    uint32_t const nofBlocks = (uint32_t) (((uint64_t) nofVertices + blockVertices - 1) / blockVertices);
+    std::vector<uint8_t> out;
+    writeUint32(out, nofVertices);
+    writeUint32(out, vertexSize);
+    writeUint32(out, blockVertices);
+    size_t const offsets = out.size();
+    out.resize(out.size() + 4 * ((size_t) nofBlocks + 1));
+    for (uint32_t b = 0; b < nofBlocks; b++){
+        patchUint32(out, offsets + 4 * b, (uint32_t) out.size());
+        uint32_t const first = b * blockVertices;
+        encodeVertexBlock(out, (uint8_t const *) vertices + (size_t) first * vertexSize, std::min(blockVertices, nofVertices - first), vertexSize);
+    }
+    patchUint32(out, offsets + 4 * nofBlocks, (uint32_t) out.size());
+    return out;
+}
+
+/**
+ * @brief Encodes index buffer.
+ *
+ * @param indices indices
+ * @param nofIndices number of indices
+ *
+ * @return encoded buffer
+ */
+std::vector<uint8_t> encodeIndexBuffer(uint32_t const *indices, uint32_t nofIndices){
+    uint32_t const nofBlocks = (nofIndices + indexBlockSize - 1) / indexBlockSize;
+    std::vector<uint8_t> out;
+    writeUint32(out, nofIndices);
+    size_t const offsets = out.size();
+    out.resize(out.size() + 4 * ((size_t) nofBlocks + 1));
+    for (uint32_t b = 0; b < nofBlocks; b++){
+        patchUint32(out, offsets + 4 * b, (uint32_t) out.size());
+        uint32_t last = 0;
+        for (uint32_t i = b * indexBlockSize; i < std::min(nofIndices, (b + 1) * indexBlockSize); i++){
+            uint32_t value = zigzag32(indices[i] - last);
+            last = indices[i];
+            while (value >= 0x80){
+                out.push_back((uint8_t) (value | 0x80));
+                value >>= 7;
+            }
+            out.push_back((uint8_t) value);
+        }
+    }
+    patchUint32(out, offsets + 4 * nofBlocks, (uint32_t) out.size());
+    return out;
+}
+
+/**
+ * @brief Decodes whole vertex buffer.
+ *
+ * @param vertices output, encodedVertexCount * encodedVertexSize bytes are written
+ * @param data encoded buffer
+ * @param size size of encoded buffer
+ */
+void decodeVertexBuffer(void *vertices, uint8_t const *data, uint64_t size){
+    VertexHeader const header = readVertexHeader(data, size);
+    for (uint32_t b = 0; b < header.nofBlocks; b++)
+        decodeBlock((uint8_t *) vertices + (size_t) b * header.blockVertices * header.vertexSize, header, data, b);
+}
+
+/**
+ * @brief Decodes range of index buffer, only blocks overlapping the range are decoded.
+ *
+ * @param indices output indices
+ * @param data encoded buffer
+ * @param size size of encoded buffer
+ * @param firstIndex first decoded index
+ * @param nofIndices number of decoded indices
+ */
+void decodeIndexRange(uint32_t *indices, uint8_t const *data, uint64_t size, uint32_t firstIndex, uint32_t nofIndices){
+    uint32_t const total = encodedIndexCount(data, size);
+    if ((uint64_t) firstIndex + nofIndices > total)
+        throw std::range_error("Range of indices is out of encoded buffer.");
+    uint32_t const nofBlocks = (total + indexBlockSize - 1) / indexBlockSize;
+    if (4 + 4 * ((uint64_t) nofBlocks + 1) > size or readUint32(data + 4 + 4 * nofBlocks) > size)
+        corrupted();
+    uint32_t const lastIndex = firstIndex + nofIndices;
+    for (uint32_t b = firstIndex / indexBlockSize; b * indexBlockSize < lastIndex; b++){
+        uint32_t const begin = readUint32(data + 4 + 4 * b);
+        uint32_t const blockEnd = readUint32(data + 4 + 4 * (b + 1));
+        if (begin > blockEnd or blockEnd > size)
+            corrupted();
+        uint8_t const *in  = data + begin;
+        uint8_t const *end = data + blockEnd;
+        uint32_t last = 0;
+        for (uint32_t i = b * indexBlockSize; i < std::min(lastIndex, (b + 1) * indexBlockSize); i++){
+            uint32_t value = 0;
+            for (uint32_t shift = 0; ; shift += 7){
+                if (in >= end or shift > 28)
+                    corrupted();
+                uint8_t const byte = *in++;
+                value |= (uint32_t) (byte & 0x7f) << shift;
+                if (byte < 0x80)
+                    break;
+            }
+            last += unzigzag32(value);
+            if (i >= firstIndex)
+                indices[i - firstIndex] = last;
+        }
+    }
+}
+
+uint32_t encodedVertexCount(uint8_t const *data, uint64_t size){
+    return readVertexHeader(data, size).nofVertices;
+}
+
+uint32_t encodedVertexSize(uint8_t const *data, uint64_t size){
+    return readVertexHeader(data, size).vertexSize;
+}
+
+uint32_t encodedIndexCount(uint8_t const *data, uint64_t size){
+    if (size < 4)
+        corrupted();
+    return readUint32(data);
+}
+
+/**
+ * @brief Constructor of decoder, the header is validated.
+ *
+ * @param data encoded vertex buffer
+ * @param size size of encoded buffer
+ */
+VertexBlockCache::VertexBlockCache(uint8_t const *data, uint64_t size):data(data), size(size){
+    VertexHeader const header = readVertexHeader(data, size);
+    vertexSize = header.vertexSize;
+    nofVertices = header.nofVertices;
+    blockVertices = header.blockVertices;
+    slotData.resize((size_t) nofSlots * blockVertices * vertexSize);
+    std::fill(slotBlock, slotBlock + nofSlots, 0xffffffffu);
+}
+
+/**
+ * @brief Returns decoded vertex, its block is decoded if it is not cached.
+ * The pointer is valid until nofSlots other blocks are decoded.
+ *
+ * @param index index of vertex
+ *
+ * @return pointer to vertexSize bytes of vertex
+ */
+uint8_t const *VertexBlockCache::vertex(uint32_t index){
+    if (index >= nofVertices)
+        throw std::range_error("Vertex is out of encoded buffer.");
+    uint32_t const block = index / blockVertices;
+    uint32_t const inBlock = index % blockVertices;
+    for (uint32_t s = 0; s < nofSlots; s++)
+        if (slotBlock[s] == block)
+            return slotData.data() + ((size_t) s * blockVertices + inBlock) * vertexSize;
+    uint32_t const slot = nextSlot;
+    nextSlot = (nextSlot + 1) % nofSlots;
+    uint8_t *vertices = slotData.data() + (size_t) slot * blockVertices * vertexSize;
+    decodeBlock(vertices, readVertexHeader(data, size), data, block);
+    slotBlock[slot] = block;
+    return vertices + (size_t) inBlock * vertexSize;
+}
@@ -0,0 +1,50 @@
+/*!
+ * @file
+ * @brief This file contains compression codec of vertex and index buffers.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Encodes vertex buffer.
+ * Vertices are split into blocks that are decoded independently,
+ * each byte of vertex is stored as zigzag delta from the previous vertex packed to 0, 2, 4 or 8 bits per group of 16 vertices.
+ */
+std::vector<uint8_t> encodeVertexBuffer(void const *vertices, uint32_t nofVertices, uint32_t vertexSize);
+
+/**
+ * @brief Encodes 32-bit index buffer.
+ * Indices are split into blocks that are decoded independently,
+ * each index is stored as zigzag delta from the previous index in variable number of bytes.
+ */
+std::vector<uint8_t> encodeIndexBuffer(uint32_t const *indices, uint32_t nofIndices);
+
+void decodeVertexBuffer(void *vertices, uint8_t const *data, uint64_t size);
+void decodeIndexRange  (uint32_t *indices, uint8_t const *data, uint64_t size, uint32_t firstIndex, uint32_t nofIndices);
+
+uint32_t encodedVertexCount(uint8_t const *data, uint64_t size);
+uint32_t encodedVertexSize (uint8_t const *data, uint64_t size);
+uint32_t encodedIndexCount (uint8_t const *data, uint64_t size);
+
+/**
+ * @brief Decoder of encoded vertex buffer used by vertex puller.
+ * It keeps a few recently decoded blocks, one block is small enough to stay in cache.
+ */
+class VertexBlockCache{
+    public:
+        VertexBlockCache(uint8_t const *data, uint64_t size);
+        uint8_t const *vertex(uint32_t index);
+        uint32_t vertexSize = 0;
+        uint32_t nofVertices = 0;
+    private:
+        static uint32_t const nofSlots = 4;
+        uint8_t const *data;
+        uint64_t size;
+        uint32_t blockVertices = 0;
+        std::vector<uint8_t> slotData;
+        uint32_t slotBlock[nofSlots];
+        uint32_t nextSlot = 0;
+};
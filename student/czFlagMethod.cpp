@@ -74,15 +74,16 @@ CZFlagMethod::CZFlagMethod(){
 
   std::vector<uint32_t>indices;
 
-  for(uint32_t y=0;y<NY-1;++y)
-    for(uint32_t x=0;x<NX-1;++x){
-      indices.push_back((y+0)*NX+(x+0));
-      indices.push_back((y+0)*NX+(x+1));
-      indices.push_back((y+1)*NX+(x+0));
-      indices.push_back((y+1)*NX+(x+0));
-      indices.push_back((y+0)*NX+(x+1));
-      indices.push_back((y+1)*NX+(x+1));
+  // one triangle strip per row of quads, rows are separated by primitive restart index
+  for(uint32_t y=0;y<NY-1;++y){
+    if(y>0)
+      indices.push_back(0xffffffff);
+    for(uint32_t x=0;x<NX;++x){
+      indices.push_back((y+0)*NX+x);
+      indices.push_back((y+1)*NX+x);
     }
+  }
+  nofIndices = static_cast<uint32_t>(indices.size());
 
   auto const indicesSize = sizeof(decltype(indices)::value_type)*indices.size();
   ebo = gpu.createBuffer(indicesSize);
@@ -122,7 +123,11 @@ void CZFlagMethod::onDraw(glm::mat4 const&proj,glm::mat4 const&view,glm::vec3 co
   gpu.programUniformMatrix4f(prg,0,mvp);
   gpu.programUniform1f      (prg,1,time);
 
-  gpu.drawTriangles((NX-1)*(NY-1)*6);
+  gpu.setTopology(Topology::TRIANGLE_STRIP);
+  gpu.enablePrimitiveRestart();
+  gpu.drawTriangles(nofIndices);
+  gpu.disablePrimitiveRestart();
+  gpu.setTopology(Topology::TRIANGLES);
 
   gpu.unbindVertexPuller();
 }
@@ -22,6 +22,7 @@ class CZFlagMethod: public Method{
     VertexPullerID vao;///< id of vertex puller
     BufferID vbo;///< vertex buffer
     BufferID ebo;///< index buffer
+    uint32_t nofIndices = 0;///< number of indices (triangle strips with restart indices)
     float time = 0.f;///< elapsed time
     uint32_t const NX = 100 ;///< nof vertices in x direction
     uint32_t const NY = 10 ;///< nof vertices in y direction
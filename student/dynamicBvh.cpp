@@ -0,0 +1,353 @@
+/*!
+ * @file
+ * @brief This file contains implementation of dynamic bounding volume hierarchy.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <student/dynamicBvh.hpp>
+
+/**
+ * @brief Computes box that contains transformed box (Arvo).
+ *
+ * @param box box
+ * @param transform affine transformation
+ *
+ * @return box of transformed box
+ */
+Aabb transformAabb(Aabb const &box, glm::mat4 const &transform){
+    Aabb result;
+    result.min = result.max = glm::vec3(transform[3]);
+    for (uint32_t column = 0; column < 3; column++){
+        glm::vec3 const a = glm::vec3(transform[column]) * box.min[column];
+        glm::vec3 const b = glm::vec3(transform[column]) * box.max[column];
+        result.min += glm::min(a, b);
+        result.max += glm::max(a, b);
+    }
+    return result;
+}
+
+/**
+ * @brief Computes box that contains both boxes.
+ */
+Aabb mergeAabb(Aabb const &a, Aabb const &b){
+    return Aabb{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+/**
+ * @brief Computes half of the surface area of box, it is the cost of box in surface area heuristic.
+ */
+float aabbArea(Aabb const &box){
+    glm::vec3 const size = box.max - box.min;
+    return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+/**
+ * @brief Tests if inner box lies in outer box.
+ */
+bool containsAabb(Aabb const &outer, Aabb const &inner){
+    for (uint32_t k = 0; k < 3; k++)
+        if (inner.min[k] < outer.min[k] or inner.max[k] > outer.max[k])
+            return false;
+    return true;
+}
+
+/**
+ * @brief Inserts leaf into tree.
+ *
+ * @param box box of object, the leaf stores it enlarged by margin
+ * @param userData value returned by traversals (e.g. id of object)
+ *
+ * @return id of leaf
+ */
+uint32_t DynamicBvh::insert(Aabb const &box, uint32_t userData){
+    uint32_t const leaf = allocateNode();
+    glm::vec3 const fat = (box.max - box.min) * margin;
+    nodes[leaf].box = Aabb{box.min - fat, box.max + fat};
+    nodes[leaf].userData = userData;
+    nodes[leaf].height = 0;
+    insertLeaf(leaf);
+    nofLeaves++;
+    return leaf;
+}
+
+/**
+ * @brief Removes leaf from tree.
+ *
+ * @param leaf id of leaf
+ */
+void DynamicBvh::remove(uint32_t leaf){
+    if (leaf >= nodes.size() or nodes[leaf].height != 0 or not nodes[leaf].isLeaf())
+        throw std::range_error("Node of bounding volume hierarchy is not a leaf.");
+    removeLeaf(leaf);
+    freeNode(leaf);
+    nofLeaves--;
+}
+
+/**
+ * @brief Updates box of leaf, the tree changes only if the box leaves the fattened box of leaf.
+ *
+ * @param leaf id of leaf, it stays the same
+ * @param box new box of object
+ *
+ * @return true if the leaf was reinserted
+ */
+bool DynamicBvh::update(uint32_t leaf, Aabb const &box){
+    if (leaf >= nodes.size() or nodes[leaf].height != 0 or not nodes[leaf].isLeaf())
+        throw std::range_error("Node of bounding volume hierarchy is not a leaf.");
+    if (containsAabb(nodes[leaf].box, box))
+        return false;
+    removeLeaf(leaf);
+    glm::vec3 const fat = (box.max - box.min) * margin;
+    nodes[leaf].box = Aabb{box.min - fat, box.max + fat};
+    insertLeaf(leaf);
+    return true;
+}
+
+/**
+ * @brief Collects leaves whose boxes intersect frustum.
+ * A node that lies inside of a plane does not test the plane in its subtree.
+ *
+ * @param planes planes of frustum, points inside have dot(plane.xyz, point) + plane.w >= 0
+ * @param nofPlanes number of planes (at most 32)
+ * @param visible user data of visible leaves are appended to it
+ *
+ * @return number of visited nodes
+ */
+uint32_t DynamicBvh::cullFrustum(glm::vec4 const *planes, uint32_t nofPlanes, std::vector<uint32_t> &visible) const{
+    if (root == emptyID)
+        return 0;
+    // node and mask of planes that still have to be tested
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.reserve(2 * (size_t) nodes[root].height + 2);
+    stack.emplace_back(root, nofPlanes >= 32 ? 0xffffffffu : (1u << nofPlanes) - 1u);
+    uint32_t nofVisited = 0;
+    while (not stack.empty()){
+        uint32_t const index = stack.back().first;
+        uint32_t mask = stack.back().second;
+        stack.pop_back();
+        nofVisited++;
+        Node const &node = nodes[index];
+        bool outside = false;
+        for (uint32_t p = 0; p < nofPlanes and not outside; p++){
+            if (not (mask & (1u << p)))
+                continue;
+            glm::vec3 const normal(planes[p]);
+            // corners of box farthest along and against the normal of plane
+            glm::vec3 const positive(normal[0] >= 0.f ? node.box.max[0] : node.box.min[0],
+                                     normal[1] >= 0.f ? node.box.max[1] : node.box.min[1],
+                                     normal[2] >= 0.f ? node.box.max[2] : node.box.min[2]);
+            glm::vec3 const negative(normal[0] >= 0.f ? node.box.min[0] : node.box.max[0],
+                                     normal[1] >= 0.f ? node.box.min[1] : node.box.max[1],
+                                     normal[2] >= 0.f ? node.box.min[2] : node.box.max[2]);
+            if (glm::dot(normal, positive) + planes[p][3] < 0.f)
+                outside = true;
+            else if (glm::dot(normal, negative) + planes[p][3] >= 0.f)
+                mask &= ~(1u << p);
+        }
+        if (outside)
+            continue;
+        if (node.isLeaf())
+            visible.push_back(node.userData);
+        else{
+            stack.emplace_back(node.child[1], mask);
+            stack.emplace_back(node.child[0], mask);
+        }
+    }
+    return nofVisited;
+}
+
+/**
+ * @brief Removes all nodes.
+ */
+void DynamicBvh::clear(){
+    nodes.clear();
+    root = freeList = emptyID;
+    nofLeaves = 0;
+}
+
+/**
+ * @brief Returns user data of leaf.
+ */
+uint32_t DynamicBvh::getUserData(uint32_t leaf) const{
+    return nodes.at(leaf).userData;
+}
+
+/**
+ * @brief Returns fattened box stored in leaf.
+ */
+Aabb DynamicBvh::getFatAabb(uint32_t leaf) const{
+    return nodes.at(leaf).box;
+}
+
+/**
+ * @brief Returns height of tree, 0 for single leaf or empty tree.
+ */
+uint32_t DynamicBvh::getHeight() const{
+    return root == emptyID ? 0 : (uint32_t) nodes[root].height;
+}
+
+/**
+ * @brief Returns number of leaves.
+ */
+uint32_t DynamicBvh::getNofLeaves() const{
+    return nofLeaves;
+}
+
+/**
+ * @brief Takes node from the list of free nodes or appends a new one.
+ */
+uint32_t DynamicBvh::allocateNode(){
+    if (freeList == emptyID){
+        nodes.emplace_back();
+        return (uint32_t) nodes.size() - 1;
+    }
+    uint32_t const node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node] = Node{};
+    return node;
+}
+
+/**
+ * @brief Returns node into the list of free nodes.
+ */
+void DynamicBvh::freeNode(uint32_t node){
+    nodes[node] = Node{};
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+/**
+ * @brief Links leaf as a sibling of the node that increases surface area of tree the least.
+ *
+ * @param leaf leaf with box
+ */
+void DynamicBvh::insertLeaf(uint32_t leaf){
+    if (root == emptyID){
+        root = leaf;
+        nodes[leaf].parent = emptyID;
+        return;
+    }
+    Aabb const box = nodes[leaf].box;
+    uint32_t index = root;
+    while (not nodes[index].isLeaf()){
+        float const area = aabbArea(nodes[index].box);
+        float const combinedArea = aabbArea(mergeAabb(nodes[index].box, box));
+        // cost of a new parent of this node and leaf
+        float const cost = 2.f * combinedArea;
+        // cost added to ancestors if leaf descends to a child
+        float const inheritance = 2.f * (combinedArea - area);
+        float childCost[2];
+        for (uint32_t c = 0; c < 2; c++){
+            Node const &child = nodes[nodes[index].child[c]];
+            float const merged = aabbArea(mergeAabb(child.box, box));
+            childCost[c] = (child.isLeaf() ? merged : merged - aabbArea(child.box)) + inheritance;
+        }
+        if (cost < childCost[0] and cost < childCost[1])
+            break;
+        index = nodes[index].child[childCost[0] <= childCost[1] ? 0 : 1];
+    }
+
+    uint32_t const sibling = index;
+    uint32_t const oldParent = nodes[sibling].parent;
+    uint32_t const newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = mergeAabb(box, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child[0] = sibling;
+    nodes[newParent].child[1] = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    if (oldParent == emptyID)
+        root = newParent;
+    else
+        nodes[oldParent].child[nodes[oldParent].child[0] == sibling ? 0 : 1] = newParent;
+
+    refit(nodes[leaf].parent);
+}
+
+/**
+ * @brief Unlinks leaf from tree, its sibling replaces their parent.
+ *
+ * @param leaf leaf in tree
+ */
+void DynamicBvh::removeLeaf(uint32_t leaf){
+    if (leaf == root){
+        root = emptyID;
+        return;
+    }
+    uint32_t const parent = nodes[leaf].parent;
+    uint32_t const grandParent = nodes[parent].parent;
+    uint32_t const sibling = nodes[parent].child[nodes[parent].child[0] == leaf ? 1 : 0];
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    if (grandParent == emptyID){
+        root = sibling;
+        return;
+    }
+    nodes[grandParent].child[nodes[grandParent].child[0] == parent ? 0 : 1] = sibling;
+    refit(grandParent);
+}
+
+/**
+ * @brief Balances and recomputes boxes and heights from node up to the root.
+ *
+ * @param node first inner node
+ */
+void DynamicBvh::refit(uint32_t node){
+    for (uint32_t index = node; index != emptyID; index = nodes[index].parent){
+        index = balance(index);
+        Node &inner = nodes[index];
+        Node const &a = nodes[inner.child[0]];
+        Node const &b = nodes[inner.child[1]];
+        inner.box = mergeAabb(a.box, b.box);
+        inner.height = 1 + std::max(a.height, b.height);
+    }
+}
+
+/**
+ * @brief Rotates the higher child up if heights of children differ by more than one.
+ *
+ * @param node inner node
+ *
+ * @return node that took the place of node in tree
+ */
+uint32_t DynamicBvh::balance(uint32_t node){
+    Node &a = nodes[node];
+    if (a.isLeaf() or a.height < 2)
+        return node;
+    int32_t const difference = nodes[a.child[1]].height - nodes[a.child[0]].height;
+    if (difference >= -1 and difference <= 1)
+        return node;
+
+    uint32_t const heavySide = difference > 1 ? 1 : 0;
+    uint32_t const heavy = a.child[heavySide];
+    uint32_t const light = a.child[1 - heavySide];
+    Node &h = nodes[heavy];
+    uint32_t const f = h.child[0];
+    uint32_t const g = h.child[1];
+    uint32_t const taller  = nodes[f].height > nodes[g].height ? f : g;
+    uint32_t const shorter = taller == f ? g : f;
+
+    // heavy child replaces node, node becomes its child
+    h.child[0] = node;
+    h.parent = a.parent;
+    a.parent = heavy;
+    if (h.parent == emptyID)
+        root = heavy;
+    else
+        nodes[h.parent].child[nodes[h.parent].child[0] == node ? 0 : 1] = heavy;
+
+    // the taller grandchild stays under heavy child, the shorter one moves under node
+    h.child[1] = taller;
+    a.child[heavySide] = shorter;
+    nodes[shorter].parent = node;
+    a.box = mergeAabb(nodes[light].box, nodes[shorter].box);
+    a.height = 1 + std::max(nodes[light].height, nodes[shorter].height);
+    h.box = mergeAabb(a.box, nodes[taller].box);
+    h.height = 1 + std::max(a.height, nodes[taller].height);
+    return heavy;
+}
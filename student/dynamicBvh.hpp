@@ -0,0 +1,70 @@
+/*!
+ * @file
+ * @brief This file contains dynamic bounding volume hierarchy of axis aligned boxes.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <student/fwd.hpp>
+
+/**
+ * @brief Axis aligned bounding box.
+ */
+struct Aabb {
+    glm::vec3 min = glm::vec3(0.f); ///< minimal corner
+    glm::vec3 max = glm::vec3(0.f); ///< maximal corner
+};
+
+Aabb  transformAabb(Aabb const &box, glm::mat4 const &transform);
+Aabb  mergeAabb    (Aabb const &a, Aabb const &b);
+float aabbArea     (Aabb const &box);
+bool  containsAabb (Aabb const &outer, Aabb const &inner);
+
+/**
+ * @brief Dynamic tree of axis aligned boxes (AVL balanced, leaves are inserted by surface area heuristic).
+ * Leaves store fattened boxes, so objects that move a little do not change the tree.
+ * Nodes are kept in one array and they are addressed by index, freed nodes are reused.
+ */
+class DynamicBvh {
+    public:
+        uint32_t insert   (Aabb const &box, uint32_t userData);
+        void     remove   (uint32_t leaf);
+        bool     update   (uint32_t leaf, Aabb const &box);
+        uint32_t cullFrustum(glm::vec4 const *planes, uint32_t nofPlanes, std::vector<uint32_t> &visible) const;
+        void     clear    ();
+
+        uint32_t getUserData(uint32_t leaf) const;
+        Aabb     getFatAabb (uint32_t leaf) const;
+        uint32_t getHeight  () const;
+        uint32_t getNofLeaves() const;
+
+        float margin = 0.1f; ///< leaf box is enlarged by margin times its size on each side
+
+    private:
+        /**
+         * @brief Node of tree, leaves have no children.
+         */
+        struct Node {
+            Aabb     box;                           ///< box of node that contains boxes of its children
+            uint32_t parent   = emptyID;            ///< parent node or next free node
+            uint32_t child[2] = {emptyID, emptyID}; ///< children, emptyID for leaves
+            uint32_t userData = emptyID;            ///< value of leaf
+            int32_t  height   = 0;                  ///< height of subtree, 0 for leaves, -1 for free nodes
+            bool isLeaf() const { return child[0] == emptyID; }
+        };
+
+        uint32_t allocateNode();
+        void     freeNode    (uint32_t node);
+        void     insertLeaf  (uint32_t leaf);
+        void     removeLeaf  (uint32_t leaf);
+        void     refit       (uint32_t node);
+        uint32_t balance     (uint32_t node);
+
+        std::vector<Node> nodes;
+        uint32_t root       = emptyID;
+        uint32_t freeList   = emptyID;
+        uint32_t nofLeaves  = 0;
+};
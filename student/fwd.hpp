@@ -12,9 +12,18 @@
 
 //#define MAKE_STUDENT_RELEASE
 
+#ifndef DISABLE_PIPELINE_STATISTICS
+#define ENABLE_PIPELINE_STATISTICS///< pipeline statistics counters are compiled in (define DISABLE_PIPELINE_STATISTICS to remove them)
+#endif
+
+#ifndef DISABLE_TRACING
+#define ENABLE_TRACING///< trace events are recorded (define DISABLE_TRACING to remove them)
+#endif
+
 uint32_t const maxAttributes = 16;///< maximum number of vertex/fragment attributes
 uint32_t const maxUniforms   = 16;///< maximum number of uniform variables
 uint32_t const emptyID       = 0xffffffff;///< empty object id (for buffers, programs and vertex pullers)
+uint32_t const postTransformCacheSize = 32;///< number of shaded vertices reused by indexed draws (FIFO post-transform cache)
 
 /**
  * @brief This enum represents vertex/fragment attribute type.
@@ -27,6 +36,21 @@ enum class AttributeType{
   VEC4  = 4, ///< 4x 32-bit floats
 };
 
+/**
+ * @brief This enum represents storage format of vertex attribute in buffer.
+ * Number of components is given by AttributeType, values are converted to floats by vertex puller.
+ */
+enum class AttributeFormat{
+  FLOAT32          = 0, ///< 32-bit floats
+  HALF             = 1, ///< 16-bit floats
+  SNORM8           = 2, ///< 8-bit signed integers mapped to [-1, 1]
+  UNORM8           = 3, ///< 8-bit unsigned integers mapped to [0, 1]
+  SNORM16          = 4, ///< 16-bit signed integers mapped to [-1, 1]
+  UNORM16          = 5, ///< 16-bit unsigned integers mapped to [0, 1]
+  SNORM_10_10_10_2 = 6, ///< one 32-bit word, 10 bits for x, y, z (from lowest bits) and 2 bits for w, mapped to [-1, 1]
+  UNORM_10_10_10_2 = 7, ///< one 32-bit word, 10 bits for x, y, z (from lowest bits) and 2 bits for w, mapped to [0, 1]
+};
+
 /**
  * @brief This union represents one vertex/fragment attribute
  */
@@ -44,6 +68,7 @@ union Attribute{
 struct InVertex{
   Attribute attributes[maxAttributes]; ///< vertex attributes
   uint32_t  gl_VertexID              ; ///< vertex id
+  uint32_t  gl_InstanceID            ; ///< instance id
 };
 
 /**
@@ -97,6 +122,89 @@ enum class IndexType{
   UINT32 = 4, ///< uint32_t type
 };
 
+/**
+ * @brief This enum represents encoding of buffer content (see bufferCodec.hpp).
+ */
+enum class BufferEncoding{
+  NONE   = 0, ///< raw data
+  VERTEX = 1, ///< vertices encoded by encodeVertexBuffer, decoded by vertex puller in blocks
+  INDEX  = 2, ///< 32-bit indices encoded by encodeIndexBuffer, drawn range is decoded by vertex puller
+};
+
+using MapFlags = uint32_t;///< combination of buffer mapping flags
+
+MapFlags const mapRead             = 1;///< mapped memory will be read
+MapFlags const mapWrite            = 2;///< mapped memory will be written
+MapFlags const mapInvalidateBuffer = 4;///< orphaning - previous content is discarded and buffer gets new storage
+MapFlags const mapPersistent       = 8;///< buffer may be used by draws and setBufferData while it is mapped
+
+/**
+ * @brief This enum represents result of waiting for sync object
+ */
+enum class SyncStatus{
+  ALREADY_SIGNALED    = 0, ///< fence was signaled before the wait started
+  CONDITION_SATISFIED = 1, ///< fence was signaled during the wait
+  TIMEOUT_EXPIRED     = 2, ///< fence was not signaled before timeout
+  WAIT_FAILED         = 3, ///< sync object does not exist
+};
+
+uint64_t const timeoutIgnored = 0xffffffffffffffffull;///< timeout of clientWaitSync that waits until the fence is signaled
+
+/**
+ * @brief This enum represents how vertices of draw form triangles
+ */
+enum class Topology{
+  TRIANGLES      = 0, ///< independent triangles, 3 vertices per triangle
+  TRIANGLE_STRIP = 1, ///< each vertex after the first two forms triangle with the previous two vertices
+  TRIANGLE_FAN   = 2, ///< each vertex after the first two forms triangle with the previous vertex and the first vertex
+};
+
+/**
+ * @brief This enum represents comparison of fragment depth with the depth stored in framebuffer
+ */
+enum class DepthFunction{
+  LESS   = 0, ///< fragment passes if it is closer than the stored depth
+  LEQUAL = 1, ///< fragment passes if it is closer than or as close as the stored depth
+  EQUAL  = 2, ///< fragment passes if its depth is the stored depth (shading pass after depth prepass)
+};
+
+/**
+ * @brief Draw command record of multiDrawTriangles, multiDrawTrianglesIndirect reads the same layout from a buffer.
+ */
+struct DrawCommand{
+  uint32_t count        ; ///< number of vertices (multiple of 3 for Topology::TRIANGLES without primitive restart)
+  uint32_t instanceCount; ///< number of instances
+  uint32_t firstIndex   ; ///< first element of index buffer (first vertex if indexing is disabled)
+  int32_t  baseVertex   ; ///< value added to each index
+  uint32_t baseInstance ; ///< value added to instance number when reading heads with nonzero divisor
+};
+
+/**
+ * @brief Meshlet record read by vertex puller from meshlet buffer (see meshlet.hpp).
+ * Meshlet is a range of index buffer with bounds that allow to reject it before its vertices are shaded.
+ */
+struct Meshlet{
+  uint32_t firstIndex   ; ///< first element of index buffer (multiple of 3)
+  uint32_t count        ; ///< number of indices (multiple of 3)
+  float    center[3]    ; ///< center of bounding sphere
+  float    radius       ; ///< radius of bounding sphere
+  float    coneApex[3]  ; ///< apex of cone, all triangles lie in front of the cone
+  float    coneAxis[3]  ; ///< average normal of triangles
+  float    coneCutoff   ; ///< sine of angle between axis and the farthest normal, 1 if meshlet cannot be back-facing as a whole
+  uint32_t reserved     ; ///< zero
+};
+
+/**
+ * @brief This enum represents type of query object
+ */
+enum class QueryType{
+  TIME_ELAPSED       = 0, ///< measures time in nanoseconds spent between beginQuery and endQuery
+  SAMPLES_PASSED     = 1, ///< counts fragments that passed depth test
+  ANY_SAMPLES_PASSED = 2, ///< 1 if any fragment passed depth test, 0 otherwise
+};
+
+uint32_t const nofQueryTypes = 3;///< number of query types
+
 /**
  * @brief Function type for vertex shader
  *
@@ -125,4 +233,6 @@ using ObjectID       = uint64_t;///< object id (program, buffer, vertex puller)
 using BufferID       = ObjectID;///< buffer id
 using VertexPullerID = ObjectID;///< vertex puller id
 using ProgramID      = ObjectID;///< shader program id
+using QueryID        = ObjectID;///< query object id
+using SyncID         = ObjectID;///< sync object id
 
@@ -12,6 +12,16 @@
 #include <cstring>
 #include <array>
 #include <vector>
+#include <iomanip>
+#include <student/trace.hpp>
+#include <student/attributeFormat.hpp>
+#include <student/bufferCodec.hpp>
+
+#ifdef ENABLE_PIPELINE_STATISTICS
+#define PIPELINE_STATISTICS_ADD(counter, value) (drawStatistics.counter += (value))
+#else
+#define PIPELINE_STATISTICS_ADD(counter, value) ((void)0)
+#endif
 
 Vertex_puller_settings::Vertex_puller_settings()= default;
 Vertex_puller_settings::~Vertex_puller_settings()= default;
@@ -23,14 +33,44 @@ Vertex_puller_settings::~Vertex_puller_settings()= default;
  * @brief Constructor of GPU
  */
 GPU::GPU(){
-  activeVertexPuller = nullptr;
   frameBuffer = nullptr;
 }
 
 /**
  * @brief Destructor of GPU
  */
-GPU::~GPU()= default;
+GPU::~GPU(){
+    uploadQueue.wait(uploadQueue.lastQueued(), timeoutIgnored);
+}
+
+/**
+ * @brief Constructor of buffer, it allocates storage.
+ *
+ * @param allocator allocator of buffer storage
+ * @param size size of buffer in bytes
+ */
+Buffer::Buffer(BufferAllocator &allocator, uint64_t size):allocator(allocator), size(size){
+    data = (uint8_t *) allocator.allocate(size);
+}
+
+/**
+ * @brief Constructor of buffer that uses existing memory as its storage.
+ *
+ * @param allocator allocator of buffer storage (used only if the buffer is orphaned)
+ * @param data memory of buffer
+ * @param size size of buffer in bytes
+ * @param storage owner of the memory, it is released with the buffer
+ */
+Buffer::Buffer(BufferAllocator &allocator, uint8_t *data, uint64_t size, std::shared_ptr<void const> storage):
+    allocator(allocator), data(data), size(size), storage(std::move(storage)){}
+
+/**
+ * @brief Destructor of buffer, it returns storage to the allocator.
+ */
+Buffer::~Buffer(){
+    if (storage == nullptr)
+        allocator.deallocate(data, size);
+}
 
 /// @}
 
@@ -50,14 +90,27 @@ BufferID GPU::createBuffer(uint64_t size) {
   /// Velikost bufferu je v parameteru size (v bajtech).<br>
   /// Funkce by měla vrátit unikátní identifikátor identifikátor bufferu.<br>
   /// Na grafické kartě by mělo být možné alkovat libovolné množství bufferů o libovolné velikosti.<br>
-    try {
-        auto * buff = new BufferID[size];
-        bufferList.push_back((BufferID)buff);
-        return (BufferID)buff;
-    }
-    catch (std::bad_alloc&) {
+    auto buff = std::make_shared<Buffer>(bufferAllocator, size);
+    if (buff->data == nullptr)
         return emptyID;
-    }
+    return buffers.insert(std::move(buff));
+}
+
+/**
+ * @brief This function creates buffer on GPU that uses existing memory, nothing is copied.
+ * It is used to hand memory mapped files to the GPU, the memory has to be writable
+ * if the buffer is written (copy-on-write mapping is enough).
+ *
+ * @param data memory of buffer
+ * @param size size of buffer in bytes
+ * @param storage owner of the memory, it is kept alive until the buffer is deleted and draws that use it finish
+ *
+ * @return unique identificator of the buffer
+ */
+BufferID GPU::createBufferFromMemory(void * data,uint64_t size,std::shared_ptr<void const> storage){
+    if (data == nullptr)
+        return emptyID;
+    return buffers.insert(std::make_shared<Buffer>(bufferAllocator, (uint8_t *) data, size, std::move(storage)));
 }
 
 /**
@@ -69,12 +122,8 @@ void GPU::deleteBuffer(BufferID buffer) {
   ///  Tato funkce uvolní buffer na grafické kartě.
   /// Buffer pro smazání je vybrán identifikátorem v parameteru "buffer".
   /// Po uvolnění bufferu je identifikátor volný a může být znovu použit při vytvoření nového bufferu.
-    auto it = std::find(bufferList.begin(), bufferList.end(), buffer);
-    if (it != bufferList.end()){
-        auto * tmp = (BufferID *) *it;
-        bufferList.erase(it);
-        delete tmp;
-    }
+    // storage is released when pending uploads and draws that use the buffer finish
+    buffers.erase(buffer);
 }
 
 /**
@@ -91,8 +140,15 @@ void GPU::setBufferData(BufferID buffer, uint64_t offset, uint64_t size, void co
   /// Parametr size určuje, kolik dat (v bajtech) se překopíruje.<br>
   /// Parametr offset určuje místo v bufferu (posun v bajtech) kam se data nakopírují.<br>
   /// Parametr data obsahuje ukazatel na data na cpu pro kopírování.<br>
-    auto it = std::find(bufferList.begin(), bufferList.end(), buffer);
-    memcpy(reinterpret_cast<void *>(*it + (BufferID) offset), data, size);
+    auto buff = getBuffer(buffer);
+    if (buff == nullptr)
+        return;
+    if (offset + size > buff->size)
+        throw std::range_error("Buffer data are out of range.");
+    if (buff->mapped and not (buff->mapFlags & mapPersistent))
+        throw std::range_error("Buffer is mapped.");
+    waitForUploads(*buff);
+    memcpy(buff->data + offset, data, size);
 }
 
 /**
@@ -113,8 +169,13 @@ void GPU::getBufferData(BufferID buffer,
   /// Parametr size určuje kolik dat (v bajtech) se překopíruje.<br>
   /// Parametr offset určuje místo v bufferu (posun v bajtech) odkud se začne kopírovat.<br>
   /// Parametr data obsahuje ukazatel, kam se data nakopírují.<br>
-    auto it = std::find(bufferList.begin(), bufferList.end(), buffer);
-    memcpy(data, reinterpret_cast<const void *>(*it + (BufferID)offset), size);
+    auto buff = getBuffer(buffer);
+    if (buff == nullptr)
+        return;
+    if (offset + size > buff->size)
+        throw std::range_error("Buffer data are out of range.");
+    waitForUploads(*buff);
+    memcpy(data, buff->data + offset, size);
 }
 
 /**
@@ -128,10 +189,197 @@ bool GPU::isBuffer(BufferID buffer) {
   ///  Tato funkce by měla vrátit true pokud buffer je identifikátor existující bufferu.<br>
   /// Tato funkce by měla vrátit false, pokud buffer není identifikátor existujícího bufferu. (nebo bufferu, který byl smazán).<br>
   /// Pro emptyId vrací false.<br>
-    auto it = std::find(bufferList.begin(), bufferList.end(), buffer);
     if (buffer == emptyID)
         return false;
-    return it != bufferList.end();
+    return buffers.contains(buffer);
+}
+
+/**
+ * @brief This function maps range of buffer into CPU address space.
+ * Buffer storage lives in CPU memory, so the returned pointer points directly into it
+ * and data written through it need no copy.
+ * Without mapPersistent the buffer cannot be drawn from or updated by setBufferData until it is unmapped.
+ *
+ * @param buffer buffer id
+ * @param offset offset of mapped range in bytes
+ * @param size size of mapped range in bytes
+ * @param flags combination of mapRead, mapWrite, mapInvalidateBuffer and mapPersistent
+ *
+ * @return pointer to the mapped range, nullptr if the buffer does not exist, is already mapped or the range is out of buffer
+ */
+void * GPU::mapBuffer(BufferID buffer,uint64_t offset,uint64_t size,MapFlags flags){
+    auto buff = getBuffer(buffer);
+    if (buff == nullptr or offset + size > buff->size or buff->mapClaimed.exchange(true))
+        return nullptr;
+    if (flags & mapInvalidateBuffer){
+        // orphaning: the id gets new buffer object with fresh storage, old content is not preserved
+        // and the old storage is released when draws and uploads that still use it finish
+        auto orphan = std::make_shared<Buffer>(bufferAllocator, buff->size);
+        if (orphan->data == nullptr){
+            buff->mapClaimed = false;
+            return nullptr;
+        }
+        orphan->mapClaimed = true;
+        orphan->encoding = buff->encoding;
+        buffers.replace(buffer, orphan);
+        buff = orphan;
+    }
+    else
+        waitForUploads(*buff);
+    // other threads that see mapped see the map state too
+    buff->mapFlags.store(flags, std::memory_order_relaxed);
+    buff->mapOffset.store(offset, std::memory_order_relaxed);
+    buff->mapSize.store(size, std::memory_order_relaxed);
+    buff->mapped.store(true, std::memory_order_release);
+    return buff->data + offset;
+}
+
+/**
+ * @brief This function makes writes into range of mapped buffer visible to draws.
+ * Mapped memory is the buffer storage itself, so only the range is validated.
+ *
+ * @param buffer buffer id
+ * @param offset offset relative to the mapped range
+ * @param size size of flushed range in bytes
+ */
+void GPU::flushMappedBufferRange(BufferID buffer,uint64_t offset,uint64_t size){
+    auto buff = getBuffer(buffer);
+    if (buff == nullptr or not buff->mapped.load(std::memory_order_acquire) or offset + size > buff->mapSize.load(std::memory_order_relaxed))
+        throw std::range_error("Flushed range is not mapped.");
+}
+
+/**
+ * @brief This function unmaps buffer.
+ *
+ * @param buffer buffer id
+ *
+ * @return true if the buffer was mapped
+ */
+bool GPU::unmapBuffer(BufferID buffer){
+    auto buff = getBuffer(buffer);
+    // buffer stops being mapped before its map state is cleared, only one unmap succeeds
+    if (buff == nullptr or not buff->mapped.exchange(false, std::memory_order_acq_rel))
+        return false;
+    buff->mapFlags.store(0, std::memory_order_relaxed);
+    buff->mapOffset.store(0, std::memory_order_relaxed);
+    buff->mapSize.store(0, std::memory_order_relaxed);
+    buff->mapClaimed.store(false, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief This function uploads data to buffer asynchronously.
+ * Data are copied into the upload queue before the function returns, so the caller may reuse them,
+ * the buffer is written by a background thread.
+ * Callers that do not need the data afterwards should move them into the overload that takes std::vector,
+ * it avoids the copy.
+ * Draws, setBufferData, getBufferData and mapBuffer wait only for uploads into the buffers they use,
+ * completion of all previous uploads can be tested by fenceSync and clientWaitSync.
+ *
+ * @param buffer buffer identificator
+ * @param offset specifies the offset into the buffer's data
+ * @param size specifies the size of buffer that will be uploaded
+ * @param data specifies a pointer to new data
+ */
+void GPU::setBufferDataAsync(BufferID buffer,uint64_t offset,uint64_t size,void const* data){
+    auto buff = getBuffer(buffer);
+    if (buff == nullptr)
+        return;
+    if (offset + size > buff->size)
+        throw std::range_error("Buffer data are out of range.");
+    setBufferDataAsync(buffer, offset, std::vector<uint8_t>((uint8_t const *) data, (uint8_t const *) data + size));
+}
+
+/**
+ * @brief This function uploads data to buffer asynchronously and takes ownership of them.
+ * Data are not copied on the calling thread, the background thread writes them into the buffer
+ * and releases them afterwards.
+ *
+ * @param buffer buffer identificator
+ * @param offset specifies the offset into the buffer's data
+ * @param data new data, their size is the size of uploaded range
+ */
+void GPU::setBufferDataAsync(BufferID buffer,uint64_t offset,std::vector<uint8_t> &&data){
+    auto buff = getBuffer(buffer);
+    if (buff == nullptr)
+        return;
+    if (offset + data.size() > buff->size)
+        throw std::range_error("Buffer data are out of range.");
+    if (buff->mapped and not (buff->mapFlags & mapPersistent))
+        throw std::range_error("Buffer is mapped.");
+    // the queue keeps the buffer alive until the upload is complete
+    uint64_t const sequence = uploadQueue.push(buff, buff->data + offset, std::move(data));
+    uint64_t pending = buff->pendingUpload.load();
+    while (pending < sequence and not buff->pendingUpload.compare_exchange_weak(pending, sequence));
+}
+
+/**
+ * @brief This function sets encoding of buffer content.
+ * Encoded buffers are prepared by encodeVertexBuffer and encodeIndexBuffer,
+ * vertex puller decodes them while it reads vertices, so they stay small in memory.
+ *
+ * @param buffer buffer identificator
+ * @param encoding encoding of content, BufferEncoding::NONE is default
+ */
+void GPU::setBufferEncoding(BufferID buffer,BufferEncoding encoding){
+    auto buff = getBuffer(buffer);
+    if (buff != nullptr)
+        buff->encoding = encoding;
+}
+
+/**
+ * @brief This function waits for asynchronous uploads into buffer.
+ *
+ * @param buffer buffer object
+ */
+void GPU::waitForUploads(Buffer const & buffer){
+    uint64_t const pending = buffer.pendingUpload.load();
+    if (uploadQueue.isComplete(pending))
+        return;
+    TRACE_SCOPE("waitForUploads", "gpu");
+    uploadQueue.wait(pending, timeoutIgnored);
+}
+
+/**
+ * @brief This function returns memory usage of buffers.
+ *
+ * @return bytes used by buffers, their peak and bytes reserved from the system
+ */
+MemoryUsage GPU::getMemoryUsage() const {
+    return bufferAllocator.getUsage();
+}
+
+/**
+ * @brief This function returns buffer object.
+ *
+ * @param buffer buffer id
+ *
+ * @return buffer object or nullptr if buffer does not exist
+ */
+std::shared_ptr<Buffer> GPU::getBuffer(BufferID buffer) const {
+    return buffers.get(buffer);
+}
+
+/**
+ * @brief This function returns vertex puller settings.
+ *
+ * @param vao vertex puller id
+ *
+ * @return vertex puller settings or nullptr if vertex puller does not exist
+ */
+std::shared_ptr<Vertex_puller_settings> GPU::getVertexPuller(VertexPullerID vao) const {
+    return vertexPullers.get(vao);
+}
+
+/**
+ * @brief This function returns shader program.
+ *
+ * @param prg shader program id
+ *
+ * @return shader program or nullptr if program does not exist
+ */
+std::shared_ptr<Program> GPU::getProgram(ProgramID prg) const {
+    return programs.get(prg);
 }
 
 /// @}
@@ -150,10 +398,9 @@ ObjectID GPU::createVertexPuller(){
   ///  Tato funkce vytvoří novou práznou tabulku s nastavením pro vertex puller.<br>
   /// Funkce by měla vrátit identifikátor nové tabulky.
   /// Prázdná tabulka s nastavením neobsahuje indexování a všechny čtecí hlavy jsou vypnuté.
-    auto * vertex_puller = new Vertex_puller_settings;
+    auto vertex_puller = std::make_shared<Vertex_puller_settings>();
     vertex_puller->indexing.enabled = false;
-    vertexPullerList.push_back((ObjectID) vertex_puller);
-        return (ObjectID) vertex_puller;
+    return vertexPullers.insert(std::move(vertex_puller));
 }
 
 /**
@@ -165,12 +412,7 @@ void GPU::deleteVertexPuller(VertexPullerID vao){
   ///  Tato funkce by měla odstranit tabulku s nastavení pro vertex puller.<br>
   /// Parameter "vao" obsahuje identifikátor tabulky s nastavením.<br>
   /// Po uvolnění nastavení je identifiktátor volný a může být znovu použit.<br>
-    auto it = std::find(vertexPullerList.begin(), vertexPullerList.end(), vao);
-    if (it != vertexPullerList.end()){
-        auto tmp = (ObjectID *) *it;
-        vertexPullerList.erase(it);
-        delete tmp;
-    }
+    vertexPullers.erase(vao);
 }
 
 /**
@@ -196,9 +438,8 @@ void GPU::setVertexPullerHead(VertexPullerID vao,
   /// Parametr "stride" nastaví krok čtecí hlavy.<br>
   /// Parametr "offset" nastaví počáteční pozici čtecí hlavy.<br>
   /// Parametr "buffer" vybere buffer, ze kterého bude čtecí hlava číst.<br>
-    auto it = std::find(vertexPullerList.begin(), vertexPullerList.end(), vao);
-    if (it != vertexPullerList.end()){
-        auto vao_tmp = (Vertex_puller_settings *) *it;
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
         vao_tmp->heads[head].attrib_type = type;
         vao_tmp->heads[head].stride = stride;
         vao_tmp->heads[head].offset = offset;
@@ -218,15 +459,108 @@ void GPU::setVertexPullerIndexing(VertexPullerID vao,IndexType type,BufferID buf
   /// Parametr "vao" vybírá tabulku s nastavením.<br>
   /// Parametr "type" volí typ indexu, který je uložený v bufferu.<br>
   /// Parametr "buffer" volí buffer, ve kterém jsou uloženy indexy.<br>
-    auto it = std::find(vertexPullerList.begin(), vertexPullerList.end(), vao);
-    if (it != vertexPullerList.end()){
-        auto vao_tmp = (Vertex_puller_settings *) *it;
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
         vao_tmp->indexing.enabled = true;
         vao_tmp->indexing.buffer_id = buffer;
         vao_tmp->indexing.index_type = type;
     }
 }
 
+/**
+ * @brief This function sets instance divisor of vertex puller's head.
+ *
+ * @param vao vertex puller id
+ * @param head head id
+ * @param divisor 0 reads the attribute per vertex, n > 0 advances the attribute once every n instances
+ */
+void GPU::setVertexPullerHeadDivisor(VertexPullerID vao,uint32_t head,uint32_t divisor){
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
+        vao_tmp->heads[head].divisor = divisor;
+    }
+}
+
+/**
+ * @brief This function sets storage format of vertex puller's head.
+ * Packed formats (half floats, normalized integers) are converted to floats when the attribute is read,
+ * so shaders do not change.
+ *
+ * @param vao vertex puller id
+ * @param head head id
+ * @param format storage format, AttributeFormat::FLOAT32 is default
+ */
+void GPU::setVertexPullerHeadFormat(VertexPullerID vao,uint32_t head,AttributeFormat format){
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
+        vao_tmp->heads[head].format = format;
+    }
+}
+
+/**
+ * @brief This function sets meshlets of vertex puller.
+ * Indexed draws of triangle lists test meshlets that overlap the drawn range before vertex shading,
+ * meshlets out of frustum (and back-facing ones if face culling is enabled) are not drawn.
+ * The program has to set its culling uniforms (setProgramCullingUniforms).
+ *
+ * @param vao vertex puller id
+ * @param buffer buffer with tightly packed Meshlet records sorted by firstIndex, their ranges do not overlap
+ * @param nofMeshlets number of meshlets, 0 disables meshlet culling
+ */
+void GPU::setVertexPullerMeshlets(VertexPullerID vao,BufferID buffer,uint32_t nofMeshlets){
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
+        vao_tmp->meshlets.buffer_id = buffer;
+        vao_tmp->meshlets.count = nofMeshlets;
+    }
+}
+
+/**
+ * @brief This function sets bounding sphere of vertex puller.
+ * Draws are skipped before vertex shading if the sphere is out of frustum given by culling uniforms of program
+ * (setProgramCullingUniforms), so it has to contain attribute 0 of all drawn vertices and instances.
+ *
+ * @param vao vertex puller id
+ * @param center center of sphere in the space of attribute 0
+ * @param radius radius of sphere
+ */
+void GPU::setVertexPullerBoundingSphere(VertexPullerID vao,glm::vec3 const&center,float radius){
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
+        vao_tmp->bounds.type = BoundsType::SPHERE;
+        vao_tmp->bounds.center = center;
+        vao_tmp->bounds.radius = radius;
+    }
+}
+
+/**
+ * @brief This function sets axis aligned bounding box of vertex puller.
+ * It is used in the same way as bounding sphere (setVertexPullerBoundingSphere).
+ *
+ * @param vao vertex puller id
+ * @param min minimal corner of box in the space of attribute 0
+ * @param max maximal corner of box
+ */
+void GPU::setVertexPullerBoundingBox(VertexPullerID vao,glm::vec3 const&min,glm::vec3 const&max){
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
+        vao_tmp->bounds.type = BoundsType::BOX;
+        vao_tmp->bounds.min = min;
+        vao_tmp->bounds.max = max;
+    }
+}
+
+/**
+ * @brief This function disables culling of whole draws of vertex puller.
+ *
+ * @param vao vertex puller id
+ */
+void GPU::disableVertexPullerBounds(VertexPullerID vao){
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr)
+        vao_tmp->bounds.type = BoundsType::NONE;
+}
+
 /**
  * @brief This function enables vertex puller's head.
  *
@@ -238,9 +572,9 @@ void GPU::enableVertexPullerHead(VertexPullerID vao,uint32_t head){
   /// Pokud je čtecí hlava povolena, hodnoty z bufferu se budou kopírovat do atributu vrcholů vertex shaderu.<br>
   /// Parametr "vao" volí tabulku s nastavením vertex pulleru (vybírá vertex puller).<br>
   /// Parametr "head" volí čtecí hlavu.<br>
-    auto it = std::find(vertexPullerList.begin(), vertexPullerList.end(), vao);
-    if (it != vertexPullerList.end()){
-        ((Vertex_puller_settings *) *it)->heads[head].enabled = true;
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
+        vao_tmp->heads[head].enabled = true;
     }
 }
 
@@ -254,9 +588,9 @@ void GPU::disableVertexPullerHead(VertexPullerID vao,uint32_t head){
   ///  Tato funkce zakáže čtecí hlavu daného vertex pulleru.<br>
   /// Pokud je čtecí hlava zakázána, hodnoty z bufferu se nebudou kopírovat do atributu vrcholu.<br>
   /// Parametry "vao" a "head" vybírají vertex puller a čtecí hlavu.<br>
-    auto it = std::find(vertexPullerList.begin(), vertexPullerList.end(), vao);
-    if (it != vertexPullerList.end()){
-        ((Vertex_puller_settings *) *it)->heads[head].enabled = false;
+    auto vao_tmp = getVertexPuller(vao);
+    if (vao_tmp != nullptr){
+        vao_tmp->heads[head].enabled = false;
     }
 }
 
@@ -268,9 +602,8 @@ void GPU::disableVertexPullerHead(VertexPullerID vao,uint32_t head){
 void GPU::bindVertexPuller(VertexPullerID vao){
   ///  Tato funkce aktivuje nastavení vertex pulleru.<br>
   /// Pokud je daný vertex puller aktivován, atributy z bufferů jsou vybírány na základě jeho nastavení.<br>
-    auto it = std::find(vertexPullerList.begin(), vertexPullerList.end(), vao);
-    if (it != vertexPullerList.end()){
-        this->activeVertexPuller = (ObjectID *) *it;
+    if (isVertexPuller(vao)){
+        this->activeVertexPuller = vao;
     }
 }
 
@@ -280,7 +613,7 @@ void GPU::bindVertexPuller(VertexPullerID vao){
 void GPU::unbindVertexPuller(){
   ///  Tato funkce deaktivuje vertex puller.
   /// To většinou znamená, že se vybere neexistující "emptyID" vertex puller.
-    this->activeVertexPuller = nullptr;
+    this->activeVertexPuller = emptyID;
 }
 
 /**
@@ -293,8 +626,7 @@ void GPU::unbindVertexPuller(){
 bool GPU::isVertexPuller (VertexPullerID vao){
   ///  Tato funkce otestuje, zda daný vertex puller existuje.
   /// Pokud ano, funkce vrací true.
-    auto it = std::find(vertexPullerList.begin(), vertexPullerList.end(), vao);
-    return it != vertexPullerList.end();
+    return vao != emptyID and vertexPullers.contains(vao);
 }
 
 /// @}
@@ -313,9 +645,7 @@ ProgramID GPU::createProgram(){
   /// Funkce vrací unikátní identifikátor nového proramu.<br>
   /// Program je seznam nastavení, které obsahuje: ukazatel na vertex a fragment shader.<br>
   /// Dále obsahuje uniformní proměnné a typ výstupních vertex attributů z vertex shaderu, které jsou použity pro interpolaci do fragment atributů.<br>
-  auto program = new Program;
-  programList.push_back((ProgramID) program);
-  return (ProgramID) program;
+  return programs.insert(std::make_shared<Program>());
 }
 
 /**
@@ -327,12 +657,7 @@ void GPU::deleteProgram(ProgramID prg){
   ///  Tato funkce by měla smazat vybraný shader program.<br>
   /// Funkce smaže nastavení shader programu.<br>
   /// Identifikátor programu se stane volným a může být znovu využit.<br>
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    if (it != programList.end()){
-        auto tmp = (ProgramID *) *it;
-        programList.erase(it);
-        delete tmp;
-    }
+    programs.erase(prg);
 }
 
 /**
@@ -344,10 +669,10 @@ void GPU::deleteProgram(ProgramID prg){
  */
 void GPU::attachShaders(ProgramID prg,VertexShader vs,FragmentShader fs){
   ///  Tato funkce by měla připojít k vybranému shader programu vertex a fragment shader.
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    if (it != programList.end()){
-        ((Program *) *it)->vertexShader = vs;
-        ((Program *) *it)->fragmentShader = fs;
+    auto program = getProgram(prg);
+    if (program != nullptr){
+        program->vertexShader = vs;
+        program->fragmentShader = fs;
     }
 }
 
@@ -365,9 +690,9 @@ void GPU::setVS2FSType(ProgramID prg, uint32_t attrib, AttributeType type){
   /// Tyto atributy obsahují interpolované hodnoty vertex atributů.<br>
   /// Tato funkce vybere jakého typu jsou tyto interpolované atributy.<br>
   /// Bez jakéhokoliv nastavení jsou atributy prázdne AttributeType::EMPTY<br>
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    if (it != programList.end()){
-        ((Program *) *it)->attributeType[attrib] = type;
+    auto program = getProgram(prg);
+    if (program != nullptr){
+        program->attributeType[attrib] = type;
     }
 }
 
@@ -378,7 +703,7 @@ void GPU::setVS2FSType(ProgramID prg, uint32_t attrib, AttributeType type){
  */
 void GPU::useProgram(ProgramID prg){
   ///  tato funkce by měla vybrat aktivní shader program.
-    this->activeProgram = (ProgramID *)prg;
+    this->activeProgram = prg;
 }
 
 /**
@@ -391,8 +716,7 @@ void GPU::useProgram(ProgramID prg){
 bool GPU::isProgram(ProgramID prg){
   ///  tato funkce by měla zjistit, zda daný program existuje.<br>
   /// Funkce vráti true, pokud program existuje.<br>
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    return it != programList.end();
+    return prg != emptyID and programs.contains(prg);
 }
 
 /**
@@ -407,9 +731,9 @@ void GPU::programUniform1f(ProgramID prg, uint32_t uniformId, float const &d){
   /// Parametr "prg" vybírá shader program.<br>
   /// Parametr "uniformId" vybírá uniformní proměnnou. Maximální počet uniformních proměnných je uložen v programné \link maxUniforms \endlink.<br>
   /// Parametr "d" obsahuje data (1 float).<br>
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    if (it != programList.end())
-        ((Program *) *it)->uniforms.uniform[uniformId].v1 = d;
+    auto program = getProgram(prg);
+    if (program != nullptr)
+        program->uniforms.uniform[uniformId].v1 = d;
 }
 
 /**
@@ -422,9 +746,9 @@ void GPU::programUniform1f(ProgramID prg, uint32_t uniformId, float const &d){
 void GPU::programUniform2f(ProgramID prg, uint32_t uniformId, glm::vec2 const&d){
   ///  tato funkce dělá obdobnou věc jako funkce programUniform1f.<br>
   /// Místo 1 floatu nahrává 2 floaty.
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    if (it != programList.end())
-        ((Program *) *it)->uniforms.uniform[uniformId].v2 = d;
+    auto program = getProgram(prg);
+    if (program != nullptr)
+        program->uniforms.uniform[uniformId].v2 = d;
 }
 
 /**
@@ -437,9 +761,9 @@ void GPU::programUniform2f(ProgramID prg, uint32_t uniformId, glm::vec2 const&d)
 void GPU::programUniform3f(ProgramID prg,uint32_t uniformId,glm::vec3 const&d){
   ///  tato funkce dělá obdobnou věc jako funkce programUniform1f.<br>
   /// Místo 1 floatu nahrává 3 floaty.
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    if (it != programList.end())
-        ((Program *) *it)->uniforms.uniform[uniformId].v3 = d;
+    auto program = getProgram(prg);
+    if (program != nullptr)
+        program->uniforms.uniform[uniformId].v3 = d;
 }
 
 /**
@@ -452,9 +776,9 @@ void GPU::programUniform3f(ProgramID prg,uint32_t uniformId,glm::vec3 const&d){
 void GPU::programUniform4f(ProgramID prg,uint32_t uniformId,glm::vec4 const&d){
   ///  tato funkce dělá obdobnou věc jako funkce programUniform1f.<br>
   /// Místo 1 floatu nahrává 4 floaty.
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    if (it != programList.end())
-        ((Program *) *it)->uniforms.uniform[uniformId].v4 = d;
+    auto program = getProgram(prg);
+    if (program != nullptr)
+        program->uniforms.uniform[uniformId].v4 = d;
 }
 
 /**
@@ -467,9 +791,30 @@ void GPU::programUniform4f(ProgramID prg,uint32_t uniformId,glm::vec4 const&d){
 void GPU::programUniformMatrix4f(ProgramID prg,uint32_t uniformId,glm::mat4 const&d){
   ///  tato funkce dělá obdobnou věc jako funkce programUniform1f.<br>
   /// Místo 1 floatu nahrává matici 4x4 (16 floatů).
-    auto it = std::find(programList.begin(), programList.end(), prg);
-    if (it != programList.end())
-        ((Program *) *it)->uniforms.uniform[uniformId].m4 = d;
+    auto program = getProgram(prg);
+    if (program != nullptr)
+        program->uniforms.uniform[uniformId].m4 = d;
+}
+
+/**
+ * @brief This function selects matrix uniforms that transform vertex attribute 0 into clip space.
+ * GPU culling multiplies them as projection * view * model, missing matrices are identity.
+ *
+ * @param prg shader program
+ * @param projectionUniform uniform with projection matrix, emptyID disables culling of the program
+ * @param viewUniform uniform with view matrix or emptyID
+ * @param modelUniform uniform with model matrix or emptyID
+ */
+void GPU::setProgramCullingUniforms(ProgramID prg,uint32_t projectionUniform,uint32_t viewUniform,uint32_t modelUniform){
+    auto program = getProgram(prg);
+    if (program == nullptr)
+        return;
+    uint32_t const uniforms[3] = {projectionUniform, viewUniform, modelUniform};
+    for (uint32_t u = 0; u < 3; u++){
+        if (uniforms[u] != emptyID and uniforms[u] >= maxUniforms)
+            throw std::range_error("Culling uniform is out of range.");
+        program->cullingUniforms[u] = uniforms[u];
+    }
 }
 
 /// @}
@@ -565,6 +910,76 @@ uint32_t GPU::getFramebufferHeight(){
  * @{
  */
 
+/**
+ * @brief This function selects how drawn vertices are assembled into triangles.
+ *
+ * @param topology triangle list, strip or fan
+ */
+void GPU::setTopology(Topology topology){
+    this->topology = topology;
+}
+
+/**
+ * @brief This function enables primitive restart.
+ * Index with maximal value of the index type (0xff, 0xffff, 0xffffffff) is not drawn,
+ * it ends the current strip or fan and the next index starts a new one.
+ */
+void GPU::enablePrimitiveRestart(){
+    primitiveRestart = true;
+}
+
+/**
+ * @brief This function disables primitive restart.
+ */
+void GPU::disablePrimitiveRestart(){
+    primitiveRestart = false;
+}
+
+/**
+ * @brief This function enables face culling.
+ * Triangles that are clockwise in window coordinates (back faces of counterclockwise meshes) are not rasterized.
+ */
+void GPU::enableFaceCulling(){
+    faceCulling = true;
+}
+
+/**
+ * @brief This function disables face culling.
+ */
+void GPU::disableFaceCulling(){
+    faceCulling = false;
+}
+
+/**
+ * @brief This function enables or disables writes into color buffer.
+ * Depth test and queries work the same way without writes.
+ *
+ * @param enabled true if fragments that pass depth test write color
+ */
+void GPU::colorMask(bool enabled){
+    colorWrites = enabled;
+}
+
+/**
+ * @brief This function enables or disables writes into depth buffer.
+ *
+ * @param enabled true if fragments that pass depth test write depth
+ */
+void GPU::depthMask(bool enabled){
+    depthWrites = enabled;
+}
+
+/**
+ * @brief This function selects comparison of depth test.
+ * Depth prepass draws with colorMask(false) (depth-only rasterizer), shading pass then draws the same geometry
+ * with depthMask(false) and DepthFunction::EQUAL, so each pixel runs fragment shader once.
+ *
+ * @param function comparison of fragment depth with the stored depth, DepthFunction::LESS is default
+ */
+void GPU::depthFunc(DepthFunction function){
+    depthFunction = function;
+}
+
 /**
  * @brief This functino clears framebuffer.
  *
@@ -595,62 +1010,771 @@ void GPU::clear(float r,float g,float b,float a){
         colorBuffer[4 * i + 3] = a;
         depthBuffer[i] = FLT_MAX;
     }
+    // pixels of active visibility buffer are cleared with depth, their triangles stay stored until resolve
+    if (visibility.active)
+        std::fill(visibility.ids.begin(), visibility.ids.end(), 0);
 }
 
 void GPU::drawTriangles(uint32_t  nofVertices){
   /// Vrcholy se budou vybírat podle nastavení z aktivního vertex pulleru (pomocí bindVertexPuller).<br>
   /// Vertex shader a fragment shader se zvolí podle aktivního shader programu (pomocí useProgram).<br>
   /// Parametr "nofVertices" obsahuje počet vrcholů, který by se měl vykreslit (3 pro jeden trojúhelník).<br>
-    if (this->activeVertexPuller == nullptr or this->activeProgram == nullptr)
-        throw std::range_error("Vertex puller or Program is NULL, which it cannot be.");
-    if (nofVertices < 3 or nofVertices % 3 != 0)
+    drawTrianglesInstanced(nofVertices, 1);
+}
+
+/**
+ * @brief This function draws nofInstances copies of triangles.
+ * Vertex shader gets the number of copy in gl_InstanceID,
+ * heads with nonzero divisor are read by gl_InstanceID / divisor instead of gl_VertexID.
+ *
+ * @param nofVertices number of vertices of one copy
+ * @param nofInstances number of copies
+ */
+void GPU::drawTrianglesInstanced(uint32_t  nofVertices,uint32_t nofInstances){
+    drawTrianglesInstancedBaseVertex(0, nofVertices, 0, nofInstances, 0);
+}
+
+/**
+ * @brief This function draws a range of vertices.
+ * Without indexing the vertices firstVertex .. firstVertex+nofVertices-1 are drawn,
+ * with indexing the range selects elements of the index buffer.
+ *
+ * @param firstVertex first drawn vertex (element of index buffer)
+ * @param nofVertices number of vertices
+ */
+void GPU::drawTrianglesRange(uint32_t  firstVertex,uint32_t nofVertices){
+    drawTrianglesInstancedBaseVertex(firstVertex, nofVertices, 0, 1, 0);
+}
+
+/**
+ * @brief This function draws a range of index buffer, baseVertex is added to each index.
+ * It allows to store several meshes in one vertex buffer and one index buffer.
+ *
+ * @param firstIndex first element of index buffer
+ * @param nofVertices number of vertices
+ * @param baseVertex value added to each index
+ */
+void GPU::drawTrianglesBaseVertex(uint32_t  firstIndex,uint32_t nofVertices,int32_t baseVertex){
+    drawTrianglesInstancedBaseVertex(firstIndex, nofVertices, baseVertex, 1, 0);
+}
+
+/**
+ * @brief This function draws nofInstances copies of a range of index buffer.
+ *
+ * @param firstIndex first element of index buffer (first vertex if indexing is disabled)
+ * @param nofVertices number of vertices of one copy
+ * @param baseVertex value added to each index
+ * @param nofInstances number of copies
+ * @param baseInstance value added to gl_InstanceID when reading heads with nonzero divisor
+ */
+void GPU::drawTrianglesInstancedBaseVertex(uint32_t firstIndex,uint32_t nofVertices,int32_t baseVertex,
+                                           uint32_t nofInstances,uint32_t baseInstance){
+    if (nofVertices < 3 or (topology == Topology::TRIANGLES and not primitiveRestart and nofVertices % 3 != 0))
         throw std::range_error("Parameter nofVertices has invalid value.");
+    DrawCommand command{nofVertices, nofInstances, firstIndex, baseVertex, baseInstance};
+    multiDrawTriangles(&command, 1);
+}
 
-    auto * outAbstractVertices = new OutAbstractVertex[nofVertices];
+/**
+ * @brief This function draws a batch of draw commands with the active vertex puller and program.
+ * State is validated and looked up once for the whole batch.
+ * Indices are checked when they are read, command with an index out of vertex buffers throws and the commands before it stay drawn.
+ * Commands with zero count or zero instanceCount are skipped.
+ *
+ * @param commands draw commands
+ * @param nofCommands number of draw commands
+ */
+void GPU::multiDrawTriangles(DrawCommand const *commands,uint32_t nofCommands){
+    auto program = getProgram(activeProgram);
+    if (program == nullptr)
+        throw std::range_error("Vertex puller or Program is NULL, which it cannot be.");
+    // other threads may delete the bound vertex puller, the batch draws the one it looked up
+    DrawVertexPuller const vertexPuller = lookupDrawVertexPuller(activeVertexPuller);
+    uint32_t maxVertices = 0;
+    for (uint32_t c = 0; c < nofCommands; c++){
+        if (topology == Topology::TRIANGLES and not primitiveRestart and commands[c].count % 3 != 0)
+            throw std::range_error("Parameter count of draw command has invalid value.");
+        validateDrawCommand(vertexPuller, commands[c]);
+        maxVertices = std::max(maxVertices, commands[c].count);
+    }
+    if (visibility.active and (visibility.width != frameBuffer->width or visibility.height != frameBuffer->height))
+        throw std::range_error("Framebuffer was resized while visibility buffer was active.");
+
+    uint32_t drawId = drawCounter++;
+    TRACE_DRAW_SCOPE("drawTriangles", "gpu", drawId);
+#ifdef ENABLE_PIPELINE_STATISTICS
+    drawStatistics = PipelineStatistics{};
+#endif
+    drawStageTimings = StageTimings{};
+    if (conditionQuery != nullptr and conditionQuery->result == 0){
+        PIPELINE_STATISTICS_ADD(drawsConditionalSkipped, 1);
+#ifdef ENABLE_PIPELINE_STATISTICS
+        frameStatistics += drawStatistics;
+#endif
+        return;
+    }
+    // all commands share vertex puller and program, bounds out of frustum skip the whole batch
+    if (cullDraw(*vertexPuller.settings, *program)){
+#ifdef ENABLE_PIPELINE_STATISTICS
+        frameStatistics += drawStatistics;
+#endif
+        return;
+    }
+    Timer<double> stageTimer;
+    uint64_t stageStart = TRACE_NOW();
+    auto stageDone = [&](PipelineStage stage){
+        drawStageTimings[stage] += stageTimer.elapsedFromLast();
+        uint64_t stageEnd = TRACE_NOW();
+        TRACE_COMPLETE(pipelineStageName(stage), "stage", stageStart, stageEnd, drawId);
+        stageStart = stageEnd;
+    };
+    // buffers are allocated once per call and reused by all commands and instances
+    std::vector<OutAbstractVertex> outAbstractVertices(maxVertices);
     std::vector<PrimitiveTriangle> primitiveTriangles;
-    primitiveTriangles.reserve(nofVertices / 3);
-    Program * program = (Program *) * std::find(programList.begin(), programList.end(), (ProgramID) activeProgram);
+    primitiveTriangles.reserve(topology == Topology::TRIANGLES ? maxVertices / 3 : maxVertices);
+    std::vector<PrimitiveTriangle> newTriangles;
+    std::vector<InFragment> inFragments;
+    std::vector<uint32_t> passedFragments;
+    std::vector<OutFragment> outFragments;
+
+    for (uint32_t c = 0; c < nofCommands; c++){
+        DrawCommand const &command = commands[c];
+        if (command.count == 0 or command.instanceCount == 0)
+            continue;
+        // indices are decoded and meshlets are culled once, all instances share them
+        DrawIndices const indices = prepareDrawCommand(vertexPuller, *program, command);
+        for (uint32_t instance = 0; instance < command.instanceCount; instance++){
+            /*---VERTEX PROCESSOR---*/
+            uint32_t const nofProcessed = vertexProcessor(vertexPuller, indices, command, outAbstractVertices.data(), program.get(), instance);
+            stageDone(PipelineStage::VERTEX_PROCESSOR);
+
+            /*---PRIMITIVE ASSEMBLY---*/
+            primitiveTriangles.clear();
+            primitiveAssembly(primitiveTriangles, outAbstractVertices.data(), nofProcessed);
+            stageDone(PipelineStage::PRIMITIVE_ASSEMBLY);
+
+            /*---CLIPPING---*/
+            newTriangles.clear();
+            for (auto const & primitiveTriangle : primitiveTriangles){
+                size_t nofClipped = newTriangles.size();
+                clip(newTriangles, primitiveTriangle);
+                PIPELINE_STATISTICS_ADD(culledPrimitives, newTriangles.size() == nofClipped);
+            }
+            PIPELINE_STATISTICS_ADD(clippingInputPrimitives, primitiveTriangles.size());
+            PIPELINE_STATISTICS_ADD(clippingOutputPrimitives, newTriangles.size());
+            TRACE_COUNTER("triangles", (int64_t) newTriangles.size(), drawId);
+            stageDone(PipelineStage::CLIPPING);
+
+            /*---NDC---*/
+            for (auto & primitiveTriangle: newTriangles)
+                ndc(primitiveTriangle);
+
+            /*---VIEWPORT TRANSFORMATION---*/
+            for (auto & primitiveTriangle: newTriangles)
+                viewport_transform(primitiveTriangle);
+            if (faceCulling){
+                size_t const nofTriangles = newTriangles.size();
+                newTriangles.erase(std::remove_if(newTriangles.begin(), newTriangles.end(), isBackFacing), newTriangles.end());
+                PIPELINE_STATISTICS_ADD(backFacingPrimitives, nofTriangles - newTriangles.size());
+            }
+            stageDone(PipelineStage::NDC_VIEWPORT);
+
+            uint64_t nofFragments = 0;
+            uint64_t nofPassed = 0;
+            if (not colorWrites){
+                /*---DEPTH-ONLY RASTERIZATION---*/
+                // no attributes, fragment shader nor colors, covered pixels are tested right away
+                for (auto const & primTri: newTriangles)
+                    nofPassed += rasterizeDepth(primTri, nofFragments);
+                PIPELINE_STATISTICS_ADD(fragmentsRasterized, nofFragments);
+                TRACE_COUNTER("fragments", (int64_t) nofFragments, drawId);
+                stageDone(PipelineStage::RASTERIZATION);
+            }
+            else if (visibility.active){
+                /*---VISIBILITY RASTERIZATION---*/
+                // pixels receive id of the nearest triangle, triangles that won no pixel are not stored
+                for (auto const & primTri: newTriangles){
+                    uint32_t const id = (uint32_t) visibility.triangles.size() + 1;
+                    uint32_t const nofTrianglePassed = rasterizeDepth(primTri, nofFragments, id);
+                    if (nofTrianglePassed != 0)
+                        recordVisibilityTriangle(program, drawId, primTri);
+                    nofPassed += nofTrianglePassed;
+                }
+                PIPELINE_STATISTICS_ADD(fragmentsRasterized, nofFragments);
+                TRACE_COUNTER("fragments", (int64_t) nofFragments, drawId);
+                stageDone(PipelineStage::RASTERIZATION);
+            }
+            else{
+                /*---RASTERIZATION---*/
+                inFragments.clear();
+                for (auto & primTri: newTriangles)
+                    rasterize(program.get(), inFragments, primTri);
+                nofFragments = inFragments.size();
+                PIPELINE_STATISTICS_ADD(fragmentsRasterized, nofFragments);
+                TRACE_COUNTER("fragments", (int64_t) nofFragments, drawId);
+                stageDone(PipelineStage::RASTERIZATION);
+
+                /*---EARLY DEPTH TEST---*/
+                // fragment shader does not change depth, fragments are tested in order before shading
+                passedFragments.clear();
+                for (uint32_t i = 0; i < (uint32_t) inFragments.size(); i++)
+                    if (depthTest(inFragments[i]))
+                        passedFragments.push_back(i);
+                nofPassed = passedFragments.size();
+                stageDone(PipelineStage::OUTPUT_MERGE);
+
+                /*---FRAGMENT PROCESSOR---*/
+                outFragments.resize(passedFragments.size());
+                for (size_t i = 0; i < passedFragments.size(); i++)
+                    program->fragmentShader(outFragments[i], inFragments[passedFragments[i]], program->uniforms);
+                PIPELINE_STATISTICS_ADD(fragmentShaderInvocations, passedFragments.size());
+                stageDone(PipelineStage::FRAGMENT_PROCESSOR);
+
+                /*---COLOR WRITES---*/
+                for (size_t i = 0; i < passedFragments.size(); i++)
+                    writeColor(outFragments[i], inFragments[passedFragments[i]]);
+            }
+            PIPELINE_STATISTICS_ADD(depthTestPassed, nofPassed);
+            PIPELINE_STATISTICS_ADD(depthTestFailed, nofFragments - nofPassed);
+            PIPELINE_STATISTICS_ADD(pixelsWritten, colorWrites or depthWrites ? nofPassed : 0);
+            if (activeQueries[(uint32_t) QueryType::SAMPLES_PASSED] != nullptr)
+                activeQueries[(uint32_t) QueryType::SAMPLES_PASSED]->result += nofPassed;
+            if (activeQueries[(uint32_t) QueryType::ANY_SAMPLES_PASSED] != nullptr and nofPassed != 0)
+                activeQueries[(uint32_t) QueryType::ANY_SAMPLES_PASSED]->result = 1;
+            stageDone(PipelineStage::OUTPUT_MERGE);
+        }
+    }
 
-    /*---VERTEX PROCESSOR---*/
-    vertexProcessor(nofVertices, outAbstractVertices, program);
+#ifdef ENABLE_PIPELINE_STATISTICS
+    frameStatistics += drawStatistics;
+#endif
+    frameStageTimings += drawStageTimings;
+}
 
-    /*---PRIMITIVE ASSEMBLY---*/
-    for (int i = 0; i < nofVertices / 3; i++)
-        primitiveTriangles.push_back(PrimitiveTriangle{outAbstractVertices[i * 3],
-                                                       outAbstractVertices[i * 3 + 1],
-                                                       outAbstractVertices[i * 3 + 2]});
-    delete[] outAbstractVertices;
+/**
+ * @brief Looks up vertex puller and its buffers for a draw batch and waits for uploads into the buffers.
+ * Attribute fetches and decoders of encoded buffers are selected here, so they are shared by all commands and instances.
+ *
+ * @param vao vertex puller id
+ *
+ * @return vertex puller with buffers that stay alive as long as the returned value
+ */
+DrawVertexPuller GPU::lookupDrawVertexPuller(VertexPullerID vao){
+    DrawVertexPuller vertexPuller;
+    vertexPuller.settings = getVertexPuller(vao);
+    if (vertexPuller.settings == nullptr)
+        throw std::range_error("Vertex puller or Program is NULL, which it cannot be.");
+    Vertex_puller_settings const &settings = *vertexPuller.settings;
+    if (settings.indexing.enabled){
+        vertexPuller.indexBuffer = getBuffer(settings.indexing.buffer_id);
+        if (vertexPuller.indexBuffer != nullptr){
+            if (vertexPuller.indexBuffer->mapped and not (vertexPuller.indexBuffer->mapFlags & mapPersistent))
+                throw std::range_error("Index buffer is mapped.");
+            waitForUploads(*vertexPuller.indexBuffer);
+        }
+    }
+    for (uint32_t k = 0; k < maxAttributes; k++){
+        auto &headBuffer = vertexPuller.headBuffers[k];
+        headBuffer = settings.heads[k].enabled ? getBuffer(settings.heads[k].buffer_id) : nullptr;
+        if (headBuffer == nullptr)
+            continue;
+        if (headBuffer->mapped and not (headBuffer->mapFlags & mapPersistent))
+            throw std::range_error("Vertex buffer is mapped.");
+        waitForUploads(*headBuffer);
+        auto const & head = settings.heads[k];
+        vertexPuller.headData[k] = headBuffer->data + head.offset;
+        vertexPuller.headFetch[k] = getAttributeFetch(head.format, head.attrib_type);
+        if (headBuffer->encoding != BufferEncoding::VERTEX){
+            uint64_t const attributeEnd = head.offset + attributeSize(head.format, head.attrib_type);
+            uint64_t &elements = vertexPuller.headElements[k];
+            elements = attributeEnd > headBuffer->size ? 0 : head.stride == 0 ? 0x100000000ull
+                                                                                : (headBuffer->size - attributeEnd) / head.stride + 1;
+            if (head.divisor == 0)
+                vertexPuller.vertexLimit = std::min(vertexPuller.vertexLimit, elements);
+            continue;
+        }
+        // heads reading the same encoded buffer share its decoded blocks
+        auto & headCache = vertexPuller.headCaches[k];
+        for (uint32_t j = 0; j < k and headCache == nullptr; j++)
+            if (vertexPuller.headBuffers[j] == headBuffer)
+                headCache = vertexPuller.headCaches[j];
+        if (headCache == nullptr)
+            headCache = std::make_shared<VertexBlockCache>(headBuffer->data, headBuffer->size);
+        if (head.stride != headCache->vertexSize or head.offset + attributeSize(head.format, head.attrib_type) > head.stride)
+            throw std::range_error("Head of encoded vertex buffer has to read within one vertex.");
+        vertexPuller.headElements[k] = headCache->nofVertices;
+        if (head.divisor == 0)
+            vertexPuller.vertexLimit = std::min<uint64_t>(vertexPuller.vertexLimit, headCache->nofVertices);
+    }
+    if (settings.meshlets.count != 0)
+        vertexPuller.meshletBuffer = getBuffer(settings.meshlets.buffer_id);
+    return vertexPuller;
+}
 
-    /*---CLIPPING---*/
-    int x = 0, y = 1, z = 2, w = 3;
-    std::vector<PrimitiveTriangle> newTriangles ;
-    for (auto primitiveTriangle : primitiveTriangles)
-        clip(newTriangles, primitiveTriangle);
+/**
+ * @brief Checks that draw command reads only inside of index buffer and buffers of enabled heads.
+ * Checks do not read indices, vertex processor checks each index against vertexLimit when it reads it.
+ *
+ * @param vertexPuller vertex puller of draw
+ * @param command draw command
+ */
+void GPU::validateDrawCommand(DrawVertexPuller const &vertexPuller, DrawCommand const &command){
+    if (command.count == 0 or command.instanceCount == 0)
+        return;
+    Buffer const *indexBuffer = vertexPuller.indexBuffer.get();
+    uint64_t const lastIndex = (uint64_t) command.firstIndex + command.count;
+    if (indexBuffer != nullptr){
+        uint64_t const nofIndices = indexBuffer->encoding == BufferEncoding::INDEX ? encodedIndexCount(indexBuffer->data, indexBuffer->size)
+                                  : indexBuffer->size / (uint32_t) vertexPuller.settings->indexing.index_type;
+        if (lastIndex > nofIndices)
+            throw std::range_error("Draw command reads indices out of index buffer.");
+    }
+    else if (lastIndex - 1 > 0xffffffffull)
+        throw std::range_error("Draw command reads vertices out of range.");
+    else if (lastIndex > vertexPuller.vertexLimit)
+        throw std::range_error("Draw command reads vertices out of vertex buffer.");
+
+    for (uint32_t k = 0; k < maxAttributes; k++){
+        auto const &head = vertexPuller.settings->heads[k];
+        if (vertexPuller.headBuffers[k] == nullptr or head.divisor == 0)
+            continue;
+        uint64_t const element = (command.instanceCount - 1) / head.divisor + (uint64_t) command.baseInstance;
+        if (element >= vertexPuller.headElements[k])
+            throw std::range_error("Draw command reads vertices out of vertex buffer.");
+    }
+}
+
+/**
+ * @brief This function draws a batch of draw commands stored in GPU buffer.
+ *
+ * @param buffer buffer with DrawCommand records
+ * @param offset offset of the first record in bytes
+ * @param nofCommands number of records
+ * @param stride distance between records in bytes, 0 means tightly packed records
+ */
+void GPU::multiDrawTrianglesIndirect(BufferID buffer,uint64_t offset,uint32_t nofCommands,uint64_t stride){
+    if (not isBuffer(buffer))
+        throw std::range_error("Indirect buffer is not valid.");
+    if (stride == 0)
+        stride = sizeof(DrawCommand);
+    std::vector<DrawCommand> commands(nofCommands);
+    for (uint32_t c = 0; c < nofCommands; c++)
+        getBufferData(buffer, offset + c * stride, sizeof(DrawCommand), &commands[c]);
+    multiDrawTriangles(commands.data(), nofCommands);
+}
 
-    /*---NDC---*/
-    for (auto & primitiveTriangle: newTriangles)
-        ndc(primitiveTriangle);
+/**
+ * @brief This function returns pipeline statistics of the last draw call.
+ *
+ * @return statistics of the last drawTriangles call
+ */
+PipelineStatistics GPU::getDrawStatistics() const {
+    return drawStatistics;
+}
 
-    /*---VIEWPORT TRANSFORMATION---*/
-    for (auto & primitiveTriangle: newTriangles)
-        viewport_transform(primitiveTriangle);
+/**
+ * @brief This function returns pipeline statistics accumulated over all draw calls since the last resetFrameStatistics.
+ *
+ * @return statistics of the current frame
+ */
+PipelineStatistics GPU::getFrameStatistics() const {
+    return frameStatistics;
+}
 
-    /*---RASTERIZATION---*/
-    std::vector<InFragment> inFragments;
-    OutFragment outFragment{};
-    for (auto & primTri: newTriangles)
-        rasterize(program, inFragments, primTri);
-
-    /*---FRAGMENT PROCESSOR + DEPTH CORRECTION---*/
-    for (auto inFragment: inFragments){
-        program->fragmentShader(outFragment, inFragment, program->uniforms);
-        depth_correction(outFragment, inFragment);
+/**
+ * @brief This function returns wall time spent in each stage of the last draw call.
+ *
+ * @return stage timings of the last drawTriangles call
+ */
+StageTimings GPU::getDrawStageTimings() const {
+    return drawStageTimings;
+}
+
+/**
+ * @brief This function returns wall time spent in each stage accumulated since the last resetFrameStatistics.
+ *
+ * @return stage timings of the current frame
+ */
+StageTimings GPU::getFrameStageTimings() const {
+    return frameStageTimings;
+}
+
+/**
+ * @brief This function resets pipeline statistics and stage timings of the frame, it should be called at the beginning of each frame.
+ */
+void GPU::resetFrameStatistics(){
+    frameStatistics = PipelineStatistics{};
+    frameStageTimings = StageTimings{};
+}
+
+/**
+ * @brief Returns time spent in selected stage.
+ * @param stage pipeline stage
+ * @return reference to time in seconds
+ */
+double &StageTimings::operator[](PipelineStage stage){
+    return stages[(uint32_t) stage];
+}
+
+/**
+ * @brief Sums time spent in all stages.
+ * @return time in seconds
+ */
+double StageTimings::total() const {
+    double sum = 0.0;
+    for (double stage : stages)
+        sum += stage;
+    return sum;
+}
+
+/**
+ * @brief Adds times of other timings to this timings.
+ * @param other timings to add
+ * @return reference to this timings
+ */
+StageTimings &StageTimings::operator+=(StageTimings const &other){
+    for (uint32_t i = 0; i < nofPipelineStages; i++)
+        stages[i] += other.stages[i];
+    return *this;
+}
+
+/**
+ * @brief Returns human readable name of pipeline stage.
+ * @param stage pipeline stage
+ * @return name of the stage
+ */
+char const *pipelineStageName(PipelineStage stage){
+    switch (stage){
+        case PipelineStage::VERTEX_PROCESSOR:   return "vertex processor";
+        case PipelineStage::PRIMITIVE_ASSEMBLY: return "primitive assembly";
+        case PipelineStage::CLIPPING:           return "clipping";
+        case PipelineStage::NDC_VIEWPORT:       return "ndc + viewport";
+        case PipelineStage::RASTERIZATION:      return "rasterization";
+        case PipelineStage::FRAGMENT_PROCESSOR: return "fragment processor";
+        case PipelineStage::OUTPUT_MERGE:       return "output merge";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Prints pipeline statistics, one counter per line.
+ * @param stream output stream
+ * @param statistics statistics to print
+ */
+void printPipelineStatistics(std::ostream &stream, PipelineStatistics const &statistics){
+    stream << "vertices fetched            : " << statistics.verticesFetched           << std::endl;
+    stream << "vertex shader invocations   : " << statistics.vertexShaderInvocations   << std::endl;
+    stream << "clipping input primitives   : " << statistics.clippingInputPrimitives   << std::endl;
+    stream << "clipping output primitives  : " << statistics.clippingOutputPrimitives  << std::endl;
+    stream << "culled primitives           : " << statistics.culledPrimitives          << std::endl;
+    stream << "fragments rasterized        : " << statistics.fragmentsRasterized       << std::endl;
+    stream << "fragment shader invocations : " << statistics.fragmentShaderInvocations << std::endl;
+    stream << "depth test passed           : " << statistics.depthTestPassed           << std::endl;
+    stream << "depth test failed           : " << statistics.depthTestFailed           << std::endl;
+    stream << "pixels written              : " << statistics.pixelsWritten             << std::endl;
+    stream << "meshlets tested             : " << statistics.meshletsTested            << std::endl;
+    stream << "meshlets frustum culled     : " << statistics.meshletsFrustumCulled     << std::endl;
+    stream << "meshlets cone culled        : " << statistics.meshletsConeCulled        << std::endl;
+    stream << "back-facing primitives      : " << statistics.backFacingPrimitives      << std::endl;
+    stream << "draws tested                : " << statistics.drawsTested               << std::endl;
+    stream << "draws culled                : " << statistics.drawsCulled               << std::endl;
+    stream << "draws conditionally skipped : " << statistics.drawsConditionalSkipped   << std::endl;
+    stream << "visibility triangles        : " << statistics.visibilityTriangles       << std::endl;
+}
+
+/**
+ * @brief Prints time spent in each pipeline stage in milliseconds together with its share of the total time.
+ * @param stream output stream
+ * @param timings timings to print
+ */
+void printStageTimings(std::ostream &stream, StageTimings const &timings){
+    double total = timings.total();
+    for (uint32_t i = 0; i < nofPipelineStages; i++){
+        double share = total > 0.0 ? timings.stages[i] / total * 100.0 : 0.0;
+        stream << std::left << std::setw(20) << pipelineStageName((PipelineStage) i) << ": "
+               << std::right << std::fixed << std::setprecision(3) << std::setw(10) << timings.stages[i] * 1000.0 << " ms "
+               << std::setprecision(1) << std::setw(5) << share << " %" << std::endl;
+    }
+    stream << std::left << std::setw(20) << "total" << ": "
+           << std::right << std::fixed << std::setprecision(3) << std::setw(10) << total * 1000.0 << " ms" << std::endl;
+    stream << std::defaultfloat;
+}
+
+/**
+ * @brief This function creates fence, it is signaled when all asynchronous uploads issued so far are complete.
+ *
+ * @return sync object id
+ */
+SyncID GPU::fenceSync(){
+    auto sync = std::make_shared<Sync>();
+    sync->sequence = uploadQueue.lastQueued();
+    return syncs.insert(std::move(sync));
+}
+
+/**
+ * @brief This function waits for fence.
+ *
+ * @param sync sync object id
+ * @param timeout maximal waiting time in nanoseconds, 0 only tests the fence, timeoutIgnored waits until it is signaled
+ *
+ * @return status of the fence
+ */
+SyncStatus GPU::clientWaitSync(SyncID sync,uint64_t timeout){
+    auto const object = syncs.get(sync);
+    if (object == nullptr)
+        return SyncStatus::WAIT_FAILED;
+    uint64_t const sequence = object->sequence;
+    if (uploadQueue.isComplete(sequence))
+        return SyncStatus::ALREADY_SIGNALED;
+    TRACE_SCOPE("clientWaitSync", "gpu");
+    return uploadQueue.wait(sequence, timeout) ? SyncStatus::CONDITION_SATISFIED : SyncStatus::TIMEOUT_EXPIRED;
+}
+
+/**
+ * @brief This function deletes sync object.
+ *
+ * @param sync sync object id
+ */
+void GPU::deleteSync(SyncID sync){
+    syncs.erase(sync);
+}
+
+/**
+ * @brief This function tests if sync object exists.
+ *
+ * @param sync sync object id
+ *
+ * @return true if sync object exists
+ */
+bool GPU::isSync(SyncID sync){
+    return syncs.contains(sync);
+}
+
+/**
+ * @brief This function creates new query object.
+ *
+ * @return query object id
+ */
+QueryID GPU::createQuery(){
+    return queries.insert(std::make_shared<Query>());
+}
+
+/**
+ * @brief This function deletes query object.
+ * Active query or query used by conditional rendering stays alive until endQuery or endConditionalRender.
+ *
+ * @param query query object id
+ */
+void GPU::deleteQuery(QueryID query){
+    queries.erase(query);
+}
+
+/**
+ * @brief This function starts query, commands issued until endQuery are measured by it.
+ * Occlusion queries (SAMPLES_PASSED, ANY_SAMPLES_PASSED) count fragments of draws that pass depth test,
+ * with colorMask and depthMask disabled they test visibility without changing framebuffer.
+ *
+ * @param type type of query
+ * @param query query object id
+ */
+void GPU::beginQuery(QueryType type, QueryID query){
+    auto tmp = queries.get(query);
+    if (tmp == nullptr)
+        throw std::range_error("Query does not exist.");
+    if (activeQueries[(uint32_t) type] != nullptr)
+        throw std::range_error("Query of this type is already active.");
+    // one query object cannot measure two types at once, restart would reset its running result
+    if (tmp->active)
+        throw std::range_error("Query is already active.");
+    tmp->type = type;
+    tmp->result = 0;
+    tmp->active = true;
+    tmp->timer.reset();
+    activeQueries[(uint32_t) type] = tmp;
+}
+
+/**
+ * @brief This function stops active query of given type and stores its result.
+ *
+ * @param type type of query
+ */
+void GPU::endQuery(QueryType type){
+    auto const &query = activeQueries[(uint32_t) type];
+    if (query == nullptr)
+        throw std::range_error("No query of this type is active.");
+    if (type == QueryType::TIME_ELAPSED)
+        query->result = (uint64_t) (query->timer.elapsedFromStart() * 1e9);
+    query->active = false;
+    activeQueries[(uint32_t) type] = nullptr;
+}
+
+/**
+ * @brief This function returns result of query object.
+ *
+ * @param query query object id
+ *
+ * @return result of the query (nanoseconds for TIME_ELAPSED, fragments for SAMPLES_PASSED, 0 or 1 for ANY_SAMPLES_PASSED)
+ */
+uint64_t GPU::getQueryResult(QueryID query){
+    auto const object = queries.get(query);
+    if (object == nullptr)
+        return 0;
+    return object->result;
+}
+
+/**
+ * @brief This function tests if query object exists.
+ *
+ * @param query query object id
+ *
+ * @return true, if query object "query" exists
+ */
+bool GPU::isQuery(QueryID query){
+    return queries.contains(query);
+}
+
+/**
+ * @brief This function starts conditional rendering, draws are skipped until endConditionalRender
+ * if result of occlusion query is 0. Results are always available, draws never wait.
+ *
+ * @param query ended occlusion query object id
+ */
+void GPU::beginConditionalRender(QueryID query){
+    auto tmp = queries.get(query);
+    if (tmp == nullptr)
+        throw std::range_error("Query does not exist.");
+    if (tmp->active or tmp->type == QueryType::TIME_ELAPSED)
+        throw std::range_error("Conditional rendering needs ended occlusion query.");
+    if (conditionQuery != nullptr)
+        throw std::range_error("Conditional rendering is already active.");
+    conditionQuery = tmp;
+}
+
+/**
+ * @brief This function ends conditional rendering.
+ */
+void GPU::endConditionalRender(){
+    if (conditionQuery == nullptr)
+        throw std::range_error("Conditional rendering is not active.");
+    conditionQuery = nullptr;
+}
+
+/**
+ * @brief This function starts visibility buffer, draws until resolveVisibilityBuffer do depth test
+ * and write id of the nearest triangle into each pixel, fragment shaders are not executed.
+ * Triangles keep positions and attributes after vertex shader, draws keep program and uniforms.
+ */
+void GPU::beginVisibilityBuffer(){
+    if (visibility.active)
+        throw std::range_error("Visibility buffer is already active.");
+    visibility.width = frameBuffer->width;
+    visibility.height = frameBuffer->height;
+    visibility.ids.assign((size_t) visibility.width * visibility.height, 0);
+    visibility.active = true;
+}
+
+/**
+ * @brief This function shades visibility buffer and ends it.
+ * Barycentric coordinates of each covered pixel are computed again from stored triangle, attributes are interpolated
+ * and fragment shader of the draw of triangle runs once per pixel.
+ */
+void GPU::resolveVisibilityBuffer(){
+    if (not visibility.active)
+        throw std::range_error("Visibility buffer is not active.");
+    if (visibility.width != frameBuffer->width or visibility.height != frameBuffer->height){
+        visibility = VisibilityBuffer{};
+        throw std::range_error("Framebuffer was resized while visibility buffer was active.");
+    }
+    uint32_t drawId = drawCounter++;
+    TRACE_DRAW_SCOPE("resolveVisibilityBuffer", "gpu", drawId);
+#ifdef ENABLE_PIPELINE_STATISTICS
+    drawStatistics = PipelineStatistics{};
+#endif
+    drawStageTimings = StageTimings{};
+    Timer<double> stageTimer;
+
+    uint32_t const width = visibility.width;
+    uint32_t const height = visibility.height;
+    PrimitiveTriangle primTri;
+    VisibilityDraw const *draw = nullptr;
+    float area = 0.f;
+    uint32_t lastId = 0;
+    InFragment inFragment;
+    OutFragment outFragment;
+    uint64_t nofShaded = 0;
+    for (uint32_t y = 0; y < height; y++){
+        for (uint32_t x = 0; x < width; x++){
+            uint32_t const id = visibility.ids[(size_t) y * width + x];
+            if (id == 0)
+                continue;
+            // neighbouring pixels mostly belong to the same triangle, it is unpacked only when id changes
+            if (id != lastId){
+                VisibilityTriangle const &triangle = visibility.triangles[id - 1];
+                draw = &visibility.draws[triangle.draw];
+                OutAbstractVertex *vertices[3] = {&primTri.ov1, &primTri.ov2, &primTri.ov3};
+                for (uint32_t v = 0; v < 3; v++){
+                    vertices[v]->ov.gl_Position = triangle.position[v];
+                    for (uint32_t a = 0; a < draw->nofAttributes; a++)
+                        vertices[v]->ov.attributes[draw->attributes[a]] =
+                            visibility.attributes[triangle.firstAttribute + v * draw->nofAttributes + a];
+                }
+                area = triangleSurface(primTri.ov1, primTri.ov2, primTri.ov3);
+                lastId = id;
+            }
+            glm::vec4 const pixelCenter = glm::vec4{x + 0.5, y + 0.5, 0, 1};
+            glm::vec4 const &a = primTri.ov1.ov.gl_Position;
+            glm::vec4 const &b = primTri.ov2.ov.gl_Position;
+            glm::vec4 const &c = primTri.ov3.ov.gl_Position;
+            float const w0 = triangleSurface(b[0], b[1], c[0], c[1], pixelCenter[0], pixelCenter[1]);
+            float const w1 = triangleSurface(c[0], c[1], a[0], a[1], pixelCenter[0], pixelCenter[1]);
+            float const w2 = triangleSurface(a[0], a[1], b[0], b[1], pixelCenter[0], pixelCenter[1]);
+            interpolateFragment(inFragment, draw->program.get(), primTri, pixelCenter, w0, w1, w2, area);
+            draw->program->fragmentShader(outFragment, inFragment, draw->uniforms);
+            writeColor(outFragment, inFragment);
+            nofShaded++;
+        }
     }
+    PIPELINE_STATISTICS_ADD(fragmentShaderInvocations, nofShaded);
+    drawStageTimings[PipelineStage::FRAGMENT_PROCESSOR] += stageTimer.elapsedFromLast();
+
+    visibility = VisibilityBuffer{};
+#ifdef ENABLE_PIPELINE_STATISTICS
+    frameStatistics += drawStatistics;
+#endif
+    frameStageTimings += drawStageTimings;
+}
+
+/**
+ * @brief Adds counters of other statistics to this statistics.
+ * @param other statistics to add
+ * @return reference to this statistics
+ */
+PipelineStatistics &PipelineStatistics::operator+=(PipelineStatistics const &other){
+    verticesFetched           += other.verticesFetched;
+    vertexShaderInvocations   += other.vertexShaderInvocations;
+    clippingInputPrimitives   += other.clippingInputPrimitives;
+    clippingOutputPrimitives  += other.clippingOutputPrimitives;
+    culledPrimitives          += other.culledPrimitives;
+    fragmentsRasterized       += other.fragmentsRasterized;
+    fragmentShaderInvocations += other.fragmentShaderInvocations;
+    depthTestPassed           += other.depthTestPassed;
+    depthTestFailed           += other.depthTestFailed;
+    pixelsWritten             += other.pixelsWritten;
+    meshletsTested            += other.meshletsTested;
+    meshletsFrustumCulled     += other.meshletsFrustumCulled;
+    meshletsConeCulled        += other.meshletsConeCulled;
+    backFacingPrimitives      += other.backFacingPrimitives;
+    drawsTested               += other.drawsTested;
+    drawsCulled               += other.drawsCulled;
+    drawsConditionalSkipped   += other.drawsConditionalSkipped;
+    visibilityTriangles       += other.visibilityTriangles;
+    return *this;
 }
 
 /**
  * @brief Function does clipping of Primitive triangle.
  * If any of vertices lays outside of near plane, then new one or two PrimitiveTriangles are created.
+ * New triangles keep the order of vertices of the clipped triangle, so face culling after clipping sees the same winding.
  * @param newTriangles vector of new PrimitiveTriangles
  * @param primitiveTriangle actual processed PrimitiveTriangle
  */
@@ -676,10 +1800,10 @@ void clip(std::vector<PrimitiveTriangle> &newTriangles, const PrimitiveTriangle
     }
     else if (not aIsOut and bIsOut and not cIsOut){  //aBc
         n1 = getEdgePoint(b, a);
-        newTriangles.push_back(PrimitiveTriangle{a, c, n1});
+        newTriangles.push_back(PrimitiveTriangle{a, n1, c});
 
         n2 = getEdgePoint(c, b);
-        newTriangles.push_back(PrimitiveTriangle{c, n2, n1});
+        newTriangles.push_back(PrimitiveTriangle{n1, n2, c});
     }
     else if (not aIsOut and not bIsOut and cIsOut){  //abC
         n1 = getEdgePoint(c, a);
@@ -691,27 +1815,52 @@ void clip(std::vector<PrimitiveTriangle> &newTriangles, const PrimitiveTriangle
     else if (aIsOut and bIsOut and not cIsOut) //ABc
         newTriangles.push_back(PrimitiveTriangle{getEdgePoint(c, a), getEdgePoint(c, b), c});
     else if (not aIsOut and bIsOut and cIsOut) //aBC
-        newTriangles.push_back(PrimitiveTriangle{getEdgePoint(c, a), getEdgePoint(c, b), a});
+        newTriangles.push_back(PrimitiveTriangle{a, getEdgePoint(a, b), getEdgePoint(c, a)});
     else if (aIsOut and not bIsOut and cIsOut) //AbC
-        newTriangles.push_back(PrimitiveTriangle{getEdgePoint(c, a), getEdgePoint(c, b), b});
+        newTriangles.push_back(PrimitiveTriangle{getEdgePoint(a, b), b, getEdgePoint(b, c)});
 }
 
 /**
  * @brief Triangles which are nearer to camera should be drawn over the ones which are deeper in space.
  * @param outFragment OutFragment contains color values
  * @param inFragment InFragment contains depth value
+ * @return true if fragment passed depth test and was written into framebuffer
  */
-void GPU::depth_correction(const OutFragment &outFragment, const InFragment &inFragment) const {
-    int x = 0, y = 1, z = 2;
-    unsigned int actDepthPosition = ((int)inFragment.gl_FragCoord[y] * frameBuffer->width + (int)inFragment.gl_FragCoord[x]);
-    unsigned int actColorPositon = (((int)inFragment.gl_FragCoord[y] * frameBuffer->width + (int)inFragment.gl_FragCoord[x]) * 4);
-    if (frameBuffer->depthBuffer[actDepthPosition] > inFragment.gl_FragCoord[z]){
-        frameBuffer->depthBuffer[actDepthPosition] = inFragment.gl_FragCoord[z];
-        frameBuffer->colorBuffer[actColorPositon] = denormalize_color(outFragment.gl_FragColor[0], 255, true);
-        frameBuffer->colorBuffer[actColorPositon + 1] = denormalize_color(outFragment.gl_FragColor[1], 255, true);
-        frameBuffer->colorBuffer[actColorPositon + 2] = denormalize_color(outFragment.gl_FragColor[2], 255, true);
-        frameBuffer->colorBuffer[actColorPositon + 3] = denormalize_color(outFragment.gl_FragColor[3], 255, true);
-    }
+bool GPU::depth_correction(const OutFragment &outFragment, const InFragment &inFragment) const {
+    if (not depthTest(inFragment))
+        return false;
+    writeColor(outFragment, inFragment);
+    return true;
+}
+
+/**
+ * @brief Function compares depth of fragment with the stored depth by depth function and writes depth of passed fragment.
+ * Fragment shader cannot change depth, so the test runs before it.
+ * @param inFragment fragment with window coordinates
+ * @return true if fragment passed depth test
+ */
+bool GPU::depthTest(const InFragment &inFragment) const {
+    float &depth = frameBuffer->depthBuffer[(int)inFragment.gl_FragCoord[1] * frameBuffer->width + (int)inFragment.gl_FragCoord[0]];
+    float const z = inFragment.gl_FragCoord[2];
+    bool const passed = depthFunction == DepthFunction::LESS ? depth > z : depthFunction == DepthFunction::LEQUAL ? depth >= z : depth == z;
+    if (passed and depthWrites)
+        depth = z;
+    return passed;
+}
+
+/**
+ * @brief Function writes color of fragment that passed depth test.
+ * @param outFragment fragment with color
+ * @param inFragment fragment with window coordinates
+ */
+void GPU::writeColor(const OutFragment &outFragment, const InFragment &inFragment) const {
+    if (not colorWrites)
+        return;
+    unsigned int actColorPositon = (((int)inFragment.gl_FragCoord[1] * frameBuffer->width + (int)inFragment.gl_FragCoord[0]) * 4);
+    frameBuffer->colorBuffer[actColorPositon] = denormalize_color(outFragment.gl_FragColor[0], 255, true);
+    frameBuffer->colorBuffer[actColorPositon + 1] = denormalize_color(outFragment.gl_FragColor[1], 255, true);
+    frameBuffer->colorBuffer[actColorPositon + 2] = denormalize_color(outFragment.gl_FragColor[2], 255, true);
+    frameBuffer->colorBuffer[actColorPositon + 3] = denormalize_color(outFragment.gl_FragColor[3], 255, true);
 }
 
 /**
@@ -753,6 +1902,44 @@ void ndc(PrimitiveTriangle &primitiveTriangle){
     }
 }
 
+/**
+ * @brief This method represents Primitive Assembly. It groups processed vertices into triangles according to topology.
+ * Vertices at restartPositions split the vertices into independent strips/fans (lists).
+ * @param primitiveTriangles output triangles
+ * @param outAbstractVertices processed vertices
+ * @param nofVertices number of processed vertices
+ */
+void GPU::primitiveAssembly(std::vector<PrimitiveTriangle> &primitiveTriangles, const OutAbstractVertex *outAbstractVertices, uint32_t nofVertices) const {
+    uint32_t start = 0;
+    for (size_t r = 0; r <= restartPositions.size(); r++) {
+        uint32_t const end = r < restartPositions.size() ? restartPositions[r] : nofVertices;
+        OutAbstractVertex const *v = outAbstractVertices + start;
+        uint32_t const count = end - start;
+        switch (topology) {
+            case Topology::TRIANGLES:{
+                for (uint32_t i = 0; i + 2 < count; i += 3)
+                    primitiveTriangles.push_back(PrimitiveTriangle{v[i], v[i + 1], v[i + 2]});
+                break;
+            }
+            case Topology::TRIANGLE_STRIP:{
+                // every odd triangle swaps its first two vertices to keep the winding of the strip
+                for (uint32_t i = 0; i + 2 < count; i++)
+                    if (i % 2 == 0)
+                        primitiveTriangles.push_back(PrimitiveTriangle{v[i], v[i + 1], v[i + 2]});
+                    else
+                        primitiveTriangles.push_back(PrimitiveTriangle{v[i + 1], v[i], v[i + 2]});
+                break;
+            }
+            case Topology::TRIANGLE_FAN:{
+                for (uint32_t i = 1; i + 1 < count; i++)
+                    primitiveTriangles.push_back(PrimitiveTriangle{v[0], v[i], v[i + 1]});
+                break;
+            }
+        }
+        start = end + 1;
+    }
+}
+
 /**
  * @brief Function rasterizes PrimitiveTriangle and store it into vector of InFragments.
  * @param program program with shaders
@@ -760,7 +1947,7 @@ void ndc(PrimitiveTriangle &primitiveTriangle){
  * @param primTri PrimitiveTriangle to rasterize
  */
 void GPU::rasterize(const Program *program, std::vector<InFragment> &inFragments, const PrimitiveTriangle &primTri) {
-    int x = 0, y = 1, z = 2, w = 3;
+    int x = 0, y = 1;
     OutAbstractVertex vertexA = primTri.ov1;
     OutAbstractVertex vertexB = primTri.ov2;
     OutAbstractVertex vertexC = primTri.ov3;
@@ -805,52 +1992,7 @@ void GPU::rasterize(const Program *program, std::vector<InFragment> &inFragments
             // If actual pixel is in triangle do rasterization
             if (isInTriangle) {
                 InFragment tmp;
-                tmp.gl_FragCoord = pixelSample.ov.gl_Position;
-                float l0 = w0 / area;
-                float l1 = w1 / area;
-                float l2 = w2 / area;
-                float numerator = vertexA.ov.gl_Position[z] * l0 / vertexA.ov.gl_Position[w] +
-                                  vertexB.ov.gl_Position[z] * l1 / vertexB.ov.gl_Position[w] +
-                                  vertexC.ov.gl_Position[z] * l2 / vertexC.ov.gl_Position[w];
-                float denominator = l0 / vertexA.ov.gl_Position[w] +
-                                    l1 / vertexB.ov.gl_Position[w] +
-                                    l2 / vertexC.ov.gl_Position[w];
-                tmp.gl_FragCoord[z] = numerator / denominator;
-
-                numerator = vertexA.ov.gl_Position[w] * l0 / vertexA.ov.gl_Position[w] +
-                                  vertexB.ov.gl_Position[w] * l1 / vertexB.ov.gl_Position[w] +
-                                  vertexC.ov.gl_Position[w] * l2 / vertexC.ov.gl_Position[w];
-                tmp.gl_FragCoord[w] = numerator / denominator;
-
-                for (int i = 0; i < maxAttributes; i++){
-                    denominator = l0 / vertexA.ov.gl_Position[w] +
-                                  l1 / vertexB.ov.gl_Position[w] +
-                                  l2 / vertexC.ov.gl_Position[w];
-                    switch (program->attributeType[i]){
-                        case AttributeType::FLOAT:
-                            tmp.attributes[i].v1 = (vertexA.ov.attributes[i].v1 * l0 / vertexA.ov.gl_Position[w] +
-                                                    vertexB.ov.attributes[i].v1 * l1 / vertexB.ov.gl_Position[w] +
-                                                    vertexC.ov.attributes[i].v1 * l2 / vertexC.ov.gl_Position[w])
-                                                   / denominator;
-                        case AttributeType::VEC2:
-                            tmp.attributes[i].v2 = (vertexA.ov.attributes[i].v2 * l0 / vertexA.ov.gl_Position[w] +
-                                                    vertexB.ov.attributes[i].v2 * l1 / vertexB.ov.gl_Position[w] +
-                                                    vertexC.ov.attributes[i].v2 * l2 / vertexC.ov.gl_Position[w])
-                                                   / denominator;
-                        case AttributeType::VEC3:
-                            tmp.attributes[i].v3 = (vertexA.ov.attributes[i].v3 * l0 / vertexA.ov.gl_Position[w] +
-                                                    vertexB.ov.attributes[i].v3 * l1 / vertexB.ov.gl_Position[w] +
-                                                    vertexC.ov.attributes[i].v3 * l2 / vertexC.ov.gl_Position[w])
-                                                   / denominator;
-                        case AttributeType::VEC4:
-                            tmp.attributes[i].v4 = (vertexA.ov.attributes[i].v4 * l0 / vertexA.ov.gl_Position[w] +
-                                                    vertexB.ov.attributes[i].v4 * l1 / vertexB.ov.gl_Position[w] +
-                                                    vertexC.ov.attributes[i].v4 * l2 / vertexC.ov.gl_Position[w])
-                                                   / denominator;
-                        default:
-                            break;
-                    }
-                }
+                interpolateFragment(tmp, program, primTri, pixelSample.ov.gl_Position, w0, w1, w2, area);
                 inFragments.push_back(tmp);
             }
             prevPixelOut = not isInTriangle;
@@ -859,67 +2001,442 @@ void GPU::rasterize(const Program *program, std::vector<InFragment> &inFragments
 }
 
 /**
- * @brief This method represents Vertex Processor. It processes each vertex from InVertex to OutVertex.
- * @param nofVertices number of vertices to process
+ * @brief Function computes window coordinates and perspective correct attributes of fragment inside of triangle.
+ * It is shared by rasterize and resolve of visibility buffer, so both produce the same fragments.
+ * @param fragment output fragment
+ * @param program program with types of attributes
+ * @param primTri triangle in window coordinates
+ * @param pixelCenter center of pixel (x, y, 0, 1)
+ * @param w0 area of triangle opposite to the first vertex
+ * @param w1 area of triangle opposite to the second vertex
+ * @param w2 area of triangle opposite to the third vertex
+ * @param area area of triangle
+ */
+void interpolateFragment(InFragment &fragment, const Program *program, const PrimitiveTriangle &primTri,
+                         glm::vec4 const &pixelCenter, float w0, float w1, float w2, float area) {
+    int z = 2, w = 3;
+    OutAbstractVertex const &vertexA = primTri.ov1;
+    OutAbstractVertex const &vertexB = primTri.ov2;
+    OutAbstractVertex const &vertexC = primTri.ov3;
+    fragment.gl_FragCoord = pixelCenter;
+    float l0 = w0 / area;
+    float l1 = w1 / area;
+    float l2 = w2 / area;
+    float numerator = vertexA.ov.gl_Position[z] * l0 / vertexA.ov.gl_Position[w] +
+                      vertexB.ov.gl_Position[z] * l1 / vertexB.ov.gl_Position[w] +
+                      vertexC.ov.gl_Position[z] * l2 / vertexC.ov.gl_Position[w];
+    float denominator = l0 / vertexA.ov.gl_Position[w] +
+                        l1 / vertexB.ov.gl_Position[w] +
+                        l2 / vertexC.ov.gl_Position[w];
+    fragment.gl_FragCoord[z] = numerator / denominator;
+
+    numerator = vertexA.ov.gl_Position[w] * l0 / vertexA.ov.gl_Position[w] +
+                      vertexB.ov.gl_Position[w] * l1 / vertexB.ov.gl_Position[w] +
+                      vertexC.ov.gl_Position[w] * l2 / vertexC.ov.gl_Position[w];
+    fragment.gl_FragCoord[w] = numerator / denominator;
+
+    for (int i = 0; i < maxAttributes; i++){
+        denominator = l0 / vertexA.ov.gl_Position[w] +
+                      l1 / vertexB.ov.gl_Position[w] +
+                      l2 / vertexC.ov.gl_Position[w];
+        switch (program->attributeType[i]){
+            case AttributeType::FLOAT:
+                fragment.attributes[i].v1 = (vertexA.ov.attributes[i].v1 * l0 / vertexA.ov.gl_Position[w] +
+                                        vertexB.ov.attributes[i].v1 * l1 / vertexB.ov.gl_Position[w] +
+                                        vertexC.ov.attributes[i].v1 * l2 / vertexC.ov.gl_Position[w])
+                                       / denominator;
+            case AttributeType::VEC2:
+                fragment.attributes[i].v2 = (vertexA.ov.attributes[i].v2 * l0 / vertexA.ov.gl_Position[w] +
+                                        vertexB.ov.attributes[i].v2 * l1 / vertexB.ov.gl_Position[w] +
+                                        vertexC.ov.attributes[i].v2 * l2 / vertexC.ov.gl_Position[w])
+                                       / denominator;
+            case AttributeType::VEC3:
+                fragment.attributes[i].v3 = (vertexA.ov.attributes[i].v3 * l0 / vertexA.ov.gl_Position[w] +
+                                        vertexB.ov.attributes[i].v3 * l1 / vertexB.ov.gl_Position[w] +
+                                        vertexC.ov.attributes[i].v3 * l2 / vertexC.ov.gl_Position[w])
+                                       / denominator;
+            case AttributeType::VEC4:
+                fragment.attributes[i].v4 = (vertexA.ov.attributes[i].v4 * l0 / vertexA.ov.gl_Position[w] +
+                                        vertexB.ov.attributes[i].v4 * l1 / vertexB.ov.gl_Position[w] +
+                                        vertexC.ov.attributes[i].v4 * l2 / vertexC.ov.gl_Position[w])
+                                       / denominator;
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Depth-only variant of rasterize, it is used when color writes are disabled (depth prepass, occlusion queries)
+ * and by draws into visibility buffer.
+ * Pixels are covered and depth is interpolated exactly as in rasterize, so EQUAL depth test of a later shading pass
+ * matches, but attributes are not interpolated and fragments are tested against depth buffer right away.
+ * @param primTri PrimitiveTriangle to rasterize
+ * @param nofFragments number of covered pixels is added to it
+ * @param visibilityId value written into visibility buffer by fragments that pass depth test, 0 writes nothing
+ * @return number of fragments that passed depth test
+ */
+uint32_t GPU::rasterizeDepth(const PrimitiveTriangle &primTri, uint64_t &nofFragments, uint32_t visibilityId) {
+    glm::vec4 const &a = primTri.ov1.ov.gl_Position;
+    glm::vec4 const &b = primTri.ov2.ov.gl_Position;
+    glm::vec4 const &c = primTri.ov3.ov.gl_Position;
+    int xmin = std::max((int) std::floor(std::min({a[0], b[0], c[0]})), 0);
+    int xmax = std::min((int) std::ceil (std::max({a[0], b[0], c[0]})), (int) frameBuffer->width);
+    int ymin = std::max((int) std::floor(std::min({a[1], b[1], c[1]})), 0);
+    int ymax = std::min((int) std::ceil (std::max({a[1], b[1], c[1]})), (int) frameBuffer->height);
+
+    float const area = triangleSurface(a[0], a[1], b[0], b[1], c[0], c[1]);
+    float const deviation = 0.000976562;  // the same tolerance as rasterize
+    InFragment fragment;
+    uint32_t nofPassed = 0;
+    for (int x_bound = xmin; x_bound < xmax; ++x_bound) {
+        bool prevPixelOut = true;
+        float const px = x_bound + 0.5;
+        for (int y_bound = ymin; y_bound < ymax; ++y_bound) {
+            float const py = y_bound + 0.5;
+            float w0 = triangleSurface(b[0], b[1], c[0], c[1], px, py);
+            float w1 = triangleSurface(c[0], c[1], a[0], a[1], px, py);
+            float w2 = triangleSurface(a[0], a[1], b[0], b[1], px, py);
+            bool const isInTriangle = w0 + w1 + w2 < area * (1 + deviation) and w0 + w1 + w2 > area * (1 - deviation);
+            if (not prevPixelOut and not isInTriangle)
+                break;
+            prevPixelOut = not isInTriangle;
+            if (not isInTriangle)
+                continue;
+            float l0 = w0 / area;
+            float l1 = w1 / area;
+            float l2 = w2 / area;
+            float numerator = a[2] * l0 / a[3] + b[2] * l1 / b[3] + c[2] * l2 / c[3];
+            float denominator = l0 / a[3] + l1 / b[3] + l2 / c[3];
+            fragment.gl_FragCoord = glm::vec4(px, py, numerator / denominator, 1.f);
+            bool const passed = depthTest(fragment);
+            if (passed and visibilityId != 0)
+                visibility.ids[(size_t) y_bound * visibility.width + x_bound] = visibilityId;
+            nofPassed += passed;
+            nofFragments++;
+        }
+    }
+    return nofPassed;
+}
+
+/**
+ * @brief Stores triangle that won a pixel of visibility buffer, the first triangle of a draw stores the draw too.
+ * @param program program of draw
+ * @param drawId value of draw counter of draw
+ * @param primTri triangle in window coordinates
+ */
+void GPU::recordVisibilityTriangle(std::shared_ptr<Program> const &program, uint32_t drawId, const PrimitiveTriangle &primTri) {
+    if (visibility.draws.empty() or visibility.draws.back().drawId != drawId){
+        VisibilityDraw draw;
+        draw.program = program;
+        draw.uniforms = program->uniforms;
+        draw.drawId = drawId;
+        for (uint32_t i = 0; i < maxAttributes; i++)
+            if (program->attributeType[i] != AttributeType::EMPTY)
+                draw.attributes[draw.nofAttributes++] = i;
+        visibility.draws.push_back(draw);
+    }
+    VisibilityDraw const &draw = visibility.draws.back();
+    VisibilityTriangle triangle;
+    triangle.position[0] = primTri.ov1.ov.gl_Position;
+    triangle.position[1] = primTri.ov2.ov.gl_Position;
+    triangle.position[2] = primTri.ov3.ov.gl_Position;
+    triangle.firstAttribute = (uint32_t) visibility.attributes.size();
+    triangle.draw = (uint32_t) visibility.draws.size() - 1;
+    for (OutAbstractVertex const *vertex : {&primTri.ov1, &primTri.ov2, &primTri.ov3})
+        for (uint32_t a = 0; a < draw.nofAttributes; a++)
+            visibility.attributes.push_back(vertex->ov.attributes[draw.attributes[a]]);
+    visibility.triangles.push_back(triangle);
+    PIPELINE_STATISTICS_ADD(visibilityTriangles, 1);
+}
+
+/**
+ * @brief Prepares indices of draw command for all its instances.
+ * Encoded indices of the drawn range are decoded and meshlets that overlap the range are culled into culledRanges.
+ *
+ * @param vertexPuller vertex puller of draw with its buffers
+ * @param program active program with culling uniforms
+ * @param command draw command
+ *
+ * @return indices read by vertexProcessor
+ */
+DrawIndices GPU::prepareDrawCommand(DrawVertexPuller const &vertexPuller, Program const &program, DrawCommand const &command){
+    DrawIndices indices;
+    culledRanges.clear();
+    Buffer const *indexBuffer = vertexPuller.indexBuffer.get();
+    if (indexBuffer == nullptr)
+        return indices;
+    IndexType const indexType = vertexPuller.settings->indexing.index_type;
+    if (indexBuffer->encoding == BufferEncoding::INDEX){
+        // only the drawn range is decoded, restart index is still given by indexType
+        decodedIndices.resize(command.count);
+        decodeIndexRange(decodedIndices.data(), indexBuffer->data, indexBuffer->size, command.firstIndex, command.count);
+        indices.data = (uint8_t const *) decodedIndices.data();
+        indices.type = IndexType::UINT32;
+    }
+    else{
+        indices.data = indexBuffer->data + (size_t) command.firstIndex * (uint32_t) indexType;
+        indices.type = indexType;
+    }
+    // whole triangles of culled meshlets are skipped, the following vertices move to the freed positions
+    if (topology == Topology::TRIANGLES and not primitiveRestart)
+        cullMeshlets(vertexPuller, program, command.firstIndex, command.count);
+    return indices;
+}
+
+/**
+ * @brief This method represents Vertex Processor. It processes each vertex of one instance from InVertex to OutVertex.
+ * @param vertexPuller vertex puller of draw with its buffers
+ * @param indices indices of draw command prepared by prepareDrawCommand
+ * @param command draw command
  * @param outAbstractVertices array for OutAbstractVertex
  * @param program active program with shaders etc.
+ * @param instanceID id of drawn instance (gl_InstanceID)
+ *
+ * @return number of vertices written into outAbstractVertices, vertices of culled meshlets are left out
  */
-void GPU::vertexProcessor(uint32_t nofVertices, OutAbstractVertex * outAbstractVertices, Program * program) {
-    Vertex_puller_settings * vertexPullerSettings = (Vertex_puller_settings *) * std::find(vertexPullerList.begin(), vertexPullerList.end(), (VertexPullerID) activeVertexPuller);
-    BufferID * vertexPullerBuffer = (BufferID *) *std::find(bufferList.begin(), bufferList.end(), vertexPullerSettings->indexing.buffer_id);
+uint32_t GPU::vertexProcessor(DrawVertexPuller const &vertexPuller, DrawIndices const &indices, DrawCommand const &command,
+                              OutAbstractVertex * outAbstractVertices, Program * program, uint32_t instanceID) {
+    Vertex_puller_settings const &vertexPullerSettings = *vertexPuller.settings;
+    IndexType const indexType = vertexPullerSettings.indexing.index_type;
+    IndexType const readType = indices.type;
+    uint32_t const nofVertices = command.count;
+    uint32_t const firstIndex = command.firstIndex;
+    int32_t const baseVertex = command.baseVertex;
+    uint32_t const baseInstance = command.baseInstance;
+
+    // FIFO post-transform cache, shaded vertices of indexed draws are reused within one instance
+    uint32_t cachedIndex[postTransformCacheSize];
+    uint32_t cachedVertex[postTransformCacheSize];
+    uint32_t nofCached = 0;
+    uint32_t cacheHead = 0;
+
     InVertex inVertex;
     OutVertex outVertex;
     OutAbstractVertex outAbstractVertex;
+    inVertex.gl_InstanceID = instanceID;
 
     // If indexing is enabled, use indexing, else use counter `i`
-    int index = 0;
-    for (int i = 0; i < nofVertices; i++) {
-        if (vertexPullerSettings->indexing.enabled) {
-            if (vertexPullerSettings->indexing.index_type == IndexType::UINT8)
-                getBufferData((BufferID) vertexPullerBuffer, i * sizeof(uint8_t), sizeof(uint8_t), &index);
-            else if (vertexPullerSettings->indexing.index_type == IndexType::UINT16)
-                getBufferData((BufferID) vertexPullerBuffer, i * sizeof(uint16_t), sizeof(uint16_t), &index);
-            else if (vertexPullerSettings->indexing.index_type == IndexType::UINT32)
-                getBufferData((BufferID) vertexPullerBuffer, i * sizeof(uint32_t), sizeof(uint32_t), &index);
+    // Restart index is the maximal value of index type
+    uint32_t const restartIndex = primitiveRestart ? (uint32_t) (0xffffffffull >> (32 - 8 * (uint32_t) indexType)) : emptyID;
+    uint8_t const * const indexData = indices.data;
+    bool const restartEnabled = primitiveRestart and indexData != nullptr;
+    restartPositions.clear();
+
+    size_t nextCulled = 0;
+    uint32_t nofOutput = 0;
+
+    for (uint32_t i = 0; i < nofVertices; i++) {
+        if (nextCulled < culledRanges.size() and i == culledRanges[nextCulled]) {
+            i = culledRanges[nextCulled + 1] - 1;
+            nextCulled += 2;
+            continue;
         }
-        else
-            index = i;
+        uint32_t const o = nofOutput++;
+        uint32_t index = firstIndex + i;
+        if (indexData != nullptr) {
+            if (readType == IndexType::UINT8)
+                index = indexData[i];
+            else if (readType == IndexType::UINT16)
+                index = ((uint16_t const *) indexData)[i];
+            else
+                index = ((uint32_t const *) indexData)[i];
+            if (restartEnabled and index == restartIndex) {
+                restartPositions.push_back(o);
+                continue;
+            }
+            // indices are checked here, so the draw does not read them twice
+            int64_t const element = (int64_t) index + baseVertex;
+            if ((uint64_t) element >= vertexPuller.vertexLimit)
+                throw std::range_error(element < 0 or element > 0xffffffffll ? "Base vertex of draw command moves indices out of range."
+                                                                             : "Draw command reads vertices out of vertex buffer.");
+            index = (uint32_t) element;
+        }
+        PIPELINE_STATISTICS_ADD(verticesFetched, 1);
 
-        int k = 0;
-        // Set attributes for each enabled head with valid head buffer
-        for (auto & attribute : inVertex.attributes) {
-            auto head = vertexPullerSettings->heads[k];
-            if (head.enabled and isBuffer(head.buffer_id)) {
-                BufferID *headBuffer = (BufferID *) *std::find(bufferList.begin(), bufferList.end(), head.buffer_id);
-                outAbstractVertex.attributeType[k] = head.attrib_type;
-                switch (head.attrib_type) {
-                    case AttributeType::FLOAT:{
-                        attribute.v1 = *((float *) ((size_t) headBuffer + head.offset + head.stride * index));
-                        break;
-                    }
-                    case AttributeType::VEC2:{
-                        attribute.v2 = *((glm::vec2 *) ((size_t) headBuffer + head.offset + head.stride * index));
-                        break;
-                    }
-                    case AttributeType::VEC3:{
-                        attribute.v3 = *((glm::vec3 *) ((size_t) headBuffer + head.offset + head.stride * index));
-                        break;
-                    }
-                    case AttributeType::VEC4:{
-                        attribute.v4 = *((glm::vec4 *) ((size_t) headBuffer + head.offset + head.stride * index));
-                        break;
-                    }
-                    default:
-                        break;
-                }
+        if (indexData != nullptr) {
+            uint32_t const * hit = std::find(cachedIndex, cachedIndex + nofCached, index);
+            if (hit != cachedIndex + nofCached) {
+                outAbstractVertices[o] = outAbstractVertices[cachedVertex[hit - cachedIndex]];
+                continue;
             }
-            k++;
+        }
+
+        // Set attributes for each enabled head with valid head buffer
+        for (uint32_t k = 0; k < maxAttributes; k++) {
+            if (vertexPuller.headData[k] == nullptr)
+                continue;
+            auto const & head = vertexPullerSettings.heads[k];
+            auto const & headCache = vertexPuller.headCaches[k];
+            uint32_t const element = head.divisor == 0 ? index : instanceID / head.divisor + baseInstance;
+            uint8_t const * data = headCache != nullptr ? headCache->vertex(element) + head.offset
+                                                        : vertexPuller.headData[k] + (size_t) head.stride * element;
+            outAbstractVertex.attributeType[k] = head.attrib_type;
+            if (vertexPuller.headFetch[k] != nullptr)
+                vertexPuller.headFetch[k](inVertex.attributes[k], data);
         }
         inVertex.gl_VertexID = index;
         program->vertexShader(outVertex, inVertex, program->uniforms);
+        PIPELINE_STATISTICS_ADD(vertexShaderInvocations, 1);
         outAbstractVertex.ov = outVertex;
-        outAbstractVertices[i] = outAbstractVertex;
+        outAbstractVertices[o] = outAbstractVertex;
+
+        if (indexData != nullptr) {
+            cachedIndex[cacheHead] = index;
+            cachedVertex[cacheHead] = o;
+            cacheHead = (cacheHead + 1) % postTransformCacheSize;
+            nofCached = std::min(nofCached + 1, postTransformCacheSize);
+        }
+    }
+    return nofOutput;
+}
+
+/**
+ * @brief Computes transform from the space of attribute 0 into clip space from culling uniforms of program.
+ *
+ * @param program program with culling uniforms
+ * @param transform projection * view * model, missing matrices are identity
+ *
+ * @return false if the program does not set culling uniforms
+ */
+bool cullingTransform(Program const &program, glm::mat4 &transform){
+    if (program.cullingUniforms[0] == emptyID)
+        return false;
+    transform = program.uniforms.uniform[program.cullingUniforms[0]].m4;
+    for (uint32_t u = 1; u < 3; u++)
+        if (program.cullingUniforms[u] != emptyID)
+            transform = transform * program.uniforms.uniform[program.cullingUniforms[u]].m4;
+    return true;
+}
+
+/**
+ * @brief Extracts normalized planes of frustum from clip space transform (Gribb, Hartmann).
+ * Far plane is left out because far geometry is not clipped by the pipeline.
+ *
+ * @param planes left, right, bottom, top and near plane, points inside have dot(plane.xyz, point) + plane.w >= 0
+ * @param transform transform into clip space
+ */
+void frustumPlanes(glm::vec4 *planes, glm::mat4 const &transform){
+    // row k of the matrix is (transform[0][k], ..., transform[3][k])
+    glm::vec4 const rowW(transform[0][3], transform[1][3], transform[2][3], transform[3][3]);
+    for (uint32_t k = 0; k < 3; k++){
+        glm::vec4 const row(transform[0][k], transform[1][k], transform[2][k], transform[3][k]);
+        planes[2 * k] = rowW + row;
+        if (k < 2)
+            planes[2 * k + 1] = rowW - row;
+    }
+    for (uint32_t p = 0; p < 5; p++){
+        float const length = glm::length(glm::vec3(planes[p]));
+        if (length > 0.f)
+            planes[p] /= length;
+    }
+}
+
+/**
+ * @brief Tests bounds of vertex puller against frustum given by culling uniforms of program.
+ *
+ * @param vertexPuller vertex puller with bounds
+ * @param program program with culling uniforms
+ *
+ * @return true if the draw can be skipped
+ */
+bool GPU::cullDraw(Vertex_puller_settings const &vertexPuller, Program const &program){
+    Bounds const &bounds = vertexPuller.bounds;
+    glm::mat4 transform;
+    if (bounds.type == BoundsType::NONE or not cullingTransform(program, transform))
+        return false;
+    glm::vec4 planes[5];
+    frustumPlanes(planes, transform);
+    PIPELINE_STATISTICS_ADD(drawsTested, 1);
+    bool culled = false;
+    for (auto const &plane : planes){
+        glm::vec3 const normal(plane);
+        if (bounds.type == BoundsType::SPHERE)
+            culled = culled or glm::dot(normal, bounds.center) + plane[3] < -bounds.radius;
+        else{
+            // corner of box that lies farthest in the direction of plane normal
+            glm::vec3 const corner(normal[0] >= 0.f ? bounds.max[0] : bounds.min[0],
+                                   normal[1] >= 0.f ? bounds.max[1] : bounds.min[1],
+                                   normal[2] >= 0.f ? bounds.max[2] : bounds.min[2]);
+            culled = culled or glm::dot(normal, corner) + plane[3] < 0.f;
+        }
+    }
+    PIPELINE_STATISTICS_ADD(drawsCulled, culled);
+    return culled;
+}
+
+/**
+ * @brief Tests meshlets of vertex puller that overlap the drawn range of index buffer.
+ * Bounding sphere is tested against left, right, bottom, top and near plane of the clip space transform,
+ * the far plane is not tested because fragments behind it are not discarded.
+ * Cone of normals is tested against camera position only if face culling is enabled.
+ * Rejected parts of the drawn range are stored into culledRanges as begin/end pairs relative to firstIndex.
+ *
+ * @param vertexPuller vertex puller of draw with meshlet buffer
+ * @param program program with culling uniforms
+ * @param firstIndex first drawn element of index buffer
+ * @param nofVertices number of drawn vertices
+ *
+ * @return number of culled meshlets
+ */
+uint32_t GPU::cullMeshlets(DrawVertexPuller const &vertexPuller, Program const &program, uint32_t firstIndex, uint32_t nofVertices){
+    glm::mat4 transform;
+    Buffer const *meshletBuffer = vertexPuller.meshletBuffer.get();
+    if (meshletBuffer == nullptr or not cullingTransform(program, transform) or firstIndex % 3 != 0)
+        return 0;
+    Meshlets const &meshletRecords = vertexPuller.settings->meshlets;
+    if (meshletBuffer->mapped and not (meshletBuffer->mapFlags & mapPersistent))
+        throw std::range_error("Meshlet buffer is mapped.");
+    if ((uint64_t) meshletRecords.count * sizeof(Meshlet) > meshletBuffer->size)
+        throw std::range_error("Meshlets are out of meshlet buffer.");
+    waitForUploads(*meshletBuffer);
+    auto const *meshlets = (Meshlet const *) meshletBuffer->data;
+
+    glm::vec4 planes[5];
+    frustumPlanes(planes, transform);
+    // camera is the point that is projected onto w = 0, x = 0, y = 0
+    glm::vec4 const eye = glm::inverse(transform) * glm::vec4(0.f, 0.f, 1.f, 0.f);
+    bool const coneCulling = faceCulling and std::abs(eye[3]) > 1e-12f;
+    glm::vec3 const camera = coneCulling ? glm::vec3(eye) / eye[3] : glm::vec3(0.f);
+
+    uint32_t const lastIndex = firstIndex + nofVertices;
+    uint32_t nofCulled = 0;
+    for (uint32_t m = 0; m < meshletRecords.count; m++){
+        Meshlet const &meshlet = meshlets[m];
+        uint32_t const begin = std::max(meshlet.firstIndex, firstIndex);
+        uint32_t const end = std::min(meshlet.firstIndex + meshlet.count, lastIndex);
+        if (begin >= end)
+            continue;
+        PIPELINE_STATISTICS_ADD(meshletsTested, 1);
+        glm::vec3 const center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+        bool culled = false;
+        for (auto const &plane : planes)
+            culled = culled or glm::dot(glm::vec3(plane), center) + plane[3] < -meshlet.radius;
+        if (culled)
+            PIPELINE_STATISTICS_ADD(meshletsFrustumCulled, 1);
+        else if (coneCulling){
+            // camera sees all triangles from behind if it lies in the negative cone at apex
+            glm::vec3 const view = glm::vec3(meshlet.coneApex[0], meshlet.coneApex[1], meshlet.coneApex[2]) - camera;
+            glm::vec3 const axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+            culled = glm::dot(view, axis) > meshlet.coneCutoff * glm::length(view);
+            if (culled)
+                PIPELINE_STATISTICS_ADD(meshletsConeCulled, 1);
+        }
+        if (not culled)
+            continue;
+        // meshlets are sorted by firstIndex and they do not overlap, adjacent culled ranges are merged
+        uint32_t const rangeBegin = begin - firstIndex, rangeEnd = end - firstIndex;
+        if (not culledRanges.empty() and culledRanges.back() > rangeBegin)
+            throw std::range_error("Meshlets are not sorted by firstIndex or they overlap.");
+        if (not culledRanges.empty() and culledRanges.back() == rangeBegin)
+            culledRanges.back() = rangeEnd;
+        else{
+            culledRanges.push_back(rangeBegin);
+            culledRanges.push_back(rangeEnd);
+        }
+        nofCulled++;
     }
+    return nofCulled;
 }
 /**
  * @brief FrameBuffer constructor, create a new frame buffer instance and allocate new color and depth buffers
@@ -1016,11 +2533,25 @@ OutAbstractVertex getEdgePoint(OutAbstractVertex a, OutAbstractVertex b){
  * @return triangle's surface
  */
 float triangleSurface(OutAbstractVertex &a, OutAbstractVertex &b, OutAbstractVertex &c){
-    float aX = a.ov.gl_Position[0];
-    float aY = a.ov.gl_Position[1];
-    float bX = b.ov.gl_Position[0];
-    float bY = b.ov.gl_Position[1];
-    float cX = c.ov.gl_Position[0];
-    float cY = c.ov.gl_Position[1];
+    return triangleSurface(a.ov.gl_Position[0], a.ov.gl_Position[1], b.ov.gl_Position[0], b.ov.gl_Position[1],
+                           c.ov.gl_Position[0], c.ov.gl_Position[1]);
+}
+
+/**
+ * @brief Counts triangle surface from coordinates of three vertices, see triangleSurface of vertices.
+ */
+float triangleSurface(float aX, float aY, float bX, float bY, float cX, float cY){
     return std::abs((aX * (bY - cY) + bX * (cY - aY) + cX * (aY - bY))/2);
 }
+
+/**
+ * @brief Tests if triangle in window coordinates is clockwise, i.e. it shows its back face.
+ * @param primitiveTriangle triangle after viewport transformation
+ * @return true if twice the signed area of triangle is negative
+ */
+bool isBackFacing(PrimitiveTriangle const &primitiveTriangle){
+    glm::vec4 const &a = primitiveTriangle.ov1.ov.gl_Position;
+    glm::vec4 const &b = primitiveTriangle.ov2.ov.gl_Position;
+    glm::vec4 const &c = primitiveTriangle.ov3.ov.gl_Position;
+    return (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]) < 0.f;
+}
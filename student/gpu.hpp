@@ -7,8 +7,17 @@
 #pragma once
 
 #include <student/fwd.hpp>
+#include <student/timer.hpp>
+#include <student/bufferAllocator.hpp>
+#include <student/uploadQueue.hpp>
+#include <student/objectTable.hpp>
+#include <student/attributeFormat.hpp>
+#include <atomic>
 #include <vector>
-#include <list>
+#include <memory>
+#include <ostream>
+
+class VertexBlockCache;
 
 class FrameBuffer{
     public:
@@ -20,12 +29,45 @@ class FrameBuffer{
         ~FrameBuffer();
 };
 
+/**
+ * @brief Buffer object, its storage is taken from BufferAllocator of the GPU and returned by destructor.
+ * Buffer created from existing memory (e.g. mapped file) keeps its owner alive instead.
+ */
+class Buffer{
+    public:
+        Buffer(BufferAllocator &allocator, uint64_t size);
+        Buffer(BufferAllocator &allocator, uint8_t *data, uint64_t size, std::shared_ptr<void const> storage);
+        Buffer(Buffer const &) = delete;
+        Buffer &operator=(Buffer const &) = delete;
+        ~Buffer();
+        BufferAllocator &allocator;
+        uint8_t * data = nullptr;
+        uint64_t size = 0;
+        std::atomic<bool> mapClaimed{false}; ///< taken by mapBuffer, so only one thread maps the buffer
+        std::atomic<bool> mapped{false};    ///< published after the map state below and cleared before it
+        std::atomic<MapFlags> mapFlags{0}; ///< read by draws of other threads
+        std::atomic<uint64_t> mapOffset{0}; ///< read by flushMappedBufferRange of other threads
+        std::atomic<uint64_t> mapSize{0};
+        std::atomic<uint64_t> pendingUpload{0}; ///< sequence number of the last asynchronous upload into the buffer
+        BufferEncoding encoding = BufferEncoding::NONE; ///< encoding of content, it is decoded by vertex puller
+        std::shared_ptr<void const> storage; ///< owner of external memory, nullptr if storage comes from allocator
+};
+
+/**
+ * @brief Sync object, it is signaled when all uploads issued before fenceSync are complete.
+ */
+class Sync{
+    public:
+        uint64_t sequence = 0;
+};
+
 class Program{
     public:
         VertexShader vertexShader{};
         FragmentShader fragmentShader{};
         Uniforms uniforms;
         AttributeType attributeType[maxAttributes]{};
+        uint32_t cullingUniforms[3] = {emptyID, emptyID, emptyID}; ///< projection, view and model matrix uniforms, transform used by culling
 };
 /**
  * Wrapper to save AttributeType of OutVertex attributes,
@@ -42,6 +84,178 @@ struct PrimitiveTriangle {
     OutAbstractVertex ov3;
 };
 
+/**
+ * @brief Counters of work done by the pipeline (similar to GL_ARB_pipeline_statistics_query).
+ * All counters stay zero if ENABLE_PIPELINE_STATISTICS is not defined.
+ */
+struct PipelineStatistics {
+    uint64_t verticesFetched           = 0; ///< vertices assembled by vertex puller
+    uint64_t vertexShaderInvocations   = 0; ///< vertex shader invocations
+    uint64_t clippingInputPrimitives   = 0; ///< primitives entering clipping
+    uint64_t clippingOutputPrimitives  = 0; ///< primitives leaving clipping
+    uint64_t culledPrimitives          = 0; ///< primitives completely removed by clipping
+    uint64_t fragmentsRasterized       = 0; ///< fragments produced by rasterization
+    uint64_t fragmentShaderInvocations = 0; ///< fragment shader invocations
+    uint64_t depthTestPassed           = 0; ///< fragments that passed depth test
+    uint64_t depthTestFailed           = 0; ///< fragments that failed depth test
+    uint64_t pixelsWritten             = 0; ///< pixels written into framebuffer
+    uint64_t meshletsTested            = 0; ///< meshlets tested before vertex shading
+    uint64_t meshletsFrustumCulled     = 0; ///< meshlets rejected because their bounding sphere is out of frustum
+    uint64_t meshletsConeCulled        = 0; ///< meshlets rejected because all their triangles are back-facing
+    uint64_t backFacingPrimitives      = 0; ///< primitives removed by face culling
+    uint64_t drawsTested               = 0; ///< draw calls whose bounds were tested against frustum
+    uint64_t drawsCulled               = 0; ///< draw calls skipped because their bounds are out of frustum
+    uint64_t drawsConditionalSkipped   = 0; ///< draw calls skipped by conditional rendering
+    uint64_t visibilityTriangles       = 0; ///< triangles stored into visibility buffer (they won at least one pixel)
+    PipelineStatistics &operator+=(PipelineStatistics const &other);
+};
+
+/**
+ * @brief This enum represents stages of drawTriangles that are timed separately.
+ */
+enum class PipelineStage {
+    VERTEX_PROCESSOR   = 0, ///< vertex pulling and vertex shader
+    PRIMITIVE_ASSEMBLY = 1, ///< assembly of triangles
+    CLIPPING           = 2, ///< clipping by near plane
+    NDC_VIEWPORT       = 3, ///< perspective division and viewport transformation
+    RASTERIZATION      = 4, ///< rasterization and interpolation of attributes
+    FRAGMENT_PROCESSOR = 5, ///< fragment shader
+    OUTPUT_MERGE       = 6, ///< depth test and writes into framebuffer
+};
+
+uint32_t const nofPipelineStages = 7; ///< number of timed pipeline stages
+
+/**
+ * @brief Wall time spent in each pipeline stage.
+ */
+struct StageTimings {
+    double stages[nofPipelineStages]{}; ///< seconds spent in each stage, indexed by PipelineStage
+    double &operator[](PipelineStage stage);
+    double total() const;
+    StageTimings &operator+=(StageTimings const &other);
+};
+
+char const *pipelineStageName(PipelineStage stage);
+void printPipelineStatistics(std::ostream &stream, PipelineStatistics const &statistics);
+void printStageTimings(std::ostream &stream, StageTimings const &timings);
+
+/**
+ * @brief Query object, it measures commands issued between beginQuery and endQuery.
+ * Type, activity and timer belong to the drawing thread, result can be read by other threads.
+ */
+class Query {
+    public:
+        QueryType type = QueryType::TIME_ELAPSED;
+        std::atomic<uint64_t> result{0};
+        bool active = false;
+        Timer<double> timer;
+};
+
+struct Head {
+    BufferID buffer_id;
+    uint32_t  offset;
+    uint32_t  stride;
+    AttributeType attrib_type;
+    AttributeFormat format; ///< storage format of attribute in buffer
+    bool enabled;
+    uint32_t divisor; ///< 0 - attribute is read per vertex, n - attribute advances once every n instances
+};
+
+struct Indexing {
+    bool enabled;
+    BufferID buffer_id;
+    IndexType index_type;
+};
+
+struct Meshlets {
+    BufferID buffer_id = emptyID; ///< buffer with Meshlet records
+    uint32_t count = 0;           ///< number of meshlets, 0 disables meshlet culling
+};
+
+/**
+ * @brief Shape of bounds of vertex puller.
+ */
+enum class BoundsType {
+    NONE   = 0, ///< draws are not culled
+    SPHERE = 1, ///< bounding sphere (center, radius)
+    BOX    = 2, ///< axis aligned bounding box (min, max)
+};
+
+struct Bounds {
+    BoundsType type = BoundsType::NONE; ///< shape of bounds, NONE disables culling of whole draws
+    glm::vec3 center = glm::vec3(0.f);  ///< center of sphere
+    float radius = 0.f;                 ///< radius of sphere
+    glm::vec3 min = glm::vec3(0.f);     ///< minimal corner of box
+    glm::vec3 max = glm::vec3(0.f);     ///< maximal corner of box
+};
+
+class Vertex_puller_settings {
+    public:
+        Vertex_puller_settings();
+        virtual ~Vertex_puller_settings();
+        Head heads[maxAttributes]{};
+        Indexing indexing{};
+        Meshlets meshlets{};
+        Bounds bounds{};
+};
+
+/**
+ * @brief Triangle stored into visibility buffer, only attributes used by the program of its draw are kept.
+ */
+struct VisibilityTriangle {
+    glm::vec4 position[3];       ///< window coordinates of vertices (x, y, z, w)
+    uint32_t firstAttribute = 0; ///< first of 3 * nofAttributes values of vertices in VisibilityBuffer::attributes
+    uint32_t draw = 0;           ///< index of draw in VisibilityBuffer::draws
+};
+
+/**
+ * @brief Draw stored into visibility buffer, resolve shades its pixels with its program and uniforms.
+ */
+struct VisibilityDraw {
+    std::shared_ptr<Program> program;           ///< program of draw, it stays alive even if it is deleted before resolve
+    Uniforms uniforms;                          ///< uniforms at the time of draw
+    uint32_t attributes[maxAttributes]{};       ///< indices of attributes of program that are not EMPTY
+    uint32_t nofAttributes = 0;                 ///< number of used attributes
+    uint32_t drawId = 0;                        ///< value of draw counter of GPU
+};
+
+/**
+ * @brief Visibility buffer, draws write id of the nearest triangle into each pixel instead of shading it.
+ */
+struct VisibilityBuffer {
+    bool active = false;                        ///< draws are recorded between beginVisibilityBuffer and resolveVisibilityBuffer
+    uint32_t width  = 0;                        ///< width of framebuffer at beginVisibilityBuffer
+    uint32_t height = 0;                        ///< height of framebuffer at beginVisibilityBuffer
+    std::vector<uint32_t> ids;                  ///< index of triangle + 1 per pixel, 0 for empty pixels
+    std::vector<VisibilityTriangle> triangles;  ///< triangles that passed depth test at least once
+    std::vector<Attribute> attributes;          ///< attributes of vertices of triangles
+    std::vector<VisibilityDraw> draws;          ///< draws of triangles
+};
+
+/**
+ * @brief Vertex puller of draw batch with its buffers, they are looked up once per batch.
+ * Batch holds them, so other threads may delete the vertex puller or its buffers while it is drawn.
+ */
+struct DrawVertexPuller {
+    std::shared_ptr<Vertex_puller_settings const> settings;   ///< settings of vertex puller
+    std::shared_ptr<Buffer const> indexBuffer;                ///< nullptr if indexing is disabled or its buffer does not exist
+    std::shared_ptr<Buffer const> headBuffers[maxAttributes]; ///< nullptr for disabled heads and heads without buffer
+    std::shared_ptr<Buffer const> meshletBuffer;              ///< nullptr if vertex puller has no meshlets
+    uint8_t const *headData[maxAttributes]{};                 ///< the first attribute of head, nullptr for heads that are not read
+    AttributeFetch headFetch[maxAttributes]{};                ///< conversion of attribute from its storage format
+    std::shared_ptr<VertexBlockCache> headCaches[maxAttributes]; ///< decoded blocks of encoded buffers, shared by heads of one buffer
+    uint64_t headElements[maxAttributes]{};                   ///< number of elements that head can read from its buffer
+    uint64_t vertexLimit = 0x100000000ull;                    ///< vertices below this limit are read by all heads with zero divisor
+};
+
+/**
+ * @brief Indices of draw command prepared once for all its instances.
+ */
+struct DrawIndices {
+    uint8_t const *data = nullptr;      ///< the first drawn index, nullptr if indexing is disabled
+    IndexType type = IndexType::UINT32; ///< type of read indices, decoded indices are UINT32
+};
+
 /**
  * @brief This class represent software GPU
  */
@@ -52,16 +266,36 @@ class GPU{
 
     //buffer object commands
     BufferID  createBuffer           (uint64_t size);
+    BufferID  createBufferFromMemory (void * data,uint64_t size,std::shared_ptr<void const> storage);
     void      deleteBuffer           (BufferID buffer);
     void      setBufferData          (BufferID buffer,uint64_t offset,uint64_t size,void const* data);
     void      getBufferData          (BufferID buffer,uint64_t offset,uint64_t size,void      * data);
     bool      isBuffer               (BufferID buffer);
+    void *    mapBuffer              (BufferID buffer,uint64_t offset,uint64_t size,MapFlags flags);
+    void      flushMappedBufferRange (BufferID buffer,uint64_t offset,uint64_t size);
+    bool      unmapBuffer            (BufferID buffer);
+    void      setBufferDataAsync     (BufferID buffer,uint64_t offset,uint64_t size,void const* data);
+    void      setBufferDataAsync     (BufferID buffer,uint64_t offset,std::vector<uint8_t> &&data);
+    void      setBufferEncoding      (BufferID buffer,BufferEncoding encoding);
+
+    //sync object commands
+    SyncID    fenceSync              ();
+    SyncStatus clientWaitSync        (SyncID sync,uint64_t timeout);
+    void      deleteSync             (SyncID sync);
+    bool      isSync                 (SyncID sync);
+    MemoryUsage getMemoryUsage       () const;
 
     //vertex array object commands (vertex puller)
     ObjectID  createVertexPuller     ();
     void      deleteVertexPuller     (VertexPullerID vao);
     void      setVertexPullerHead    (VertexPullerID vao,uint32_t head,AttributeType type,uint64_t stride,uint64_t offset,BufferID buffer);
     void      setVertexPullerIndexing(VertexPullerID vao,IndexType type,BufferID buffer);
+    void      setVertexPullerHeadDivisor(VertexPullerID vao,uint32_t head,uint32_t divisor);
+    void      setVertexPullerHeadFormat(VertexPullerID vao,uint32_t head,AttributeFormat format);
+    void      setVertexPullerMeshlets(VertexPullerID vao,BufferID buffer,uint32_t nofMeshlets);
+    void      setVertexPullerBoundingSphere(VertexPullerID vao,glm::vec3 const&center,float radius);
+    void      setVertexPullerBoundingBox(VertexPullerID vao,glm::vec3 const&min,glm::vec3 const&max);
+    void      disableVertexPullerBounds(VertexPullerID vao);
     void      enableVertexPullerHead (VertexPullerID vao,uint32_t head);
     void      disableVertexPullerHead(VertexPullerID vao,uint32_t head);
     void      bindVertexPuller       (VertexPullerID vao);
@@ -80,6 +314,7 @@ class GPU{
     void      programUniform3f       (ProgramID prg,uint32_t uniformId,glm::vec3 const&d);
     void      programUniform4f       (ProgramID prg,uint32_t uniformId,glm::vec4 const&d);
     void      programUniformMatrix4f (ProgramID prg,uint32_t uniformId,glm::mat4 const&d);
+    void      setProgramCullingUniforms(ProgramID prg,uint32_t projectionUniform,uint32_t viewUniform = emptyID,uint32_t modelUniform = emptyID);
 
     //framebuffer functions
     void      createFramebuffer      (uint32_t width,uint32_t height);
@@ -90,53 +325,115 @@ class GPU{
     uint32_t  getFramebufferWidth    ();
     uint32_t  getFramebufferHeight   ();
 
+    //primitive assembly state
+    void      setTopology            (Topology topology);
+    void      enablePrimitiveRestart ();
+    void      disablePrimitiveRestart();
+    void      enableFaceCulling      ();
+    void      disableFaceCulling     ();
+
+    //per-fragment state
+    void      colorMask              (bool enabled);
+    void      depthMask              (bool enabled);
+    void      depthFunc              (DepthFunction function);
+
     //execution commands
     void      clear                  (float r,float g,float b,float a);
     void      drawTriangles          (uint32_t  nofVertices);
+    void      drawTrianglesInstanced (uint32_t  nofVertices,uint32_t nofInstances);
+    void      drawTrianglesRange     (uint32_t  firstVertex,uint32_t nofVertices);
+    void      drawTrianglesBaseVertex(uint32_t  firstIndex,uint32_t nofVertices,int32_t baseVertex);
+    void      drawTrianglesInstancedBaseVertex(uint32_t firstIndex,uint32_t nofVertices,int32_t baseVertex,
+                                              uint32_t nofInstances,uint32_t baseInstance);
+    void      multiDrawTriangles     (DrawCommand const*commands,uint32_t nofCommands);
+    void      multiDrawTrianglesIndirect(BufferID buffer,uint64_t offset,uint32_t nofCommands,uint64_t stride = 0);
+
+    //pipeline statistics commands
+    PipelineStatistics getDrawStatistics   () const;
+    PipelineStatistics getFrameStatistics  () const;
+    StageTimings getDrawStageTimings     () const;
+    StageTimings getFrameStageTimings    () const;
+    void      resetFrameStatistics   ();
+
+    //query object commands
+    QueryID   createQuery            ();
+    void      deleteQuery            (QueryID query);
+    void      beginQuery             (QueryType type,QueryID query);
+    void      endQuery               (QueryType type);
+    uint64_t  getQueryResult         (QueryID query);
+    bool      isQuery                (QueryID query);
+    void      beginConditionalRender (QueryID query);
+    void      endConditionalRender   ();
+
+    //visibility buffer commands
+    void      beginVisibilityBuffer  ();
+    void      resolveVisibilityBuffer();
 
     /// \addtogroup gpu_init 00. proměnné, inicializace / deinicializace grafické karty
-    std::list<BufferID> bufferList;
-    std::list<ObjectID> vertexPullerList;
-    std::list<ProgramID> programList;
-    ObjectID * activeVertexPuller;
-    ProgramID * activeProgram{};
+    BufferAllocator bufferAllocator;
+    ObjectTable<Buffer> buffers;
+    ObjectTable<Vertex_puller_settings> vertexPullers;
+    ObjectTable<Program> programs;
+    ObjectTable<Query> queries;
+    ObjectTable<Sync> syncs;
+    UploadQueue uploadQueue;
+    std::shared_ptr<Query> activeQueries[nofQueryTypes]; ///< deleted query stays alive until it is ended
+    std::shared_ptr<Query> conditionQuery;    ///< draws are skipped while result of this query is 0
+    VertexPullerID activeVertexPuller = emptyID;
+    ProgramID activeProgram = emptyID;
     FrameBuffer * frameBuffer;
+    PipelineStatistics drawStatistics;
+    PipelineStatistics frameStatistics;
+    StageTimings drawStageTimings;
+    StageTimings frameStageTimings;
+    uint32_t drawCounter = 0;
+    Topology topology = Topology::TRIANGLES;
+    bool primitiveRestart = false;            ///< maximal value of index type ends the current strip/fan
+    bool faceCulling = false;                 ///< clockwise triangles (in window coordinates) are removed
+    bool colorWrites = true;                  ///< fragments that pass depth test write color
+    bool depthWrites = true;                  ///< fragments that pass depth test write depth
+    DepthFunction depthFunction = DepthFunction::LESS; ///< comparison of fragment depth with the stored depth
+    VisibilityBuffer visibility;              ///< ids of triangles and their data recorded for deferred shading
+    std::vector<uint32_t> restartPositions;   ///< positions of restart indices found by the last vertexProcessor call
+    std::vector<uint32_t> decodedIndices;     ///< drawn range of encoded index buffer decoded by the last prepareDrawCommand call
+    std::vector<uint32_t> culledRanges;       ///< begin/end pairs of drawn vertices rejected by meshlet culling in the last prepareDrawCommand call
 
-    void vertexProcessor(uint32_t nofVertices, OutAbstractVertex *outAbstractVertices, Program * program);
+    DrawVertexPuller lookupDrawVertexPuller(VertexPullerID vao);
+    void     validateDrawCommand(DrawVertexPuller const &vertexPuller, DrawCommand const &command);
+    bool     cullDraw(Vertex_puller_settings const &vertexPuller, Program const &program);
+    uint32_t cullMeshlets(DrawVertexPuller const &vertexPuller, Program const &program, uint32_t firstIndex, uint32_t nofVertices);
+    DrawIndices prepareDrawCommand(DrawVertexPuller const &vertexPuller, Program const &program, DrawCommand const &command);
+    uint32_t vertexProcessor(DrawVertexPuller const &vertexPuller, DrawIndices const &indices, DrawCommand const &command,
+                             OutAbstractVertex *outAbstractVertices, Program * program, uint32_t instanceID = 0);
 
-    void rasterize(const Program *program, std::vector<InFragment> &inFragments, const PrimitiveTriangle &primTri);
+    std::shared_ptr<Buffer> getBuffer(BufferID buffer) const;
+    std::shared_ptr<Vertex_puller_settings> getVertexPuller(VertexPullerID vao) const;
+    std::shared_ptr<Program> getProgram(ProgramID prg) const;
+    void waitForUploads(Buffer const & buffer);
 
-    void viewport_transform(PrimitiveTriangle &primitiveTriangle) const;
+    void primitiveAssembly(std::vector<PrimitiveTriangle> &primitiveTriangles, const OutAbstractVertex *outAbstractVertices, uint32_t nofVertices) const;
 
-    void depth_correction(const OutFragment &outFragment, const InFragment &inFragment) const;
-};
-struct Head {
-    BufferID buffer_id;
-    uint32_t  offset;
-    uint32_t  stride;
-    AttributeType attrib_type;
-    bool enabled;
-};
+    void rasterize(const Program *program, std::vector<InFragment> &inFragments, const PrimitiveTriangle &primTri);
+    uint32_t rasterizeDepth(const PrimitiveTriangle &primTri, uint64_t &nofFragments, uint32_t visibilityId = 0);
+    void recordVisibilityTriangle(std::shared_ptr<Program> const &program, uint32_t drawId, const PrimitiveTriangle &primTri);
 
-struct Indexing {
-    bool enabled;
-    BufferID buffer_id;
-    IndexType index_type;
-};
+    void viewport_transform(PrimitiveTriangle &primitiveTriangle) const;
 
-class Vertex_puller_settings {
-    public:
-        Vertex_puller_settings();
-        virtual ~Vertex_puller_settings();
-        Head heads[maxAttributes]{};
-        Indexing indexing{};
+    bool depth_correction(const OutFragment &outFragment, const InFragment &inFragment) const;
+    bool depthTest(const InFragment &inFragment) const;
+    void writeColor(const OutFragment &outFragment, const InFragment &inFragment) const;
 };
-
 OutAbstractVertex getEdgePoint(OutAbstractVertex a, OutAbstractVertex b);
 float triangleSurface(OutAbstractVertex &a, OutAbstractVertex &b, OutAbstractVertex &c);
+float triangleSurface(float aX, float aY, float bX, float bY, float cX, float cY);
+void interpolateFragment(InFragment &fragment, const Program *program, const PrimitiveTriangle &primTri,
+                         glm::vec4 const &pixelCenter, float w0, float w1, float w2, float area);
 float normalize_color(uint8_t num, uint8_t normalizator, bool trunc);
 uint8_t denormalize_color(float num, uint8_t normalizer, bool trunc);
 float fit_color(float num);
 void clip(std::vector<PrimitiveTriangle> &newTriangles, const PrimitiveTriangle &primitiveTriangle);
 void ndc(PrimitiveTriangle &primitiveTriangle);
+bool isBackFacing(PrimitiveTriangle const &primitiveTriangle);
+bool cullingTransform(Program const &program, glm::mat4 &transform);
+void frustumPlanes(glm::vec4 *planes, glm::mat4 const &transform);
 
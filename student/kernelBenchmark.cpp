@@ -0,0 +1,672 @@
+/*!
+ * @file
+ * @brief This file contains implementation of microbenchmarks of individual pipeline kernels.
+ *
+ * Every case runs one kernel on synthetic input that is prepared in advance,
+ * so the measured time contains only the kernel itself.
+ * Each case also computes checksum of kernel output, so an optimised kernel can be
+ * checked against results of the original one.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include <student/application.hpp>
+#include <student/attributeFormat.hpp>
+#include <student/bufferCodec.hpp>
+#include <student/kernelBenchmark.hpp>
+
+namespace {
+
+uint32_t const rasterizationSize = 256;   ///< framebuffer resolution of rasterization and depth test cases
+uint32_t const nofBatchTriangles = 1024;  ///< number of triangles processed by one call of per-triangle kernels
+uint32_t const nofBatchFragments = 4096;  ///< number of fragments processed by one call of depth test
+uint32_t const nofUniqueVertices = 256;   ///< number of distinct vertices read by vertex processor cases
+
+/**
+ * @brief One microbenchmark case.
+ */
+struct KernelCase {
+    std::string kernel;                ///< name of kernel
+    std::string input;                 ///< name of synthetic input
+    uint64_t operations;               ///< operations done by one call of run
+    std::function<uint64_t()> run;     ///< runs the kernel and returns checksum of its output
+};
+
+/**
+ * @brief Computes FNV-1a hash of memory.
+ * @param data memory
+ * @param size size in bytes
+ * @param hash initial hash
+ * @return hash
+ */
+uint64_t hashBytes(void const *data, size_t size, uint64_t hash = 14695981039346656037ull){
+    auto const *bytes = (uint8_t const *) data;
+    for (size_t i = 0; i < size; i++){
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Computes hash of positions and first attribute of triangle vertices.
+ * Only initialised data are hashed, so the hash does not depend on memory content.
+ * @param triangle triangle
+ * @param hash initial hash
+ * @return hash
+ */
+uint64_t hashTriangle(PrimitiveTriangle const &triangle, uint64_t hash){
+    for (auto const *vertex : {&triangle.ov1, &triangle.ov2, &triangle.ov3}){
+        hash = hashBytes(&vertex->ov.gl_Position, sizeof(glm::vec4), hash);
+        hash = hashBytes(&vertex->ov.attributes[0].v4, sizeof(glm::vec4), hash);
+    }
+    return hash;
+}
+
+/**
+ * @brief Vertex shader of vertex processor cases, it copies all attributes.
+ */
+void kernelBenchmark_VS(OutVertex &outVertex, InVertex const &inVertex, Uniforms const &uniforms){
+    for (uint32_t i = 0; i < maxAttributes; i++)
+        outVertex.attributes[i] = inVertex.attributes[i];
+    outVertex.gl_Position = inVertex.attributes[0].v4;
+}
+
+/**
+ * @brief Fragment shader of kernel benchmark programs, it is never called.
+ */
+void kernelBenchmark_FS(OutFragment &outFragment, InFragment const &inFragment, Uniforms const &uniforms){
+    outFragment.gl_FragColor = inFragment.attributes[0].v4;
+}
+
+/**
+ * @brief Creates vertex with given position and nofAttributes active vec4 attributes.
+ * @param position position of vertex
+ * @param nofAttributes number of active attributes
+ * @return vertex
+ */
+OutAbstractVertex makeVertex(glm::vec4 const &position, uint32_t nofAttributes){
+    OutAbstractVertex vertex;
+    vertex.ov.gl_Position = position;
+    for (uint32_t i = 0; i < nofAttributes; i++){
+        vertex.attributeType[i] = AttributeType::VEC4;
+        vertex.ov.attributes[i].v4 = position * (float) (i + 1);
+    }
+    return vertex;
+}
+
+/**
+ * @brief Creates clip-space triangles, nofBehind vertices of each triangle lie behind near plane.
+ * @param nofBehind number of vertices behind near plane (0-3)
+ * @param nofAttributes number of active attributes
+ * @return triangles
+ */
+std::vector<PrimitiveTriangle> clipSpaceTriangles(uint32_t nofBehind, uint32_t nofAttributes){
+    std::vector<PrimitiveTriangle> triangles;
+    for (uint32_t i = 0; i < nofBatchTriangles; i++){
+        float const shift = (float) (i % 32) / 32.f - 0.5f;
+        auto z = [&](uint32_t vertex){ return vertex < nofBehind ? -3.f : 0.5f; };
+        triangles.push_back(PrimitiveTriangle{makeVertex(glm::vec4(-0.5f + shift, -0.5f, z(0), 2.f), nofAttributes),
+                                              makeVertex(glm::vec4(+0.5f + shift, -0.5f, z(1), 2.f), nofAttributes),
+                                              makeVertex(glm::vec4(shift, +0.5f, z(2), 2.f), nofAttributes)});
+    }
+    return triangles;
+}
+
+/**
+ * @brief Creates screen-space triangle.
+ * @param a first vertex (x,y in pixels, z depth)
+ * @param b second vertex
+ * @param c third vertex
+ * @param nofAttributes number of active attributes
+ * @return triangle
+ */
+PrimitiveTriangle screenSpaceTriangle(glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c, uint32_t nofAttributes){
+    return PrimitiveTriangle{makeVertex(glm::vec4(a, 1.f), nofAttributes),
+                             makeVertex(glm::vec4(b, 1.f), nofAttributes),
+                             makeVertex(glm::vec4(c, 1.f), nofAttributes)};
+}
+
+/**
+ * @brief Creates shader program with nofAttributes vec4 attributes interpolated.
+ * @param gpu gpu
+ * @param nofAttributes number of interpolated attributes
+ * @return program
+ */
+Program *createBenchmarkProgram(GPU &gpu, uint32_t nofAttributes){
+    ProgramID prg = gpu.createProgram();
+    gpu.attachShaders(prg, kernelBenchmark_VS, kernelBenchmark_FS);
+    for (uint32_t i = 0; i < nofAttributes; i++)
+        gpu.setVS2FSType(prg, i, AttributeType::VEC4);
+    return gpu.getProgram(prg).get();
+}
+
+void addClipCases(std::vector<KernelCase> &cases){
+    char const *names[] = {"inside", "one vertex behind near", "two vertices behind near", "behind near"};
+    for (uint32_t nofBehind = 0; nofBehind < 4; nofBehind++)
+        for (uint32_t nofAttributes : {1u, 16u}){
+            auto triangles = std::make_shared<std::vector<PrimitiveTriangle>>(clipSpaceTriangles(nofBehind, nofAttributes));
+            auto output = std::make_shared<std::vector<PrimitiveTriangle>>();
+            output->reserve(2 * nofBatchTriangles);
+            cases.push_back({"clip", std::string(names[nofBehind]) + ", " + std::to_string(nofAttributes) + " attributes",
+                             nofBatchTriangles, [=](){
+                output->clear();
+                for (auto const &triangle : *triangles)
+                    clip(*output, triangle);
+                uint64_t hash = output->size();
+                for (auto const &triangle : *output)
+                    hash = hashTriangle(triangle, hash);
+                return hash;
+            }});
+        }
+}
+
+void addNdcCases(std::vector<KernelCase> &cases){
+    auto source = std::make_shared<std::vector<PrimitiveTriangle>>(clipSpaceTriangles(0, 1));
+    auto triangles = std::make_shared<std::vector<PrimitiveTriangle>>(*source);
+    cases.push_back({"ndc", "triangles", nofBatchTriangles, [=](){
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < triangles->size(); i++){
+            auto &triangle = (*triangles)[i];
+            triangle.ov1.ov.gl_Position = (*source)[i].ov1.ov.gl_Position;
+            triangle.ov2.ov.gl_Position = (*source)[i].ov2.ov.gl_Position;
+            triangle.ov3.ov.gl_Position = (*source)[i].ov3.ov.gl_Position;
+            ndc(triangle);
+            hash = hashTriangle(triangle, hash);
+        }
+        return hash;
+    }});
+}
+
+void addViewportCases(std::vector<KernelCase> &cases){
+    auto gpu = std::make_shared<GPU>();
+    gpu->createFramebuffer(1920, 1080);
+    auto source = std::make_shared<std::vector<PrimitiveTriangle>>(clipSpaceTriangles(0, 1));
+    auto triangles = std::make_shared<std::vector<PrimitiveTriangle>>(*source);
+    cases.push_back({"GPU::viewport_transform", "triangles 1920x1080", nofBatchTriangles, [=](){
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < triangles->size(); i++){
+            auto &triangle = (*triangles)[i];
+            triangle.ov1.ov.gl_Position = (*source)[i].ov1.ov.gl_Position;
+            triangle.ov2.ov.gl_Position = (*source)[i].ov2.ov.gl_Position;
+            triangle.ov3.ov.gl_Position = (*source)[i].ov3.ov.gl_Position;
+            gpu->viewport_transform(triangle);
+            hash = hashTriangle(triangle, hash);
+        }
+        return hash;
+    }});
+}
+
+void addRasterizeCases(std::vector<KernelCase> &cases){
+    float const size = (float) rasterizationSize;
+    struct Shape {
+        char const *name;
+        glm::vec3 a, b, c;
+    };
+    Shape const shapes[] = {
+        {"tiny"  , {10.2f, 10.3f, 0.5f}, {12.7f, 10.1f, 0.5f}, {11.1f, 12.9f, 0.5f}},
+        {"medium", {20.f, 20.f, 0.2f}, {120.f, 30.f, 0.5f}, {60.f, 110.f, 0.8f}},
+        {"huge"  , {-100.f, -100.f, 0.5f}, {3.f * size, -100.f, 0.5f}, {-100.f, 3.f * size, 0.5f}},
+        {"sliver", {0.f, 0.2f, 0.5f}, {size - 1.f, 1.f, 0.5f}, {size - 1.f, 2.6f, 0.5f}},
+    };
+    for (auto const &shape : shapes)
+        for (uint32_t nofAttributes : {1u, 4u, 16u}){
+            auto gpu = std::make_shared<GPU>();
+            gpu->createFramebuffer(rasterizationSize, rasterizationSize);
+            Program *program = createBenchmarkProgram(*gpu, nofAttributes);
+            auto triangle = screenSpaceTriangle(shape.a, shape.b, shape.c, nofAttributes);
+            auto fragments = std::make_shared<std::vector<InFragment>>();
+            gpu->rasterize(program, *fragments, triangle);
+            uint64_t const nofFragments = std::max<uint64_t>(fragments->size(), 1);
+            cases.push_back({"GPU::rasterize", std::string(shape.name) + " triangle, " + std::to_string(nofAttributes) + " attributes",
+                             nofFragments, [=](){
+                fragments->clear();
+                gpu->rasterize(program, *fragments, triangle);
+                uint64_t hash = fragments->size();
+                for (auto const &fragment : *fragments)
+                    hash = hashBytes(&fragment.gl_FragCoord, sizeof(glm::vec4), hash);
+                return hash;
+            }});
+        }
+}
+
+void addDepthCases(std::vector<KernelCase> &cases){
+    for (bool pass : {true, false}){
+        auto gpu = std::make_shared<GPU>();
+        gpu->createFramebuffer(rasterizationSize, rasterizationSize);
+        gpu->clear(0.f, 0.f, 0.f, 1.f);
+        if (not pass)
+            std::fill_n(gpu->getFramebufferDepth(), rasterizationSize * rasterizationSize, -FLT_MAX);
+        auto fragments = std::make_shared<std::vector<InFragment>>(nofBatchFragments);
+        uint32_t seed = 1;
+        for (auto &fragment : *fragments){
+            seed = seed * 1664525u + 1013904223u;
+            fragment.gl_FragCoord = glm::vec4((float) ((seed >> 8) % rasterizationSize) + 0.5f,
+                                              (float) ((seed >> 20) % rasterizationSize) + 0.5f, 0.f, 1.f);
+        }
+        auto depth = std::make_shared<float>(0.f);
+        OutFragment outFragment;
+        outFragment.gl_FragColor = glm::vec4(0.25f, 0.5f, 0.75f, 1.f);
+        cases.push_back({"GPU::depth_correction", pass ? "passing fragments" : "failing fragments", nofBatchFragments, [=](){
+            *depth -= 1.f;
+            uint64_t nofPassed = 0;
+            for (auto &fragment : *fragments){
+                fragment.gl_FragCoord[2] = *depth;
+                nofPassed += gpu->depth_correction(outFragment, fragment);
+            }
+            return nofPassed;
+        }});
+    }
+}
+
+void addClearCases(std::vector<KernelCase> &cases){
+    for (glm::uvec2 resolution : {glm::uvec2(500, 500), glm::uvec2(1920, 1080)}){
+        auto gpu = std::make_shared<GPU>();
+        gpu->createFramebuffer(resolution.x, resolution.y);
+        uint64_t const nofPixels = (uint64_t) resolution.x * resolution.y;
+        cases.push_back({"GPU::clear", std::to_string(resolution.x) + "x" + std::to_string(resolution.y), nofPixels, [=](){
+            gpu->clear(0.25f, 0.5f, 0.75f, 1.f);
+            return hashBytes(gpu->getFramebufferColor(), nofPixels * 4, hashBytes(gpu->getFramebufferDepth(), nofPixels * sizeof(float)));
+        }});
+    }
+}
+
+void addVertexProcessorCases(std::vector<KernelCase> &cases){
+    struct Indexing {
+        char const *name;
+        bool enabled;
+        IndexType type;
+    };
+    Indexing const indexings[] = {
+        {"no indices", false, IndexType::UINT32},
+        {"uint8 indices", true, IndexType::UINT8},
+        {"uint16 indices", true, IndexType::UINT16},
+        {"uint32 indices", true, IndexType::UINT32},
+    };
+    uint32_t const nofVertices = 3 * nofBatchTriangles;
+    for (auto const &indexing : indexings)
+        for (uint32_t nofAttributes : {1u, 2u, 4u, 8u, 16u}){
+            auto gpu = std::make_shared<GPU>();
+            uint32_t const nofStoredVertices = indexing.enabled ? nofUniqueVertices : nofVertices;
+            std::vector<glm::vec4> vertices(nofStoredVertices * nofAttributes);
+            for (size_t i = 0; i < vertices.size(); i++)
+                vertices[i] = glm::vec4((float) i, (float) (i % 7), (float) (i % 13), 1.f);
+            BufferID vbo = gpu->createBuffer(vertices.size() * sizeof(glm::vec4));
+            gpu->setBufferData(vbo, 0, vertices.size() * sizeof(glm::vec4), vertices.data());
+
+            VertexPullerID vao = gpu->createVertexPuller();
+            for (uint32_t i = 0; i < nofAttributes; i++){
+                gpu->setVertexPullerHead(vao, i, AttributeType::VEC4, nofAttributes * sizeof(glm::vec4), i * sizeof(glm::vec4), vbo);
+                gpu->enableVertexPullerHead(vao, i);
+            }
+            if (indexing.enabled){
+                uint32_t const indexSize = (uint32_t) indexing.type;
+                std::vector<uint8_t> indices(nofVertices * indexSize);
+                uint32_t seed = 7;
+                for (uint32_t i = 0; i < nofVertices; i++){
+                    seed = seed * 1664525u + 1013904223u;
+                    uint32_t index = (seed >> 16) % nofUniqueVertices;
+                    std::memcpy(indices.data() + i * indexSize, &index, indexSize);
+                }
+                BufferID ebo = gpu->createBuffer(indices.size());
+                gpu->setBufferData(ebo, 0, indices.size(), indices.data());
+                gpu->setVertexPullerIndexing(vao, indexing.type, ebo);
+            }
+            gpu->bindVertexPuller(vao);
+            Program *program = createBenchmarkProgram(*gpu, nofAttributes);
+            auto output = std::shared_ptr<OutAbstractVertex>(new OutAbstractVertex[nofVertices], std::default_delete<OutAbstractVertex[]>());
+            DrawCommand const command{nofVertices, 1, 0, 0, 0};
+            cases.push_back({"GPU::vertexProcessor", std::string(indexing.name) + ", " + std::to_string(nofAttributes) + " attributes",
+                             nofVertices, [=](){
+                DrawVertexPuller const vertexPuller = gpu->lookupDrawVertexPuller(gpu->activeVertexPuller);
+                gpu->vertexProcessor(vertexPuller, gpu->prepareDrawCommand(vertexPuller, *program, command), command, output.get(), program);
+                uint64_t hash = 14695981039346656037ull;
+                for (uint32_t i = 0; i < nofVertices; i++)
+                    hash = hashBytes(&output.get()[i].ov.gl_Position, sizeof(glm::vec4), hash);
+                return hash;
+            }});
+        }
+}
+
+void addAttributeFormatCases(std::vector<KernelCase> &cases){
+    struct Format {
+        char const *name;
+        AttributeFormat format;
+    };
+    Format const formats[] = {
+        {"float32", AttributeFormat::FLOAT32},
+        {"half", AttributeFormat::HALF},
+        {"snorm8", AttributeFormat::SNORM8},
+        {"unorm8", AttributeFormat::UNORM8},
+        {"snorm16", AttributeFormat::SNORM16},
+        {"unorm16", AttributeFormat::UNORM16},
+        {"snorm 10-10-10-2", AttributeFormat::SNORM_10_10_10_2},
+        {"unorm 10-10-10-2", AttributeFormat::UNORM_10_10_10_2},
+    };
+    uint32_t const nofVertices = 3 * nofBatchTriangles;
+    uint32_t const nofAttributes = 4;
+    for (auto const &format : formats){
+        auto gpu = std::make_shared<GPU>();
+        uint32_t const size = attributeSize(format.format, AttributeType::VEC4);
+        std::vector<uint8_t> vertices(nofVertices * nofAttributes * size);
+        for (uint32_t i = 0; i < nofVertices * nofAttributes; i++)
+            packAttribute(vertices.data() + i * size, glm::vec4((float) (i % 256) / 255.f, (float) (i % 7) / 7.f, -(float) (i % 13) / 13.f, 1.f),
+                          format.format, AttributeType::VEC4);
+        BufferID vbo = gpu->createBuffer(vertices.size());
+        gpu->setBufferData(vbo, 0, vertices.size(), vertices.data());
+
+        VertexPullerID vao = gpu->createVertexPuller();
+        for (uint32_t i = 0; i < nofAttributes; i++){
+            gpu->setVertexPullerHead(vao, i, AttributeType::VEC4, nofAttributes * size, i * size, vbo);
+            gpu->setVertexPullerHeadFormat(vao, i, format.format);
+            gpu->enableVertexPullerHead(vao, i);
+        }
+        gpu->bindVertexPuller(vao);
+        Program *program = createBenchmarkProgram(*gpu, nofAttributes);
+        auto output = std::shared_ptr<OutAbstractVertex>(new OutAbstractVertex[nofVertices], std::default_delete<OutAbstractVertex[]>());
+        DrawCommand const command{nofVertices, 1, 0, 0, 0};
+        cases.push_back({"GPU::vertexProcessor", std::string(format.name) + " format, " + std::to_string(nofAttributes) + " attributes",
+                         nofVertices, [=](){
+            DrawVertexPuller const vertexPuller = gpu->lookupDrawVertexPuller(gpu->activeVertexPuller);
+            gpu->vertexProcessor(vertexPuller, gpu->prepareDrawCommand(vertexPuller, *program, command), command, output.get(), program);
+            uint64_t hash = 14695981039346656037ull;
+            for (uint32_t i = 0; i < nofVertices; i++)
+                hash = hashBytes(&output.get()[i].ov.gl_Position, sizeof(glm::vec4), hash);
+            return hash;
+        }});
+    }
+}
+
+void addBufferCodecCases(std::vector<KernelCase> &cases){
+    uint32_t const nofAttributes = 4;
+    uint32_t const vertexSize = nofAttributes * sizeof(glm::vec4);
+    std::vector<glm::vec4> vertices(nofUniqueVertices * nofAttributes);
+    for (size_t i = 0; i < vertices.size(); i++)
+        vertices[i] = glm::vec4((float) (i / nofAttributes) * 0.01f, (float) (i % 7), (float) (i % 13), 1.f);
+    std::vector<uint32_t> indices(3 * nofBatchTriangles);
+    for (uint32_t i = 0; i < indices.size(); i++)
+        indices[i] = (i / 3 + i % 3) % nofUniqueVertices;
+    auto encodedVertices = std::make_shared<std::vector<uint8_t>>(encodeVertexBuffer(vertices.data(), nofUniqueVertices, vertexSize));
+    auto encodedIndices = std::make_shared<std::vector<uint8_t>>(encodeIndexBuffer(indices.data(), (uint32_t) indices.size()));
+
+    auto decodedVertices = std::make_shared<std::vector<uint8_t>>(vertices.size() * sizeof(glm::vec4));
+    cases.push_back({"decodeVertexBuffer", std::to_string(vertexSize) + " B vertices", nofUniqueVertices, [=](){
+        decodeVertexBuffer(decodedVertices->data(), encodedVertices->data(), encodedVertices->size());
+        return hashBytes(decodedVertices->data(), decodedVertices->size());
+    }});
+    auto decodedIndices = std::make_shared<std::vector<uint32_t>>(indices.size());
+    cases.push_back({"decodeIndexRange", "strip-like indices", (uint32_t) indices.size(), [=](){
+        decodeIndexRange(decodedIndices->data(), encodedIndices->data(), encodedIndices->size(), 0, (uint32_t) decodedIndices->size());
+        return hashBytes(decodedIndices->data(), decodedIndices->size() * sizeof(uint32_t));
+    }});
+
+    for (bool encoded : {false, true}){
+        auto gpu = std::make_shared<GPU>();
+        void const *vertexData = encoded ? (void const *) encodedVertices->data() : (void const *) vertices.data();
+        uint64_t const vertexBytes = encoded ? encodedVertices->size() : vertices.size() * sizeof(glm::vec4);
+        BufferID vbo = gpu->createBuffer(vertexBytes);
+        gpu->setBufferData(vbo, 0, vertexBytes, vertexData);
+        void const *indexData = encoded ? (void const *) encodedIndices->data() : (void const *) indices.data();
+        uint64_t const indexBytes = encoded ? encodedIndices->size() : indices.size() * sizeof(uint32_t);
+        BufferID ebo = gpu->createBuffer(indexBytes);
+        gpu->setBufferData(ebo, 0, indexBytes, indexData);
+        if (encoded){
+            gpu->setBufferEncoding(vbo, BufferEncoding::VERTEX);
+            gpu->setBufferEncoding(ebo, BufferEncoding::INDEX);
+        }
+
+        VertexPullerID vao = gpu->createVertexPuller();
+        for (uint32_t i = 0; i < nofAttributes; i++){
+            gpu->setVertexPullerHead(vao, i, AttributeType::VEC4, vertexSize, i * sizeof(glm::vec4), vbo);
+            gpu->enableVertexPullerHead(vao, i);
+        }
+        gpu->setVertexPullerIndexing(vao, IndexType::UINT32, ebo);
+        gpu->bindVertexPuller(vao);
+        Program *program = createBenchmarkProgram(*gpu, nofAttributes);
+        uint32_t const nofVertices = (uint32_t) indices.size();
+        auto output = std::shared_ptr<OutAbstractVertex>(new OutAbstractVertex[nofVertices], std::default_delete<OutAbstractVertex[]>());
+        DrawCommand const command{nofVertices, 1, 0, 0, 0};
+        cases.push_back({"GPU::vertexProcessor", std::string(encoded ? "encoded" : "raw") + " buffers, " + std::to_string(nofAttributes) + " attributes",
+                         nofVertices, [=](){
+            DrawVertexPuller const vertexPuller = gpu->lookupDrawVertexPuller(gpu->activeVertexPuller);
+            gpu->vertexProcessor(vertexPuller, gpu->prepareDrawCommand(vertexPuller, *program, command), command, output.get(), program);
+            uint64_t hash = 14695981039346656037ull;
+            for (uint32_t i = 0; i < nofVertices; i++)
+                hash = hashBytes(&output.get()[i].ov.gl_Position, sizeof(glm::vec4), hash);
+            return hash;
+        }});
+    }
+}
+
+void addCopyToSDLSurfaceCases(std::vector<KernelCase> &cases){
+    for (glm::uvec2 resolution : {glm::uvec2(500, 500), glm::uvec2(1920, 1080)}){
+        std::shared_ptr<SDL_Surface> surface(
+            SDL_CreateRGBSurfaceWithFormat(0, (int) resolution.x, (int) resolution.y, 32, SDL_PIXELFORMAT_RGBA32), SDL_FreeSurface);
+        if (!surface)
+            continue;
+        auto color = std::make_shared<std::vector<uint8_t>>((size_t) resolution.x * resolution.y * 4);
+        for (size_t i = 0; i < color->size(); i++)
+            (*color)[i] = (uint8_t) (i * 31);
+        cases.push_back({"copyToSDLSurface", std::to_string(resolution.x) + "x" + std::to_string(resolution.y),
+                         (uint64_t) resolution.x * resolution.y, [=](){
+            copyToSDLSurface(surface.get(), color->data(), resolution.x, resolution.y);
+            return hashBytes(surface->pixels, (size_t) surface->pitch * surface->h);
+        }});
+    }
+}
+
+/**
+ * @brief Measures one case.
+ * @param kernelCase case
+ * @param settings settings
+ * @return result
+ */
+KernelBenchmarkResult measure(KernelCase const &kernelCase, KernelBenchmarkSettings const &settings){
+    KernelBenchmarkResult result;
+    result.kernel = kernelCase.kernel;
+    result.input = kernelCase.input;
+    result.operations = kernelCase.operations;
+
+    Timer<double> timer;
+    result.checksum = kernelCase.run();
+    double const single = std::max(timer.elapsedFromStart(), 1e-9);
+    auto const iterations = (uint64_t) std::max(1.0, std::ceil(settings.repetitionTime / single));
+
+    std::vector<double> times;
+    for (uint32_t r = 0; r < std::max(settings.repetitions, 1u); r++){
+        timer.reset();
+        for (uint64_t i = 0; i < iterations; i++)
+            kernelCase.run();
+        times.push_back(timer.elapsedFromStart() / (double) iterations * 1e9);
+    }
+    std::sort(times.begin(), times.end());
+    result.medianNs = times[times.size() / 2];
+    result.minNs = times.front();
+    return result;
+}
+
+}
+
+/**
+ * @brief Runs all kernel microbenchmark cases, progress is written into standard error output.
+ * @param settings settings
+ * @return results of all cases
+ */
+std::vector<KernelBenchmarkResult> runKernelBenchmarkCases(KernelBenchmarkSettings const &settings){
+    std::vector<KernelCase> cases;
+    addClipCases(cases);
+    addNdcCases(cases);
+    addViewportCases(cases);
+    addRasterizeCases(cases);
+    addDepthCases(cases);
+    addClearCases(cases);
+    addVertexProcessorCases(cases);
+    addAttributeFormatCases(cases);
+    addBufferCodecCases(cases);
+    addCopyToSDLSurfaceCases(cases);
+
+    std::vector<KernelBenchmarkResult> results;
+    for (auto const &kernelCase : cases){
+        results.push_back(measure(kernelCase, settings));
+        std::cerr << std::left << std::setw(24) << kernelCase.kernel << std::setw(48) << kernelCase.input
+                  << std::right << std::setw(14) << std::fixed << std::setprecision(1) << results.back().medianNs << " ns"
+                  << std::defaultfloat << std::endl;
+    }
+    return results;
+}
+
+/**
+ * @brief Writes results in JSON format.
+ * @param stream output stream
+ * @param results results
+ */
+void writeKernelBenchmarkJson(std::ostream &stream, std::vector<KernelBenchmarkResult> const &results){
+    stream << std::setprecision(6) << "{\n  \"kernels\": [";
+    for (size_t i = 0; i < results.size(); i++){
+        auto const &result = results[i];
+        stream << (i == 0 ? "\n" : ",\n")
+               << "    {\"kernel\": \"" << result.kernel << "\", \"input\": \"" << result.input
+               << "\", \"operations\": " << result.operations << ", \"medianNs\": " << result.medianNs
+               << ", \"minNs\": " << result.minNs
+               << ", \"nsPerOperation\": " << result.medianNs / (double) std::max<uint64_t>(result.operations, 1)
+               << ", \"checksum\": \"" << std::hex << result.checksum << std::dec << "\"}";
+    }
+    stream << "\n  ]\n}" << std::endl;
+}
+
+/**
+ * @brief Writes results in CSV format, the output can be used as baseline.
+ * @param stream output stream
+ * @param results results
+ */
+void writeKernelBenchmarkCsv(std::ostream &stream, std::vector<KernelBenchmarkResult> const &results){
+    stream << std::setprecision(6) << "kernel,input,operations,median_ns,min_ns,ns_per_operation,checksum" << std::endl;
+    for (auto const &result : results)
+        stream << "\"" << result.kernel << "\",\"" << result.input << "\"," << result.operations << ","
+               << result.medianNs << "," << result.minNs << ","
+               << result.medianNs / (double) std::max<uint64_t>(result.operations, 1) << ","
+               << std::hex << result.checksum << std::dec << std::endl;
+}
+
+/**
+ * @brief Reads results written by writeKernelBenchmarkCsv.
+ * @param stream input stream
+ * @return results stored in the stream
+ * @throw std::runtime_error if a number of a line cannot be parsed
+ */
+std::vector<KernelBenchmarkResult> readKernelBenchmarkCsv(std::istream &stream){
+    std::vector<KernelBenchmarkResult> results;
+    std::string line;
+    std::getline(stream, line);
+    for (uint32_t lineNumber = 2; std::getline(stream, line); lineNumber++){
+        std::vector<std::string> fields(1);
+        bool quoted = false;
+        for (char c : line){
+            if (c == '"')
+                quoted = not quoted;
+            else if (c == ',' and not quoted)
+                fields.emplace_back();
+            else if (c != '\r')
+                fields.back() += c;
+        }
+        if (fields.size() < 7)
+            continue;
+        KernelBenchmarkResult result;
+        result.kernel = fields[0];
+        result.input = fields[1];
+        try{
+            result.operations = std::stoull(fields[2]);
+            result.medianNs = std::stod(fields[3]);
+            result.minNs = std::stod(fields[4]);
+            result.checksum = std::stoull(fields[6], nullptr, 16);
+        }
+        catch (std::logic_error const &){
+            // invalid_argument and out_of_range of stoull and stod
+            throw std::runtime_error("invalid number on line " + std::to_string(lineNumber) + ": " + line);
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+/**
+ * @brief Compares results with baseline, differences are written into standard error output.
+ * @param results results
+ * @param baseline stored results
+ * @param threshold allowed slowdown of median time in percent
+ * @return true if all checksums match and no case is slower than baseline by more than threshold
+ */
+bool compareKernelsWithBaseline(std::vector<KernelBenchmarkResult> const &results,
+                                std::vector<KernelBenchmarkResult> const &baseline, float threshold){
+    std::map<std::pair<std::string, std::string>, KernelBenchmarkResult> stored;
+    for (auto const &result : baseline)
+        stored[{result.kernel, result.input}] = result;
+
+    bool passed = true;
+    for (auto const &result : results){
+        auto it = stored.find({result.kernel, result.input});
+        if (it == stored.end())
+            continue;
+        if (it->second.checksum != result.checksum){
+            std::cerr << "output changed: " << result.kernel << " " << result.input << std::endl;
+            passed = false;
+        }
+        double const change = it->second.medianNs > 0.0 ? (result.medianNs / it->second.medianNs - 1.0) * 100.0 : 0.0;
+        if (change > threshold){
+            std::cerr << "regression: " << result.kernel << " " << result.input << " " << it->second.medianNs
+                      << " ns -> " << result.medianNs << " ns (+" << change << " %)" << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+/**
+ * @brief Runs kernel microbenchmarks, writes results and compares them with baseline.
+ * @param settings settings
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if results could not be written or baseline comparison failed
+ */
+int runKernelBenchmarks(KernelBenchmarkSettings const &settings){
+    auto const results = runKernelBenchmarkCases(settings);
+
+    std::ofstream file;
+    if (not settings.outputFile.empty()){
+        file.open(settings.outputFile);
+        if (not file.is_open()){
+            std::cerr << "cannot write kernel benchmark results into " << settings.outputFile << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream &output = settings.outputFile.empty() ? std::cout : file;
+    if (settings.format == "csv")
+        writeKernelBenchmarkCsv(output, results);
+    else
+        writeKernelBenchmarkJson(output, results);
+
+    if (settings.baselineFile.empty())
+        return EXIT_SUCCESS;
+    std::ifstream baselineFile(settings.baselineFile);
+    if (not baselineFile.is_open()){
+        std::cerr << "cannot read kernel benchmark baseline " << settings.baselineFile << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<KernelBenchmarkResult> baseline;
+    try{
+        baseline = readKernelBenchmarkCsv(baselineFile);
+    }
+    catch (std::runtime_error const &error){
+        std::cerr << "cannot read kernel benchmark baseline " << settings.baselineFile << ": " << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return compareKernelsWithBaseline(results, baseline, settings.threshold) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,45 @@
+/*!
+ * @file
+ * @brief This file contains microbenchmarks of individual pipeline kernels.
+ */
+
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <student/gpu.hpp>
+
+/**
+ * @brief Settings of kernel microbenchmarks.
+ */
+struct KernelBenchmarkSettings {
+    uint32_t repetitions = 15;        ///< number of measured repetitions of each case
+    double repetitionTime = 0.01;     ///< minimal duration of one repetition in seconds
+    std::string outputFile;           ///< file for results, empty means standard output
+    std::string format = "json";      ///< format of results: json or csv
+    std::string baselineFile;         ///< csv file with stored results, empty means no comparison
+    float threshold = 10.f;           ///< allowed slowdown of median time in percent
+};
+
+/**
+ * @brief Result of one kernel microbenchmark case.
+ */
+struct KernelBenchmarkResult {
+    std::string kernel;          ///< name of kernel
+    std::string input;           ///< name of synthetic input
+    uint64_t operations = 0;     ///< number of operations (triangles, vertices, fragments, pixels) in one call of the case
+    double medianNs = 0.0;       ///< median time of one call in nanoseconds
+    double minNs = 0.0;          ///< minimal time of one call in nanoseconds
+    uint64_t checksum = 0;       ///< checksum of kernel output, it has to stay the same when kernel is optimised
+};
+
+std::vector<KernelBenchmarkResult> runKernelBenchmarkCases(KernelBenchmarkSettings const &settings);
+void writeKernelBenchmarkJson(std::ostream &stream, std::vector<KernelBenchmarkResult> const &results);
+void writeKernelBenchmarkCsv(std::ostream &stream, std::vector<KernelBenchmarkResult> const &results);
+std::vector<KernelBenchmarkResult> readKernelBenchmarkCsv(std::istream &stream);
+bool compareKernelsWithBaseline(std::vector<KernelBenchmarkResult> const &results,
+                                std::vector<KernelBenchmarkResult> const &baseline, float threshold);
+int runKernelBenchmarks(KernelBenchmarkSettings const &settings);
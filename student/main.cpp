@@ -2,19 +2,16 @@
 
 #include<student/window.hpp>
 #include<student/application.hpp>
-#include<student/emptyMethod.hpp>
-#include<student/triangleMethod.hpp>
-#include<student/triangleClip1Method.hpp>
-#include<student/triangleClip2Method.hpp>
-#include<student/triangle3DMethod.hpp>
-#include<student/triangleBufferMethod.hpp>
-#include<student/czFlagMethod.hpp>
-#include<student/phongMethod.hpp>
+#include<student/methodRegistry.hpp>
 #include<tests/conformanceTests.hpp>
 #include<tests/performanceTest.hpp>
 #include<tests/takeScreenShot.hpp>
 
 #include<student/arguments.hpp>
+#include<student/benchmark.hpp>
+#include<student/kernelBenchmark.hpp>
+#include<student/stressTest.hpp>
+#include<student/meshConverter.hpp>
 
 int main(int argc,char*argv[]){
   try{
@@ -32,21 +29,57 @@ int main(int argc,char*argv[]){
       return 0;
     }
 
+    if(args.runBenchmark){
+      BenchmarkSettings settings;
+      settings.frames       = args.benchFrames;
+      settings.resolutions.clear();
+      for(size_t i=0;i+1<args.benchResolutions.size();i+=2)
+        settings.resolutions.push_back(glm::uvec2(args.benchResolutions[i],args.benchResolutions[i+1]));
+      settings.threads.assign(args.benchThreads.begin(),args.benchThreads.end());
+      settings.outputFile   = args.benchOutput;
+      settings.format       = args.benchFormat;
+      settings.baselineFile = args.benchBaseline;
+      settings.threshold    = args.benchThreshold;
+      settings.meshFile     = args.meshFile;
+      if(args.benchTrace)settings.traceFile = args.traceFile;
+      return runBenchmark(settings);
+    }
+
+    if(args.runKernelBenchmark){
+      KernelBenchmarkSettings settings;
+      settings.repetitions  = args.kernelRepetitions;
+      settings.outputFile   = args.benchOutput;
+      settings.format       = args.benchFormat;
+      settings.baselineFile = args.benchBaseline;
+      settings.threshold    = args.benchThreshold;
+      return runKernelBenchmarks(settings);
+    }
+
+    if(args.runStressTest){
+      StressTestSettings settings;
+      settings.uploaders  = args.stressThreads;
+      settings.iterations = args.stressIterations;
+      settings.frames     = args.stressFrames;
+      return runStressTest(settings);
+    }
+
+    if(!args.convertMesh.empty()){
+      MeshConverterSettings settings;
+      settings.input  = args.convertInput;
+      settings.output = args.convertMesh;
+      settings.encode = args.convertEncode;
+      return runMeshConverter(settings);
+    }
+
     if(args.takeScreenShot){
       takeScreenShot(args.groundTruthFile);
       return 0;
     }
 
     auto app = Application(args.windowSize[0],args.windowSize[1]);
-    app.registerMethod<EmptyMethod         >("empty window"                                     );
-    app.registerMethod<TriangleMethod      >("triangle 2D"                                      );
-    app.registerMethod<TriangleClip1Method >("triangle clipping (one point behind near plane)"  );
-    app.registerMethod<TriangleClip2Method >("triangle clipping (two points behind near plane)" );
-    app.registerMethod<Triangle3DMethod    >("triangle 3D"                                      );
-    app.registerMethod<TriangleBufferMethod>("triangle stored in buffer"                        );
-    app.registerMethod<CZFlagMethod>        ("czech flag"                                       );
-    app.registerMethod<PhongMethod         >("phong bunny"                                      );
+    app.registerMethods(registeredMethods(args.meshFile));
     app.setMethod(args.method);
+    app.setTraceFile(args.traceFile);
     app.start();
 
   }catch(std::exception&e){
@@ -67,6 +100,37 @@ int main(int argc,char*argv[]){
  * Identifikátor bufferu musí být unikátní.
  * \link emptyID \endlink je prázdný identifikátor, který nesmí být použit pro existující buffer.
  *
+ * Paměť bufferů přiděluje \link BufferAllocator \endlink: je zarovnaná na \link bufferAlignment \endlink bajtů,
+ * malé buffery (do \link maxPooledBlockSize \endlink) se berou z poolů bloků o velikosti mocnin dvou,
+ * velké buffery se mapují přímo od systému (mmap, VirtualAlloc).
+ * Spotřebu paměti (aktuální, maximální a rezervovanou) vrací \ref GPU::getMemoryUsage.
+ *
+ * \ref GPU::mapBuffer vrátí ukazatel přímo do paměti bufferu, data se tak zapisují bez kopírování.
+ * Příznak \link mapInvalidateBuffer \endlink buffer "osiří" - dostane novou paměť a starý obsah zahodí.
+ * Bez příznaku \link mapPersistent \endlink nelze z namapovaného bufferu kreslit ani do něj nahrávat setBufferData,
+ * dokud není zavoláno \ref GPU::unmapBuffer.
+ *
+ * \ref GPU::setBufferDataAsync nahraje data do bufferu na pozadí (vlákno fronty \link UploadQueue \endlink).
+ * Data se kopírují do fronty ještě ve volajícím vlákně; varianta s std::vector&& je převezme bez kopie.
+ * Kreslení a ostatní práce s bufferem čeká jen na nahrávání do bufferů, které používá.
+ * \ref GPU::fenceSync vytvoří synchronizační objekt a \ref GPU::clientWaitSync počká (nebo jen otestuje při timeout 0),
+ * zda jsou všechna dříve zadaná nahrávání dokončena.
+ *
+ * Vytváření, mazání a plnění bufferů, vertex pullerů, programů, synchronizačních objektů a dotazů je možné volat z více vláken najednou (např. paralelní načítání modelů).
+ * Objekty jsou uložené v tabulkách \link ObjectTable \endlink rozdělených na části s vlastním zámkem
+ * a identifikátory se přidělují z atomického čítače, takže se nikdy neopakují.
+ * Smazaný buffer žije, dokud ho používá kreslení nebo nahrávání v jiném vlákně.
+ * Kreslení si vertex puller, jeho buffery a program vyhledá jednou za dávku; smazání během kreslení ho nepřeruší,
+ * kreslení s už smazaným vertex pullerem nebo programem vyhodí std::range_error.
+ * Navázání (bindVertexPuller, useProgram, beginQuery, beginConditionalRender) a kreslení patří jednomu vláknu.
+ * Smazaný aktivní dotaz žije do endQuery, resp. endConditionalRender.
+ *
+ * Buffer může obsahovat komprimovaná data (\ref GPU::setBufferEncoding, \link BufferEncoding \endlink).
+ * \ref encodeVertexBuffer rozdělí vrcholy do bloků, každý bajt vrcholu uloží jako rozdíl od předchozího vrcholu (zigzag)
+ * zabalený na 0, 2, 4 nebo 8 bitů, \ref encodeIndexBuffer uloží rozdíly indexů jako varint.
+ * Vertex puller dekóduje bloky vrcholů až při čtení (několik posledních bloků drží v paměti) a z indexů jen kreslený rozsah.
+ * Čtecí hlava komprimovaného bufferu musí mít stride rovný velikosti vrcholu.
+ *
  */
 
 
@@ -103,8 +167,33 @@ int main(int argc,char*argv[]){
  * U neindexovaného kreslení je číslo vrcholu \ref InVertex::gl_VertexID rovno číslu invokace vertex shaderu.
  * U indexovaného kreslení je číslo vrcholu \ref InVertex::gl_VertexID rovno hodnodě z indexačního bufferu.
  * Hodnota z indexačního bufferu je vybrána číslem invokace vertex shaderu.
+ * Kreslení rozsahu (\ref GPU::drawTrianglesRange, \ref GPU::drawTrianglesBaseVertex) začne položkou firstIndex
+ * (bez indexování vrcholem firstVertex) a ke každému indexu přičte baseVertex,
+ * díky tomu může být více modelů uloženo v jednom vertex a index bufferu a sdílet jeden vertex puller.
  *
  * \image html images/drawElements.svg "Neindexované a indexované kreslení."
+ *
+ * <b>Instancované kreslení</b> (\ref GPU::drawTrianglesInstanced) vykreslí stejné vrcholy vícekrát,
+ * číslo kopie dostane vertex shader v \ref InVertex::gl_InstanceID.
+ * Čtecí hlava s nenulovým dělitelem (\ref GPU::setVertexPullerHeadDivisor) čte atribut z adresy
+ * buf_ptr + offset + stride*(gl_InstanceID/dělitel), takže se posune jednou za "dělitel" instancí.
+ * Vrcholy indexovaného kreslení se v rámci jedné instance znovu použijí z post-transform cache
+ * (\link postTransformCacheSize \endlink posledních vrcholů), vertex shader se pro ně nespouští znovu.
+ *
+ * <b>Formát atributu</b> (\ref GPU::setVertexPullerHeadFormat, \link AttributeFormat \endlink) určuje, jak je atribut uložen v bufferu:
+ * 32-bit float (výchozí), 16-bit float, normalizovaná 8/16-bit celá čísla (snorm, unorm) nebo 10-10-10-2 v jednom 32-bit slově.
+ * Čtecí hlava převede hodnoty na floaty, vertex shader se nemění.
+ * Např. normála ve formátu snorm 10-10-10-2 zabírá 4 bajty místo 12.
+ * Data v daném formátu připraví \ref packAttribute, velikost atributu vrátí \ref attributeSize.
+ *
+ * <b>Topologie</b> (\ref GPU::setTopology) určuje, jak se vrcholy skládají do trojúhelníků:
+ * samostatné trojúhelníky, pás (triangle strip) nebo vějíř (triangle fan).
+ * Po \ref GPU::enablePrimitiveRestart ukončí index s maximální hodnotou daného \link IndexType \endlink
+ * (0xff, 0xffff, 0xffffffff) aktuální pás/vějíř a další index začne nový, vertex shader se pro něj nespouští.
+ *
+ * <b>Dávkové kreslení</b> (\ref GPU::multiDrawTriangles) vykreslí pole příkazů \link DrawCommand \endlink
+ * (count, instanceCount, firstIndex, baseVertex, baseInstance) jedním voláním, kontrola a vyhledání stavu proběhne jednou.
+ * \ref GPU::multiDrawTrianglesIndirect čte stejné záznamy z bufferu na grafické kartě.
  */
 
 
@@ -498,6 +587,48 @@ int main(int argc,char*argv[]){
  * - <b>-c ../tests/output.bmp</b> spustí akceptační testy, soubor odkazuje na
  * obrázek s očekávaným výstupem.
  * - <b>-p</b> spustí performanční test.
+ * - <b>-b</b> spustí benchmark všech metod pro různá rozlišení a počty vláken (--bench-resolutions, --bench-threads).
+ *   Seznam metod sdílí s aplikací (\ref registeredMethods), metoda souboru modelu se měří, jen pokud je zadán parametr --mesh.
+ *   Výsledky (p50/p95/p99 doby snímku, fragmenty/s, vrcholy/s) zapíše ve formátu JSON nebo CSV (--bench-format, --bench-output).
+ *   S parametrem --bench-baseline porovná medián doby snímku s uloženým CSV a při zpomalení větším než --bench-threshold procent skončí s nenulovým návratovým kódem.
+ * - <b>-k</b> spustí mikrobenchmarky jednotlivých částí pipeline (clip, ndc, viewport_transform, rasterize, depth_correction, clear, vertexProcessor, copyToSDLSurface)
+ *   nad syntetickými vstupy. Pro každý případ vypíše medián a minimum doby jednoho volání v ns a kontrolní součet výstupu.
+ *   Používá stejné parametry --bench-output, --bench-format, --bench-baseline a --bench-threshold; při porovnání s baseline selže i při změně kontrolního součtu.
+ * - <b>--stress</b> spustí zátěžový test (\ref runStressTest): jedno vlákno kreslí s dotazy a podmíněným vykreslováním,
+ *   --stress-threads vláken souběžně nahrává buffery (--stress-iterations krát), vytváří, čeká na a maže synchronizační objekty a dotazy
+ *   a vytváří a maže vertex pullery a programy, včetně těch, které kreslicí vlákno právě navazuje.
+ *   Nahraná data se čtou zpět a porovnávají; při jakékoliv chybě skončí s nenulovým návratovým kódem.
+ * - <b>--convert-mesh soubor</b> převede model (--convert-input, výchozí je vestavěný králíček) do binárního souboru modelu,
+ *   s --convert-encode jsou proudy komprimovány (\ref encodeVertexBuffer, \ref encodeIndexBuffer).
+ * - <b>--mesh soubor</b> přidá metodu "phong mesh file", která soubor modelu namapuje do paměti (\link MeshFile \endlink)
+ *   a předá ho bufferům GPU bez parsování a kopírování (\ref GPU::createBufferFromMemory).
+ *   Soubory .obj a binární .ply se importují (\ref importMesh): soubor se namapuje, rozdělí na části, které paralelně parsuje více vláken,
+ *   stejné vrcholy (pozice, normála) se sloučí pomocí hashovací tabulky a výsledky se zapisují přímo do namapovaných bufferů GPU.
+ *   Před odmapováním bufferů se trojúhelníky a vrcholy přeuspořádají (\ref optimizeMesh): Tipsify pro FIFO post-transform cache,
+ *   řazení shluků trojúhelníků od vnějších ploch (menší overdraw) a číslování vrcholů podle prvního použití (sekvenční čtení bufferů).
+ *   Stejně se při načtení upraví králíček v "phong bunny".
+ *   "phong bunny" si navíc při načtení vytvoří úrovně detailu (\ref buildLodChain, zjednodušení pomocí kvadrik chyby \ref simplifyMesh),
+ *   které sdílí vrcholy a leží za sebou v jednom index bufferu; při kreslení se vybere nejhrubší úroveň,
+ *   jejíž chyba promítnutá v nejbližším bodě obalové koule je nejvýše jeden pixel (\ref selectLod).
+ *   Každá úroveň je rozdělená na meshlety (\ref buildMeshlets, nejvýše 64 vrcholů a 124 trojúhelníků) s obalovou koulí a kuželem normál;
+ *   GPU před vertex shaderem vyřadí meshlety mimo frustum a se zapnutým ořezem odvrácených stěn (\ref GPU::enableFaceCulling,
+ *   metoda "phong bunny (back-face culling)") i meshlety, jejichž všechny trojúhelníky jsou odvrácené od kamery.
+ *   Vertex puller může mít obalovou kouli nebo kvádr (\ref GPU::setVertexPullerBoundingSphere, \ref GPU::setVertexPullerBoundingBox);
+ *   kreslení, jehož obalové těleso leží mimo frustum, GPU přeskočí celé (čítače "draws tested" a "draws culled" ve statistikách).
+ *   Fragmenty se testují hloubkou před fragment shaderem, který hloubku nemění, takže se stínují jen fragmenty, které testem projdou.
+ *   Metoda "phong bunny (depth prepass)" nejdřív vykreslí jen hloubku (\ref GPU::colorMask, rasterizace bez atributů a fragment shaderu)
+ *   a pak králíčka stínuje s testem \ref DepthFunction::EQUAL bez zápisu hloubky (\ref GPU::depthFunc), každý pixel se tak stínuje jednou.
+ * - Metoda "phong scene (10000 bunnies)" kreslí scénu (\link Scene \endlink): objekty s maticí, meshem a materiálem jsou uložené
+ *   v dynamické hierarchii obalových kvádrů (\link DynamicBvh \endlink), průchod frustem z ní vybere viditelné objekty
+ *   a seznam kreslení se seřadí podle programu a zepředu dozadu; pohybující se objekty mění hierarchii jen při opuštění zvětšeného kvádru.
+ *   Varianta "phong scene (occlusion culling)" před každým objektem vykreslí jeho obalový kvádr bez zápisu do framebufferu
+ *   (\ref GPU::colorMask, \ref GPU::depthMask) v dotazu QueryType::ANY_SAMPLES_PASSED a objekt kreslí podmíněně
+ *   (\ref GPU::beginConditionalRender), takže zcela zakryté objekty se přeskočí.
+ * - Varianty "phong bunny (visibility buffer)" a "phong scene (visibility buffer)" kreslí mezi \ref GPU::beginVisibilityBuffer
+ *   a \ref GPU::resolveVisibilityBuffer: rasterizace jen testuje hloubku a do pixelu zapíše 4bajtové id nejbližšího trojúhelníku,
+ *   uloží se jen trojúhelníky, které vyhrály aspoň jeden pixel (pozice, použité atributy a kreslení s programem a uniformy).
+ *   Resolve pro každý pixel znovu spočítá barycentrické souřadnice, interpoluje atributy a spustí fragment shader právě jednou.
+ *   Převodník vypíše propustnost importu v MB/s a ACMR/ATVR (stínované vrcholy na trojúhelník / na použitý vrchol) před a po optimalizaci.
  *
  * \section ovladani Ovládání
  * Program se ovládá pomocí myši a klávesnice:
@@ -505,6 +636,8 @@ int main(int argc,char*argv[]){
  * - stisknuté pravé tlačítko myši + pohyb myší - přiblížení kamery
  * - "n" - přepne na další scénu/metodu
  *   "p" - přepne na předcházející scénu/metodu
+ *   "i" - vypíše statistiky zobrazovacího řetězce a časy jeho jednotlivých částí v posledním snímku
+ *   "t" - zapíše zaznamenané události do souboru (parametr --trace) ve formátu Chrome trace, lze jej otevřít v Perfetto
  *
  * \section odevzdavani Odevzdávání
  *
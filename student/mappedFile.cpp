@@ -0,0 +1,69 @@
+/*!
+ * @file
+ * @brief This file contains implementation of memory mapped file.
+ */
+
+#include <student/mappedFile.hpp>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Maps whole file into memory.
+ * @param fileName name of the file
+ * @throws std::runtime_error if the file cannot be opened or mapped
+ */
+MappedFile::MappedFile(std::string const &fileName){
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("cannot open " + fileName);
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &fileSize) and fileSize.QuadPart > 0)
+        mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping != nullptr){
+        data = (uint8_t *) MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        size = (uint64_t) fileSize.QuadPart;
+        // the view keeps the mapping alive
+        CloseHandle(mapping);
+    }
+    if (data == nullptr)
+        throw std::runtime_error("cannot map " + fileName);
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+    if (file < 0)
+        throw std::runtime_error("cannot open " + fileName);
+    struct stat status{};
+    if (fstat(file, &status) == 0 and status.st_size > 0){
+        void *mapping = mmap(nullptr, (size_t) status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED){
+            data = (uint8_t *) mapping;
+            size = (uint64_t) status.st_size;
+        }
+    }
+    // the mapping keeps the file alive
+    close(file);
+    if (data == nullptr)
+        throw std::runtime_error("cannot map " + fileName);
+#endif
+}
+
+/**
+ * @brief Unmaps the file.
+ */
+MappedFile::~MappedFile(){
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
@@ -0,0 +1,24 @@
+/*!
+ * @file
+ * @brief This file contains memory mapped file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Read-only file mapped into memory.
+ * The mapping is private (copy-on-write), so the memory can be written without changing the file.
+ * Pages are read from the file when they are touched for the first time.
+ */
+class MappedFile{
+    public:
+        explicit MappedFile(std::string const &fileName);
+        MappedFile(MappedFile const &) = delete;
+        MappedFile &operator=(MappedFile const &) = delete;
+        ~MappedFile();
+        uint8_t *data = nullptr;
+        uint64_t size = 0;
+};
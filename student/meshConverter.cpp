@@ -0,0 +1,83 @@
+/*!
+ * @file
+ * @brief This file contains implementation of converter of meshes into binary mesh files.
+ */
+
+#include <student/meshConverter.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+/**
+ * @brief Loads source mesh of converter.
+ * OBJ and PLY files are imported into GPU buffers (that optimises them) and read back, built-in bunny is optimised by optimizeMeshData.
+ * @param input name of source mesh
+ * @param statistics output statistics of import, may be nullptr
+ * @return mesh
+ * @throws std::runtime_error if the source is not supported
+ */
+MeshData loadMeshData(std::string const &input, MeshImportStatistics *statistics){
+    MeshImportStatistics imported;
+    MeshData mesh;
+    if (input == "bunny"){
+        mesh = bunnyMeshData();
+        imported.optimization = optimizeMeshData(mesh);
+        imported.nofVertices = mesh.nofVertices;
+        imported.nofIndices = (uint32_t) mesh.indices.size();
+        if (statistics != nullptr)
+            *statistics = imported;
+        return mesh;
+    }
+    if (not isImportableMesh(input))
+        throw std::runtime_error("unsupported mesh source " + input);
+    GPU gpu;
+    GPUMesh const gpuMesh = importMesh(gpu, input, &imported);
+    // buffers are allocated before optimisation, unused vertices stay behind referenced ones
+    mesh.nofVertices = imported.nofVertices;
+    auto readBuffer = [&](BufferID buffer, uint64_t size){
+        std::vector<uint8_t> data(size);
+        gpu.getBufferData(buffer, 0, data.size(), data.data());
+        return data;
+    };
+    for (uint32_t head = 0; head + 1 < gpuMesh.buffers.size(); head++){
+        MeshStreamData stream;
+        stream.head   = head;
+        stream.type   = AttributeType::VEC3;
+        stream.stride = sizeof(glm::vec3);
+        stream.data   = readBuffer(gpuMesh.buffers[head], (uint64_t) mesh.nofVertices * stream.stride);
+        mesh.streams.push_back(std::move(stream));
+    }
+    auto const indices = readBuffer(gpuMesh.buffers.back(), (uint64_t) gpuMesh.nofDrawVertices * sizeof(uint32_t));
+    mesh.indices.resize(gpuMesh.nofDrawVertices);
+    std::memcpy(mesh.indices.data(), indices.data(), indices.size());
+    if (statistics != nullptr)
+        *statistics = imported;
+    return mesh;
+}
+
+/**
+ * @brief Converts mesh into mesh file and checks that the written file can be mapped.
+ * @param settings converter settings
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if the file could not be written
+ */
+int runMeshConverter(MeshConverterSettings const &settings){
+    MeshImportStatistics statistics;
+    MeshData const mesh = loadMeshData(settings.input, &statistics);
+    if (statistics.bytes != 0)
+        std::cout << "imported " << settings.input << ": " << statistics.bytes / 1e6 << " MB in " << statistics.seconds << " s ("
+                  << statistics.megabytesPerSecond() << " MB/s, " << statistics.nofThreads << " threads, optimisation "
+                  << statistics.optimizationSeconds << " s)" << std::endl;
+    auto const &optimization = statistics.optimization;
+    std::cout << "vertex cache (" << postTransformCacheSize << " entries): ACMR " << optimization.before.acmr << " -> " << optimization.after.acmr
+              << ", ATVR " << optimization.before.atvr << " -> " << optimization.after.atvr << ", " << optimization.nofClusters
+              << " overdraw clusters" << std::endl;
+    if (not writeMeshFile(settings.output, mesh, settings.encode)){
+        std::cerr << "cannot write mesh file " << settings.output << std::endl;
+        return EXIT_FAILURE;
+    }
+    MeshFile const file(settings.output);
+    std::cout << settings.output << ": " << file.header->nofVertices << " vertices, " << file.header->nofIndices << " indices, "
+              << file.header->nofStreams << " streams, " << file.file->size << " bytes" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,23 @@
+/*!
+ * @file
+ * @brief This file contains converter of meshes into binary mesh files.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <student/meshFile.hpp>
+#include <student/meshImporter.hpp>
+
+/**
+ * @brief Settings of mesh converter.
+ */
+struct MeshConverterSettings {
+    std::string input = "bunny";  ///< source mesh, "bunny" is built-in Stanford bunny, .obj and .ply files are imported
+    std::string output;           ///< mesh file that is written
+    bool encode = false;          ///< compress streams by vertex and index buffer codec
+};
+
+MeshData loadMeshData(std::string const &input, MeshImportStatistics *statistics = nullptr);
+int runMeshConverter(MeshConverterSettings const &settings);
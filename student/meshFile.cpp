@@ -0,0 +1,276 @@
+/*!
+ * @file
+ * @brief This file contains implementation of binary mesh format.
+ */
+
+#include <student/meshFile.hpp>
+#include <student/attributeFormat.hpp>
+#include <student/bufferCodec.hpp>
+#include <student/bunny.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+char const meshFileMagic[4] = {'I', 'Z', 'G', 'M'};
+
+/**
+ * @brief Tests that range lies in file, the test cannot overflow.
+ */
+bool isInFile(uint64_t offset, uint64_t size, uint64_t fileSize){
+    return offset <= fileSize and size <= fileSize - offset;
+}
+
+uint64_t alignOffset(uint64_t offset){
+    return (offset + meshStreamAlignment - 1) / meshStreamAlignment * meshStreamAlignment;
+}
+
+/**
+ * @brief Appends data at aligned offset of file.
+ * @return offset of data
+ */
+uint64_t appendAligned(std::vector<uint8_t> &file, void const *data, uint64_t size){
+    file.resize(alignOffset(file.size()), 0);
+    uint64_t const offset = file.size();
+    file.insert(file.end(), (uint8_t const *) data, (uint8_t const *) data + size);
+    return offset;
+}
+
+}
+
+/**
+ * @brief Maps mesh file and validates its header and stream records.
+ * Stream data are not read, their pages are loaded when GPU reads them.
+ * Index values are not checked here either, vertex puller checks each index against vertex streams when it reads it.
+ *
+ * @param fileName name of mesh file
+ * @throws std::runtime_error if the file cannot be mapped or it is not valid mesh file
+ */
+MeshFile::MeshFile(std::string const &fileName):file(std::make_shared<MappedFile>(fileName)){
+    auto invalid = [&](char const *reason){
+        throw std::runtime_error(fileName + ": " + reason);
+    };
+    if (file->size < sizeof(MeshFileHeader))
+        invalid("file is too small");
+    header = (MeshFileHeader const *) file->data;
+    if (std::memcmp(header->magic, meshFileMagic, sizeof(meshFileMagic)) != 0)
+        invalid("file is not mesh file");
+    if (header->version != meshFileVersion)
+        invalid("unsupported version of mesh file");
+    if (header->nofStreams > maxAttributes or not isInFile(sizeof(MeshFileHeader), header->nofStreams * sizeof(MeshFileStream), file->size))
+        invalid("stream records are out of file");
+    streams = (MeshFileStream const *) (file->data + sizeof(MeshFileHeader));
+
+    for (uint32_t s = 0; s < header->nofStreams; s++){
+        MeshFileStream const &stream = streams[s];
+        if (stream.head >= maxAttributes or stream.type < (uint32_t) AttributeType::FLOAT or stream.type > (uint32_t) AttributeType::VEC4 or
+            stream.format > (uint32_t) AttributeFormat::UNORM_10_10_10_2 or stream.stride == 0)
+            invalid("stream has invalid head, type, format or stride");
+        if (stream.offset % meshStreamAlignment != 0 or not isInFile(stream.offset, stream.size, file->size))
+            invalid("stream is out of file");
+        if (stream.encoding == (uint32_t) BufferEncoding::NONE){
+            uint64_t const needed = header->nofVertices == 0 ? 0 :
+                (uint64_t) stream.stride * (header->nofVertices - 1) + attributeSize((AttributeFormat) stream.format, (AttributeType) stream.type);
+            if (stream.size < needed)
+                invalid("stream is smaller than its vertices");
+        }
+        else if (stream.encoding != (uint32_t) BufferEncoding::VERTEX)
+            invalid("stream has invalid encoding");
+        else if (encodedVertexCount(file->data + stream.offset, stream.size) < header->nofVertices)
+            invalid("encoded stream has fewer vertices than mesh");
+    }
+
+    if (header->nofIndices == 0)
+        return;
+    if (header->indexType != (uint32_t) IndexType::UINT8 and header->indexType != (uint32_t) IndexType::UINT16 and
+        header->indexType != (uint32_t) IndexType::UINT32)
+        invalid("index stream has invalid index type");
+    if (not isInFile(header->indexOffset, header->indexSize, file->size) or header->indexOffset % meshStreamAlignment != 0)
+        invalid("index stream is out of file");
+    if (header->indexEncoding == (uint32_t) BufferEncoding::NONE){
+        if (header->indexSize < (uint64_t) header->nofIndices * header->indexType)
+            invalid("index stream is smaller than its indices");
+    }
+    else if (header->indexEncoding != (uint32_t) BufferEncoding::INDEX)
+        invalid("index stream has invalid encoding");
+    else if (encodedIndexCount(file->data + header->indexOffset, header->indexSize) < header->nofIndices)
+        invalid("encoded index stream has fewer indices than mesh");
+}
+
+/**
+ * @brief Returns built-in Stanford bunny as mesh, positions in head 0 and normals in head 1.
+ * @return mesh
+ */
+MeshData bunnyMeshData(){
+    uint32_t const nofVertices = sizeof(bunnyVertices) / sizeof(BunnyVertex);
+    MeshData mesh;
+    mesh.nofVertices = nofVertices;
+    for (uint32_t head = 0; head < 2; head++){
+        MeshStreamData stream;
+        stream.head   = head;
+        stream.type   = AttributeType::VEC3;
+        stream.stride = 3 * sizeof(float);
+        stream.data.resize(nofVertices * stream.stride);
+        for (uint32_t v = 0; v < nofVertices; v++)
+            std::memcpy(stream.data.data() + v * stream.stride, head == 0 ? bunnyVertices[v].position : bunnyVertices[v].normal, stream.stride);
+        mesh.streams.push_back(std::move(stream));
+    }
+    mesh.indices.assign(&bunnyIndices[0][0], &bunnyIndices[0][0] + sizeof(bunnyIndices) / sizeof(VertexIndex));
+    return mesh;
+}
+
+/**
+ * @brief Optimises order of triangles and vertices of mesh by optimizeMesh, unused vertices are removed.
+ * @param mesh mesh, head 0 holds float positions
+ * @return ACMR and ATVR before and after optimisation
+ */
+MeshOptimizationStatistics optimizeMeshData(MeshData &mesh){
+    std::vector<VertexStreamView> streams;
+    for (auto &stream : mesh.streams){
+        VertexStreamView const view = {stream.data.data(), stream.stride};
+        if (stream.head == 0)
+            streams.insert(streams.begin(), view);
+        else
+            streams.push_back(view);
+    }
+    auto const statistics = optimizeMesh(mesh.indices.data(), (uint32_t) mesh.indices.size(), mesh.nofVertices, streams.data(), (uint32_t) streams.size());
+    for (auto &stream : mesh.streams)
+        stream.data.resize((size_t) mesh.nofVertices * stream.stride);
+    return statistics;
+}
+
+/**
+ * @brief Writes mesh into mesh file.
+ * Indices are stored in the smallest index type, bounds are computed from float positions of head 0.
+ *
+ * @param fileName name of mesh file
+ * @param mesh mesh
+ * @param encode true if streams are compressed by encodeVertexBuffer and encodeIndexBuffer
+ *
+ * @return true if the file was written
+ */
+bool writeMeshFile(std::string const &fileName, MeshData const &mesh, bool encode){
+    MeshFileHeader header{};
+    std::memcpy(header.magic, meshFileMagic, sizeof(meshFileMagic));
+    header.version     = meshFileVersion;
+    header.nofVertices = mesh.nofVertices;
+    header.nofIndices  = (uint32_t) mesh.indices.size();
+    header.nofStreams  = (uint32_t) mesh.streams.size();
+    if (header.nofStreams > maxAttributes)
+        return false;
+
+    glm::vec3 boundsMin = glm::vec3(mesh.nofVertices == 0 ? 0.f : std::numeric_limits<float>::max());
+    glm::vec3 boundsMax = glm::vec3(mesh.nofVertices == 0 ? 0.f : std::numeric_limits<float>::lowest());
+    for (auto const &stream : mesh.streams){
+        if (stream.head != 0 or stream.format != AttributeFormat::FLOAT32)
+            continue;
+        uint32_t const nofComponents = std::min((uint32_t) stream.type, 3u);
+        for (uint32_t v = 0; v < mesh.nofVertices; v++){
+            glm::vec3 position(0.f);
+            std::memcpy(&position, stream.data.data() + (size_t) v * stream.stride, nofComponents * sizeof(float));
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+        }
+    }
+    std::memcpy(header.boundsMin, &boundsMin, sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, &boundsMax, sizeof(header.boundsMax));
+
+    std::vector<uint8_t> file(sizeof(MeshFileHeader) + mesh.streams.size() * sizeof(MeshFileStream));
+    std::vector<MeshFileStream> records;
+    for (auto const &stream : mesh.streams){
+        MeshFileStream record{};
+        record.head     = stream.head;
+        record.type     = (uint32_t) stream.type;
+        record.format   = (uint32_t) stream.format;
+        record.encoding = (uint32_t) (encode ? BufferEncoding::VERTEX : BufferEncoding::NONE);
+        record.stride   = stream.stride;
+        if (encode){
+            auto const encoded = encodeVertexBuffer(stream.data.data(), mesh.nofVertices, stream.stride);
+            record.offset = appendAligned(file, encoded.data(), encoded.size());
+            record.size   = encoded.size();
+        }
+        else{
+            record.offset = appendAligned(file, stream.data.data(), stream.data.size());
+            record.size   = stream.data.size();
+        }
+        records.push_back(record);
+    }
+
+    if (not mesh.indices.empty()){
+        uint32_t const maxIndex = *std::max_element(mesh.indices.begin(), mesh.indices.end());
+        if (encode){
+            auto const encoded = encodeIndexBuffer(mesh.indices.data(), header.nofIndices);
+            header.indexType     = (uint32_t) IndexType::UINT32;
+            header.indexEncoding = (uint32_t) BufferEncoding::INDEX;
+            header.indexOffset   = appendAligned(file, encoded.data(), encoded.size());
+            header.indexSize     = encoded.size();
+        }
+        else{
+            // the maximal value of index type is left for primitive restart
+            header.indexType = (uint32_t) (maxIndex < 0xff ? IndexType::UINT8 : maxIndex < 0xffff ? IndexType::UINT16 : IndexType::UINT32);
+            std::vector<uint8_t> indices((size_t) header.nofIndices * header.indexType);
+            for (uint32_t i = 0; i < header.nofIndices; i++)
+                std::memcpy(indices.data() + (size_t) i * header.indexType, &mesh.indices[i], header.indexType);
+            header.indexOffset = appendAligned(file, indices.data(), indices.size());
+            header.indexSize   = indices.size();
+        }
+    }
+
+    std::memcpy(file.data(), &header, sizeof(header));
+    if (not records.empty())
+        std::memcpy(file.data() + sizeof(header), records.data(), records.size() * sizeof(MeshFileStream));
+    std::ofstream output(fileName, std::ios::binary);
+    if (not output.is_open())
+        return false;
+    output.write((char const *) file.data(), (std::streamsize) file.size());
+    return output.good();
+}
+
+/**
+ * @brief Creates buffers and vertex puller of mesh file, buffers use memory of the file, nothing is copied.
+ * Each stream is read by its head with offset 0.
+ *
+ * @param gpu GPU
+ * @param mesh mapped mesh file
+ *
+ * @return handles of GPU objects
+ */
+GPUMesh createGPUMesh(GPU &gpu, MeshFile const &mesh){
+    MeshFileHeader const &header = *mesh.header;
+    GPUMesh result;
+    result.vertexPuller    = gpu.createVertexPuller();
+    result.nofDrawVertices = header.nofIndices != 0 ? header.nofIndices : header.nofVertices;
+    result.boundsMin       = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    result.boundsMax       = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    for (uint32_t s = 0; s < header.nofStreams; s++){
+        MeshFileStream const &stream = mesh.streams[s];
+        BufferID buffer = gpu.createBufferFromMemory(mesh.file->data + stream.offset, stream.size, mesh.file);
+        gpu.setBufferEncoding(buffer, (BufferEncoding) stream.encoding);
+        gpu.setVertexPullerHead(result.vertexPuller, stream.head, (AttributeType) stream.type, stream.stride, 0, buffer);
+        gpu.setVertexPullerHeadFormat(result.vertexPuller, stream.head, (AttributeFormat) stream.format);
+        gpu.enableVertexPullerHead(result.vertexPuller, stream.head);
+        result.buffers.push_back(buffer);
+    }
+    if (header.nofIndices != 0){
+        BufferID buffer = gpu.createBufferFromMemory(mesh.file->data + header.indexOffset, header.indexSize, mesh.file);
+        gpu.setBufferEncoding(buffer, (BufferEncoding) header.indexEncoding);
+        gpu.setVertexPullerIndexing(result.vertexPuller, (IndexType) header.indexType, buffer);
+        result.buffers.push_back(buffer);
+    }
+    return result;
+}
+
+/**
+ * @brief Deletes buffers and vertex puller of mesh, the file is unmapped when the last buffer is released.
+ *
+ * @param gpu GPU
+ * @param mesh mesh created by createGPUMesh
+ */
+void deleteGPUMesh(GPU &gpu, GPUMesh const &mesh){
+    for (BufferID buffer : mesh.buffers)
+        gpu.deleteBuffer(buffer);
+    gpu.deleteVertexPuller(mesh.vertexPuller);
+}
@@ -0,0 +1,102 @@
+/*!
+ * @file
+ * @brief This file contains binary mesh format that is memory mapped and handed to GPU buffers without parsing.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <student/gpu.hpp>
+#include <student/mappedFile.hpp>
+#include <student/meshOptimizer.hpp>
+
+uint32_t const meshFileVersion     = 1; ///< version of binary mesh format
+uint64_t const meshStreamAlignment = bufferAlignment; ///< streams start at the same alignment as buffer storage
+
+/**
+ * @brief Header at the beginning of mesh file, array of nofStreams MeshFileStream records follows it.
+ * All values are stored in native (little endian) byte order and read in place.
+ */
+struct MeshFileHeader{
+    char     magic[4];      ///< "IZGM"
+    uint32_t version;       ///< meshFileVersion
+    uint32_t nofVertices;   ///< number of vertices
+    uint32_t nofIndices;    ///< number of indices, 0 for mesh without indices
+    uint32_t indexType;     ///< IndexType of index stream
+    uint32_t indexEncoding; ///< BufferEncoding of index stream
+    uint32_t nofStreams;    ///< number of attribute streams
+    uint32_t reserved;      ///< zero
+    float    boundsMin[3];  ///< minimal corner of bounding box
+    float    boundsMax[3];  ///< maximal corner of bounding box
+    uint64_t indexOffset;   ///< offset of index stream in file
+    uint64_t indexSize;     ///< size of index stream in bytes
+};
+
+/**
+ * @brief Attribute stream of mesh file, it is read by one vertex puller head.
+ */
+struct MeshFileStream{
+    uint32_t head;     ///< vertex puller head
+    uint32_t type;     ///< AttributeType
+    uint32_t format;   ///< AttributeFormat
+    uint32_t encoding; ///< BufferEncoding
+    uint32_t stride;   ///< distance between vertices in bytes (vertex size of encoded stream)
+    uint32_t reserved; ///< zero
+    uint64_t offset;   ///< offset of stream in file
+    uint64_t size;     ///< size of stream in bytes
+};
+
+static_assert(sizeof(MeshFileHeader) == 72, "MeshFileHeader layout is part of file format");
+static_assert(sizeof(MeshFileStream) == 40, "MeshFileStream layout is part of file format");
+
+/**
+ * @brief Mesh file mapped into memory, header and streams are validated, data are not touched.
+ */
+class MeshFile{
+    public:
+        explicit MeshFile(std::string const &fileName);
+        std::shared_ptr<MappedFile> file;
+        MeshFileHeader const *header = nullptr;
+        MeshFileStream const *streams = nullptr;
+};
+
+/**
+ * @brief Attribute stream of mesh in CPU memory.
+ */
+struct MeshStreamData{
+    uint32_t        head     = 0;
+    AttributeType   type     = AttributeType::EMPTY;
+    AttributeFormat format   = AttributeFormat::FLOAT32;
+    uint32_t        stride   = 0;
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Mesh in CPU memory, it is written into mesh file by converter.
+ * Head 0 holds float positions.
+ */
+struct MeshData{
+    uint32_t nofVertices = 0;
+    std::vector<MeshStreamData> streams;
+    std::vector<uint32_t> indices;
+};
+
+/**
+ * @brief Mesh handed to GPU, its buffers use memory of mapped mesh file.
+ */
+struct GPUMesh{
+    VertexPullerID        vertexPuller = emptyID;
+    std::vector<BufferID> buffers;
+    uint32_t              nofDrawVertices = 0; ///< number of indices (vertices of mesh without indices)
+    glm::vec3             boundsMin = glm::vec3(0.f);
+    glm::vec3             boundsMax = glm::vec3(0.f);
+};
+
+MeshData bunnyMeshData();
+MeshOptimizationStatistics optimizeMeshData(MeshData &mesh);
+bool     writeMeshFile(std::string const &fileName, MeshData const &mesh, bool encode);
+GPUMesh  createGPUMesh(GPU &gpu, MeshFile const &mesh);
+void     deleteGPUMesh(GPU &gpu, GPUMesh const &mesh);
@@ -0,0 +1,730 @@
+/*!
+ * @file
+ * @brief This file contains implementation of parallel importer of OBJ and binary PLY meshes.
+ *
+ * The file is memory mapped and split into chunks that are parsed by worker threads.
+ * Results are written straight into mapped GPU buffers (positions in head 0, normals in head 1, 32-bit indices),
+ * only OBJ vertices with normals need temporary arrays because their order is known after deduplication.
+ */
+
+#include <student/meshImporter.hpp>
+#include <student/meshOptimizer.hpp>
+#include <student/timer.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief Runs function(begin, end, thread) over equal parts of range in threads.
+ */
+template<typename FUNCTION>
+void parallelFor(uint32_t nofThreads, uint64_t nofItems, FUNCTION const &function){
+    nofThreads = (uint32_t) std::max<uint64_t>(std::min<uint64_t>(nofThreads, nofItems), 1);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 1; t < nofThreads; t++)
+        threads.emplace_back([&, t](){function(nofItems * t / nofThreads, nofItems * (t + 1) / nofThreads, t);});
+    function(0, nofItems / nofThreads, 0);
+    for (auto &thread : threads)
+        thread.join();
+}
+
+/**
+ * @brief Bounding box of positions.
+ */
+struct Bounds {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+    void add(glm::vec3 const &position){
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    void add(Bounds const &bounds){
+        min = glm::min(min, bounds.min);
+        max = glm::max(max, bounds.max);
+    }
+};
+
+/**
+ * @brief Buffer that is mapped for writing while it is filled.
+ */
+struct MappedBuffer {
+    BufferID id = emptyID;
+    uint8_t *data = nullptr;
+};
+
+/**
+ * @brief Buffers created by one import, they are unmapped and deleted if the import throws before release.
+ */
+class ImportBuffers {
+    public:
+        explicit ImportBuffers(GPU &gpu):gpu(gpu){}
+        ImportBuffers(ImportBuffers const &) = delete;
+        ImportBuffers &operator=(ImportBuffers const &) = delete;
+        ~ImportBuffers(){
+            for (BufferID id : ids){
+                gpu.unmapBuffer(id);
+                gpu.deleteBuffer(id);
+            }
+        }
+
+        MappedBuffer create(uint64_t size){
+            MappedBuffer buffer;
+            buffer.id = gpu.createBuffer(std::max<uint64_t>(size, 1));
+            if (buffer.id != emptyID){
+                ids.push_back(buffer.id);
+                buffer.data = (uint8_t *) gpu.mapBuffer(buffer.id, 0, std::max<uint64_t>(size, 1), mapWrite);
+            }
+            if (buffer.data == nullptr)
+                throw std::runtime_error("cannot allocate buffer of imported mesh");
+            return buffer;
+        }
+
+        void erase(BufferID id){
+            ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+            gpu.unmapBuffer(id);
+            gpu.deleteBuffer(id);
+        }
+
+        /// buffers belong to the imported mesh
+        void release(){
+            ids.clear();
+        }
+
+    private:
+        GPU &gpu;
+        std::vector<BufferID> ids;
+};
+
+/**
+ * @brief Optimises order of filled buffers, unmaps them and creates vertex puller that reads them.
+ */
+GPUMesh finishMesh(GPU &gpu, MappedBuffer positions, MappedBuffer normals, MappedBuffer indices, uint32_t nofVertices, uint32_t nofIndices,
+                   Bounds const &bounds, MeshImportStatistics &statistics){
+    Timer<double> timer;
+    VertexStreamView streams[2] = {{positions.data, sizeof(glm::vec3)}, {normals.data, sizeof(glm::vec3)}};
+    statistics.optimization = optimizeMesh((uint32_t *) indices.data, nofIndices, nofVertices, streams, normals.id == emptyID ? 1 : 2);
+    statistics.optimizationSeconds = timer.elapsedFromStart();
+    statistics.nofVertices = nofVertices;
+    statistics.nofIndices = nofIndices;
+
+    GPUMesh mesh;
+    mesh.vertexPuller = gpu.createVertexPuller();
+    mesh.nofDrawVertices = nofIndices;
+    mesh.boundsMin = bounds.min;
+    mesh.boundsMax = bounds.max;
+    MappedBuffer const heads[2] = {positions, normals};
+    for (uint32_t head = 0; head < 2; head++){
+        if (heads[head].id == emptyID)
+            continue;
+        gpu.unmapBuffer(heads[head].id);
+        gpu.setVertexPullerHead(mesh.vertexPuller, head, AttributeType::VEC3, sizeof(glm::vec3), 0, heads[head].id);
+        gpu.enableVertexPullerHead(mesh.vertexPuller, head);
+        mesh.buffers.push_back(heads[head].id);
+    }
+    gpu.unmapBuffer(indices.id);
+    gpu.setVertexPullerIndexing(mesh.vertexPuller, IndexType::UINT32, indices.id);
+    mesh.buffers.push_back(indices.id);
+    return mesh;
+}
+
+/**
+ * @brief Open addressing hash map from packed (position, normal) pair to vertex index.
+ */
+class VertexHashMap {
+    public:
+        explicit VertexHashMap(size_t expected){
+            resize(std::max<size_t>(16, expected * 2));
+        }
+        /**
+         * @brief Returns index of key, the key gets value if it is not in the map.
+         */
+        uint32_t insert(uint64_t key, uint32_t value){
+            if (2 * (size + 1) > keys.size())
+                resize(keys.size() * 2);
+            size_t slot = hash(key);
+            while (keys[slot] != emptyKey){
+                if (keys[slot] == key)
+                    return values[slot];
+                slot = (slot + 1) & (keys.size() - 1);
+            }
+            keys[slot] = key;
+            values[slot] = value;
+            size++;
+            return value;
+        }
+    private:
+        static uint64_t const emptyKey = ~0ull;
+        size_t hash(uint64_t key) const {
+            return (size_t) ((key * 0x9e3779b97f4a7c15ull) >> shift);
+        }
+        void resize(size_t minimalCapacity){
+            size_t capacity = 16;
+            for (shift = 60; capacity < minimalCapacity; shift--)
+                capacity *= 2;
+            std::vector<uint64_t> oldKeys(capacity, emptyKey);
+            std::vector<uint32_t> oldValues(capacity);
+            keys.swap(oldKeys);
+            values.swap(oldValues);
+            size = 0;
+            for (size_t i = 0; i < oldKeys.size(); i++)
+                if (oldKeys[i] != emptyKey)
+                    insert(oldKeys[i], oldValues[i]);
+        }
+        std::vector<uint64_t> keys;
+        std::vector<uint32_t> values;
+        size_t size = 0;
+        uint32_t shift = 60;
+};
+
+/*---OBJ---*/
+
+/**
+ * @brief Part of OBJ file that starts and ends at line boundary.
+ */
+struct ObjChunk {
+    char const *begin = nullptr;
+    char const *end = nullptr;
+    uint32_t nofPositions = 0;
+    uint32_t nofNormals = 0;
+    uint32_t firstPosition = 0;
+    uint32_t firstNormal = 0;
+    std::vector<uint64_t> corners; ///< corners of triangles, position index << 32 | (normal index + 1), 0 means no normal
+    Bounds bounds;
+    bool invalid = false;
+};
+
+enum class ObjLine { OTHER, POSITION, NORMAL, FACE };
+
+bool isBlank(char c){
+    return c == ' ' or c == '\t' or c == '\r';
+}
+
+char const *skipBlanks(char const *p, char const *end){
+    while (p < end and isBlank(*p))
+        p++;
+    return p;
+}
+
+/**
+ * @brief Classifies line, p is moved behind the keyword.
+ */
+ObjLine objLine(char const *&p, char const *end){
+    p = skipBlanks(p, end);
+    auto keyword = [&](char const *word, size_t length){
+        return (size_t) (end - p) > length and std::memcmp(p, word, length) == 0 and isBlank(p[length]);
+    };
+    ObjLine line = ObjLine::OTHER;
+    size_t length = 0;
+    if (keyword("v", 1))
+        line = ObjLine::POSITION, length = 1;
+    else if (keyword("vn", 2))
+        line = ObjLine::NORMAL, length = 2;
+    else if (keyword("f", 1))
+        line = ObjLine::FACE, length = 1;
+    p += length;
+    return line;
+}
+
+char const *lineEnd(char const *p, char const *end){
+    auto const *newLine = (char const *) std::memchr(p, '\n', (size_t) (end - p));
+    return newLine != nullptr ? newLine : end;
+}
+
+bool parseVec3(char const *p, char const *end, glm::vec3 &value){
+    for (uint32_t i = 0; i < 3; i++){
+        p = skipBlanks(p, end);
+        if (p < end and *p == '+')
+            p++;
+        auto const result = std::from_chars(p, end, value[i]);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+    }
+    return true;
+}
+
+bool parseInt(char const *&p, char const *end, int64_t &value){
+    bool const negative = p < end and *p == '-';
+    if (negative or (p < end and *p == '+'))
+        p++;
+    if (p == end or *p < '0' or *p > '9')
+        return false;
+    value = 0;
+    while (p < end and *p >= '0' and *p <= '9' and value < (1ll << 40))
+        value = value * 10 + (*p++ - '0');
+    if (negative)
+        value = -value;
+    return true;
+}
+
+/**
+ * @brief Resolves 1-based or negative (relative) OBJ index.
+ * @return 0-based index, -1 if it is out of range
+ */
+int64_t resolveIndex(int64_t index, uint64_t nofPreceding, uint64_t total){
+    int64_t const resolved = index > 0 ? index - 1 : (int64_t) nofPreceding + index;
+    return resolved >= 0 and (uint64_t) resolved < total ? resolved : -1;
+}
+
+void countObjChunk(ObjChunk &chunk){
+    for (char const *p = chunk.begin; p < chunk.end; ){
+        char const *end = lineEnd(p, chunk.end);
+        ObjLine const line = objLine(p, end);
+        chunk.nofPositions += line == ObjLine::POSITION;
+        chunk.nofNormals += line == ObjLine::NORMAL;
+        p = end + 1;
+    }
+}
+
+void parseObjChunk(ObjChunk &chunk, glm::vec3 *positions, glm::vec3 *normals, uint32_t nofPositions, uint32_t nofNormals){
+    uint32_t position = chunk.firstPosition;
+    uint32_t normal = chunk.firstNormal;
+    std::vector<uint64_t> polygon;
+    for (char const *p = chunk.begin; p < chunk.end and not chunk.invalid; ){
+        char const *end = lineEnd(p, chunk.end);
+        switch (objLine(p, end)){
+            case ObjLine::POSITION:
+                chunk.invalid |= not parseVec3(p, end, positions[position]);
+                chunk.bounds.add(positions[position++]);
+                break;
+            case ObjLine::NORMAL:
+                chunk.invalid |= not parseVec3(p, end, normals[normal++]);
+                break;
+            case ObjLine::FACE:{
+                // corners are "v", "v/vt", "v//vn" or "v/vt/vn", polygons are triangulated as fans
+                polygon.clear();
+                for (p = skipBlanks(p, end); p < end and not chunk.invalid; p = skipBlanks(p, end)){
+                    int64_t index, texCoord, normalIndex = 0;
+                    chunk.invalid |= not parseInt(p, end, index);
+                    if (p < end and *p == '/'){
+                        p++;
+                        if (p < end and *p != '/')
+                            chunk.invalid |= not parseInt(p, end, texCoord);
+                        if (p < end and *p == '/'){
+                            p++;
+                            chunk.invalid |= not parseInt(p, end, normalIndex);
+                        }
+                    }
+                    int64_t const resolvedPosition = resolveIndex(index, position, nofPositions);
+                    int64_t const resolvedNormal = normalIndex == 0 ? -1 : resolveIndex(normalIndex, normal, nofNormals);
+                    chunk.invalid |= resolvedPosition < 0 or (normalIndex != 0 and resolvedNormal < 0);
+                    polygon.push_back((uint64_t) resolvedPosition << 32 | (uint64_t) (resolvedNormal + 1));
+                }
+                chunk.invalid |= polygon.size() < 3;
+                for (size_t i = 2; i < polygon.size(); i++)
+                    chunk.corners.insert(chunk.corners.end(), {polygon[0], polygon[i - 1], polygon[i]});
+                break;
+            }
+            default:
+                break;
+        }
+        p = end + 1;
+    }
+}
+
+GPUMesh importObj(GPU &gpu, MappedFile const &file, uint32_t nofThreads, MeshImportStatistics &statistics){
+    ImportBuffers buffers(gpu);
+    // more chunks than threads balance uneven lines, chunks start after a newline
+    uint32_t const nofChunks = nofThreads * 4;
+    std::vector<ObjChunk> chunks(nofChunks);
+    char const *data = (char const *) file.data;
+    char const *dataEnd = data + file.size;
+    for (uint32_t c = 0; c < nofChunks; c++){
+        chunks[c].begin = c == 0 ? data : chunks[c - 1].end;
+        char const *end = std::max(chunks[c].begin, data + file.size * (c + 1) / nofChunks);
+        chunks[c].end = c + 1 == nofChunks or end >= dataEnd ? dataEnd : std::min(lineEnd(end, dataEnd) + 1, dataEnd);
+    }
+    auto forChunks = [&](auto const &function){
+        std::atomic<uint32_t> next{0};
+        parallelFor(nofThreads, nofThreads, [&](uint64_t, uint64_t, uint32_t){
+            for (uint32_t c = next++; c < nofChunks; c = next++)
+                function(chunks[c]);
+        });
+    };
+
+    forChunks(countObjChunk);
+    uint32_t nofPositions = 0, nofNormals = 0;
+    for (auto &chunk : chunks){
+        chunk.firstPosition = nofPositions;
+        chunk.firstNormal = nofNormals;
+        nofPositions += chunk.nofPositions;
+        nofNormals += chunk.nofNormals;
+    }
+    if (nofPositions == 0)
+        throw std::runtime_error("mesh has no vertices");
+
+    // without normals the positions are the vertices, so they are parsed straight into the GPU buffer
+    MappedBuffer positionBuffer, normalBuffer;
+    std::vector<glm::vec3> positions, normals(nofNormals);
+    if (nofNormals == 0)
+        positionBuffer = buffers.create((uint64_t) nofPositions * sizeof(glm::vec3));
+    else
+        positions.resize(nofPositions);
+    glm::vec3 *positionTarget = nofNormals == 0 ? (glm::vec3 *) positionBuffer.data : positions.data();
+    forChunks([&](ObjChunk &chunk){parseObjChunk(chunk, positionTarget, normals.data(), nofPositions, nofNormals);});
+
+    Bounds bounds;
+    uint64_t nofIndices = 0;
+    for (auto const &chunk : chunks){
+        if (chunk.invalid)
+            throw std::runtime_error("invalid OBJ line");
+        bounds.add(chunk.bounds);
+        nofIndices += chunk.corners.size();
+    }
+    if (nofIndices == 0 or nofIndices > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("mesh has no faces or too many indices");
+    MappedBuffer indexBuffer = buffers.create(nofIndices * sizeof(uint32_t));
+    auto *indices = (uint32_t *) indexBuffer.data;
+
+    uint32_t nofVertices = nofPositions;
+    if (nofNormals == 0){
+        std::vector<uint64_t> firstCorner(nofChunks + 1, 0);
+        for (uint32_t c = 0; c < nofChunks; c++)
+            firstCorner[c + 1] = firstCorner[c] + chunks[c].corners.size();
+        forChunks([&](ObjChunk &chunk){
+            uint32_t *target = indices + firstCorner[&chunk - chunks.data()];
+            for (size_t i = 0; i < chunk.corners.size(); i++)
+                target[i] = (uint32_t) (chunk.corners[i] >> 32);
+        });
+    }
+    else{
+        // identical (position, normal) pairs become one vertex, ids are assigned in order of first use
+        std::vector<uint64_t> vertices;
+        VertexHashMap map(std::max<size_t>(nofPositions, nofNormals));
+        for (auto &chunk : chunks){
+            for (uint64_t corner : chunk.corners){
+                uint32_t const vertex = map.insert(corner, (uint32_t) vertices.size());
+                if (vertex == vertices.size())
+                    vertices.push_back(corner);
+                *indices++ = vertex;
+            }
+            std::vector<uint64_t>().swap(chunk.corners);
+        }
+        nofVertices = (uint32_t) vertices.size();
+        positionBuffer = buffers.create((uint64_t) nofVertices * sizeof(glm::vec3));
+        normalBuffer = buffers.create((uint64_t) nofVertices * sizeof(glm::vec3));
+        auto *positionData = (glm::vec3 *) positionBuffer.data;
+        auto *normalData = (glm::vec3 *) normalBuffer.data;
+        parallelFor(nofThreads, nofVertices, [&](uint64_t begin, uint64_t end, uint32_t){
+            for (uint64_t v = begin; v < end; v++){
+                uint32_t const normal = (uint32_t) vertices[v];
+                positionData[v] = positions[vertices[v] >> 32];
+                normalData[v] = normal == 0 ? glm::vec3(0.f) : normals[normal - 1];
+            }
+        });
+    }
+    GPUMesh const mesh = finishMesh(gpu, positionBuffer, normalBuffer, indexBuffer, nofVertices, (uint32_t) nofIndices, bounds, statistics);
+    buffers.release();
+    return mesh;
+}
+
+/*---PLY---*/
+
+enum class PlyType { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 };
+
+uint32_t plyTypeSize(PlyType type){
+    uint32_t const sizes[] = {1, 1, 2, 2, 4, 4, 4, 8};
+    return sizes[(uint32_t) type];
+}
+
+PlyType plyType(std::string const &name){
+    char const *const names[][2] = {{"char", "int8"}, {"uchar", "uint8"}, {"short", "int16"}, {"ushort", "uint16"},
+                                    {"int", "int32"}, {"uint", "uint32"}, {"float", "float32"}, {"double", "float64"}};
+    for (uint32_t t = 0; t < 8; t++)
+        if (name == names[t][0] or name == names[t][1])
+            return (PlyType) t;
+    throw std::runtime_error("unknown PLY property type " + name);
+}
+
+/**
+ * @brief Reads one PLY value and converts it to double.
+ */
+double readPly(uint8_t const *data, PlyType type, bool bigEndian){
+    uint8_t bytes[8];
+    uint32_t const size = plyTypeSize(type);
+    for (uint32_t i = 0; i < size; i++)
+        bytes[i] = data[bigEndian ? size - 1 - i : i];
+    switch (type){
+        case PlyType::INT8:    {int8_t   v; std::memcpy(&v, bytes, 1); return v;}
+        case PlyType::UINT8:   {uint8_t  v; std::memcpy(&v, bytes, 1); return v;}
+        case PlyType::INT16:   {int16_t  v; std::memcpy(&v, bytes, 2); return v;}
+        case PlyType::UINT16:  {uint16_t v; std::memcpy(&v, bytes, 2); return v;}
+        case PlyType::INT32:   {int32_t  v; std::memcpy(&v, bytes, 4); return v;}
+        case PlyType::UINT32:  {uint32_t v; std::memcpy(&v, bytes, 4); return v;}
+        case PlyType::FLOAT32: {float    v; std::memcpy(&v, bytes, 4); return v;}
+        case PlyType::FLOAT64: {double   v; std::memcpy(&v, bytes, 8); return v;}
+    }
+    return 0.0;
+}
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PlyType::FLOAT32;
+    bool list = false;
+    PlyType countType = PlyType::UINT8;
+    uint32_t offset = 0; ///< offset in record, valid for properties before the first list
+};
+
+struct PlyElement {
+    std::string name;
+    uint64_t count = 0;
+    std::vector<PlyProperty> properties;
+    uint32_t size = 0;   ///< size of record without lists
+    bool hasList = false;
+};
+
+PlyProperty const *findProperty(PlyElement const &element, std::string const &name){
+    for (auto const &property : element.properties)
+        if (property.name == name)
+            return &property;
+    return nullptr;
+}
+
+GPUMesh importPly(GPU &gpu, MappedFile const &file, uint32_t nofThreads, MeshImportStatistics &statistics){
+    ImportBuffers buffers(gpu);
+    char const *text = (char const *) file.data;
+    char const *headerEnd = nullptr;
+    for (char const *p = text; p + 10 <= text + file.size and headerEnd == nullptr; p = lineEnd(p, text + file.size) + 1)
+        if (std::strncmp(p, "end_header", 10) == 0)
+            headerEnd = lineEnd(p, text + file.size) + 1;
+    if (headerEnd == nullptr or headerEnd > text + file.size)
+        throw std::runtime_error("PLY header is not terminated");
+
+    std::istringstream header(std::string(text, headerEnd));
+    std::vector<PlyElement> elements;
+    bool bigEndian = false;
+    for (std::string line; std::getline(header, line); ){
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+        if (keyword == "format"){
+            std::string format;
+            tokens >> format;
+            if (format != "binary_little_endian" and format != "binary_big_endian")
+                throw std::runtime_error("only binary PLY is supported");
+            bigEndian = format == "binary_big_endian";
+        }
+        else if (keyword == "element"){
+            elements.emplace_back();
+            tokens >> elements.back().name >> elements.back().count;
+        }
+        else if (keyword == "property" and not elements.empty()){
+            PlyElement &element = elements.back();
+            PlyProperty property;
+            std::string type;
+            tokens >> type;
+            if (type == "list"){
+                std::string countType;
+                tokens >> countType >> type;
+                property.list = true;
+                property.countType = plyType(countType);
+                element.hasList = true;
+            }
+            property.type = plyType(type);
+            tokens >> property.name;
+            property.offset = element.size;
+            if (not property.list)
+                element.size += plyTypeSize(property.type);
+            element.properties.push_back(property);
+        }
+    }
+
+    // elements are stored one after another, vertex element has to precede face element
+    uint64_t offset = (uint64_t) (headerEnd - text);
+    PlyElement const *vertexElement = nullptr, *faceElement = nullptr;
+    uint64_t vertexOffset = 0, faceOffset = 0;
+    for (auto const &element : elements){
+        if (element.name == "vertex"){
+            vertexElement = &element;
+            vertexOffset = offset;
+        }
+        if (element.name == "face"){
+            faceElement = &element;
+            faceOffset = offset;
+            break;
+        }
+        if (element.hasList)
+            throw std::runtime_error("PLY element " + element.name + " with lists precedes faces");
+        offset += element.count * element.size;
+    }
+    if (vertexElement == nullptr or faceElement == nullptr or vertexElement->count == 0 or vertexElement->count > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("PLY has no vertices or faces");
+    if (vertexOffset + vertexElement->count * vertexElement->size > file.size)
+        throw std::runtime_error("PLY vertices are out of file");
+
+    PlyProperty const *coordinates[2][3] = {{findProperty(*vertexElement, "x"), findProperty(*vertexElement, "y"), findProperty(*vertexElement, "z")},
+                                            {findProperty(*vertexElement, "nx"), findProperty(*vertexElement, "ny"), findProperty(*vertexElement, "nz")}};
+    if (coordinates[0][0] == nullptr or coordinates[0][1] == nullptr or coordinates[0][2] == nullptr or vertexElement->hasList)
+        throw std::runtime_error("PLY vertices have no positions");
+    bool const hasNormals = coordinates[1][0] != nullptr and coordinates[1][1] != nullptr and coordinates[1][2] != nullptr;
+
+    uint32_t const nofVertices = (uint32_t) vertexElement->count;
+    MappedBuffer positionBuffer = buffers.create((uint64_t) nofVertices * sizeof(glm::vec3));
+    MappedBuffer normalBuffer;
+    if (hasNormals)
+        normalBuffer = buffers.create((uint64_t) nofVertices * sizeof(glm::vec3));
+    std::vector<Bounds> threadBounds(nofThreads);
+    parallelFor(nofThreads, nofVertices, [&](uint64_t begin, uint64_t end, uint32_t thread){
+        for (uint64_t v = begin; v < end; v++){
+            uint8_t const *record = file.data + vertexOffset + v * vertexElement->size;
+            for (uint32_t stream = 0; stream < (hasNormals ? 2u : 1u); stream++){
+                glm::vec3 value;
+                for (uint32_t i = 0; i < 3; i++)
+                    value[i] = (float) readPly(record + coordinates[stream][i]->offset, coordinates[stream][i]->type, bigEndian);
+                ((glm::vec3 *) (stream == 0 ? positionBuffer.data : normalBuffer.data))[v] = value;
+                if (stream == 0)
+                    threadBounds[thread].add(value);
+            }
+        }
+    });
+    Bounds bounds;
+    for (auto const &threadBound : threadBounds)
+        bounds.add(threadBound);
+
+    PlyProperty const *list = findProperty(*faceElement, "vertex_indices");
+    if (list == nullptr)
+        list = findProperty(*faceElement, "vertex_index");
+    if (list == nullptr or not list->list)
+        throw std::runtime_error("PLY faces have no vertex indices");
+    // scalars before the list are at fixed offsets, the rest follows the list
+    uint32_t const countSize = plyTypeSize(list->countType);
+    uint32_t const indexSize = plyTypeSize(list->type);
+    for (auto const &property : faceElement->properties)
+        if (property.list and &property != list)
+            throw std::runtime_error("PLY faces have more lists");
+    uint32_t const before = list->offset;
+    uint32_t const after = faceElement->size - before;
+    uint64_t const nofFaces = faceElement->count;
+    uint64_t const triangleRecord = before + countSize + 3 * indexSize + after;
+    std::atomic<bool> invalid{false};
+    auto readFace = [&](uint8_t const *record, uint32_t corner){
+        double const index = readPly(record + before + countSize + corner * indexSize, list->type, bigEndian);
+        invalid = invalid or index < 0.0 or index >= nofVertices;
+        return (uint32_t) index;
+    };
+
+    // triangle meshes have fixed face records and are converted in parallel
+    std::atomic<bool> onlyTriangles{faceOffset + nofFaces * triangleRecord <= file.size and nofFaces * 3 <= std::numeric_limits<uint32_t>::max()};
+    MappedBuffer indexBuffer;
+    uint64_t nofIndices = nofFaces * 3;
+    if (onlyTriangles){
+        indexBuffer = buffers.create(nofIndices * sizeof(uint32_t));
+        auto *indices = (uint32_t *) indexBuffer.data;
+        parallelFor(nofThreads, nofFaces, [&](uint64_t begin, uint64_t end, uint32_t){
+            for (uint64_t f = begin; f < end and onlyTriangles; f++){
+                uint8_t const *record = file.data + faceOffset + f * triangleRecord;
+                if (readPly(record + before, list->countType, bigEndian) != 3.0){
+                    onlyTriangles = false;
+                    break;
+                }
+                for (uint32_t corner = 0; corner < 3; corner++)
+                    indices[3 * f + corner] = readFace(record, corner);
+            }
+        });
+        if (not onlyTriangles){
+            buffers.erase(indexBuffer.id);
+        }
+    }
+    if (not onlyTriangles){
+        // polygons: records are walked sequentially, once to count triangles and once to write them
+        nofIndices = 0;
+        uint8_t const *record = file.data + faceOffset;
+        for (uint64_t f = 0; f < nofFaces; f++){
+            if (record + before + countSize > file.data + file.size)
+                throw std::runtime_error("PLY faces are out of file");
+            auto const count = (uint64_t) readPly(record + before, list->countType, bigEndian);
+            nofIndices += count >= 3 ? 3 * (count - 2) : 0;
+            record += before + countSize + count * indexSize + after;
+        }
+        if (record > file.data + file.size or nofIndices > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("PLY faces are out of file");
+        indexBuffer = buffers.create(nofIndices * sizeof(uint32_t));
+        auto *indices = (uint32_t *) indexBuffer.data;
+        record = file.data + faceOffset;
+        for (uint64_t f = 0; f < nofFaces; f++){
+            auto const count = (uint32_t) readPly(record + before, list->countType, bigEndian);
+            for (uint32_t corner = 2; corner < count; corner++){
+                *indices++ = readFace(record, 0);
+                *indices++ = readFace(record, corner - 1);
+                *indices++ = readFace(record, corner);
+            }
+            record += before + countSize + (uint64_t) count * indexSize + after;
+        }
+    }
+    if (invalid)
+        throw std::runtime_error("PLY face index is out of vertices");
+
+    GPUMesh const mesh = finishMesh(gpu, positionBuffer, normalBuffer, indexBuffer, nofVertices, (uint32_t) nofIndices, bounds, statistics);
+    buffers.release();
+    return mesh;
+}
+
+std::string extension(std::string const &fileName){
+    auto const dot = fileName.find_last_of('.');
+    std::string result = dot == std::string::npos ? "" : fileName.substr(dot + 1);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c){return (char) std::tolower(c);});
+    return result;
+}
+
+}
+
+/**
+ * @brief Returns throughput of import.
+ * @return megabytes (10^6 bytes) of input per second
+ */
+double MeshImportStatistics::megabytesPerSecond() const {
+    return seconds > 0.0 ? (double) bytes / 1e6 / seconds : 0.0;
+}
+
+/**
+ * @brief Tests if mesh file can be imported by importMesh.
+ * @param fileName name of file
+ * @return true for .obj and .ply files
+ */
+bool isImportableMesh(std::string const &fileName){
+    auto const type = extension(fileName);
+    return type == "obj" or type == "ply";
+}
+
+/**
+ * @brief Imports OBJ or binary PLY file into GPU buffers.
+ * The file is memory mapped and parsed in parallel, results are written directly into mapped GPU buffers.
+ * Vertices of OBJ are deduplicated by their (position, normal) pair, polygons are triangulated as fans.
+ * Positions are in head 0, normals (if the file has them) in head 1, indices are 32-bit.
+ * Triangles and vertices are reordered by optimizeMesh before the buffers are unmapped.
+ *
+ * @param gpu GPU
+ * @param fileName name of .obj or .ply file
+ * @param statistics output statistics, may be nullptr
+ * @param nofThreads number of parsing threads, 0 means number of hardware threads
+ *
+ * @return handles of GPU objects
+ * @throws std::runtime_error if the file cannot be read or it is not valid
+ */
+GPUMesh importMesh(GPU &gpu, std::string const &fileName, MeshImportStatistics *statistics, uint32_t nofThreads){
+    Timer<double> timer;
+    if (nofThreads == 0)
+        nofThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    MappedFile const file(fileName);
+    MeshImportStatistics result;
+    result.bytes = file.size;
+    result.nofThreads = nofThreads;
+    GPUMesh mesh;
+    try{
+        mesh = extension(fileName) == "ply" ? importPly(gpu, file, nofThreads, result) : importObj(gpu, file, nofThreads, result);
+    }catch(std::runtime_error const &error){
+        throw std::runtime_error(fileName + ": " + error.what());
+    }
+    result.seconds = timer.elapsedFromStart();
+    if (statistics != nullptr)
+        *statistics = result;
+    return mesh;
+}
@@ -0,0 +1,28 @@
+/*!
+ * @file
+ * @brief This file contains parallel importer of OBJ and binary PLY meshes into GPU buffers.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <student/meshFile.hpp>
+#include <student/meshOptimizer.hpp>
+
+/**
+ * @brief Statistics of one import.
+ */
+struct MeshImportStatistics {
+    uint64_t bytes = 0;        ///< size of imported file
+    double seconds = 0.0;      ///< wall time of import including writes into GPU buffers and optimisation
+    double optimizationSeconds = 0.0; ///< wall time of optimizeMesh
+    uint32_t nofVertices = 0;  ///< vertices after deduplication (referenced vertices)
+    uint32_t nofIndices = 0;   ///< indices (triangulated faces)
+    uint32_t nofThreads = 0;   ///< number of parsing threads
+    MeshOptimizationStatistics optimization; ///< vertex cache efficiency before and after optimisation
+    double megabytesPerSecond() const;
+};
+
+bool    isImportableMesh(std::string const &fileName);
+GPUMesh importMesh(GPU &gpu, std::string const &fileName, MeshImportStatistics *statistics = nullptr, uint32_t nofThreads = 0);
@@ -0,0 +1,83 @@
+/*!
+ * @file
+ * @brief This file contains implementation of rendering method of mesh file
+ */
+
+#include <student/meshMethod.hpp>
+#include <student/phongMethod.hpp>
+#include <student/meshImporter.hpp>
+
+/**
+ * @brief Mesh vertex shader, it applies model matrix and passes world-space position and normal
+ *
+ * @param outVertex out vertex
+ * @param inVertex in vertex
+ * @param uniforms uniform variables
+ */
+void mesh_VS(OutVertex&outVertex,InVertex const&inVertex,Uniforms const&uniforms){
+  auto const& view  = uniforms.uniform[0].m4;
+  auto const& proj  = uniforms.uniform[1].m4;
+  auto const& model = uniforms.uniform[4].m4;
+
+  auto position = model*glm::vec4(inVertex.attributes[0].v3,1.f);
+  outVertex.gl_Position = proj*view*position;
+
+  // model matrix only scales uniformly and translates, normals stay the same
+  outVertex.attributes[0].v3 = glm::vec3(position);
+  outVertex.attributes[1].v3 = inVertex.attributes[1].v3;
+}
+
+/**
+ * @brief Constructor, it maps mesh file and hands it to GPU without copying, OBJ and PLY files are imported
+ *
+ * @param fileName name of mesh file (.obj, .ply or file written by mesh converter)
+ */
+MeshMethod::MeshMethod(std::string const&fileName){
+  if(isImportableMesh(fileName))
+    mesh = importMesh(gpu,fileName);
+  else
+    mesh = createGPUMesh(gpu,MeshFile(fileName));
+
+  auto const center = (mesh.boundsMin+mesh.boundsMax)*.5f;
+  auto const extent = glm::max(mesh.boundsMax-mesh.boundsMin,glm::vec3(1e-6f));
+  auto const scale  = 2.f/glm::max(extent.x,glm::max(extent.y,extent.z));
+  model = glm::mat4(scale);
+  model[3] = glm::vec4(-center*scale,1.f);
+
+  prg = gpu.createProgram();
+  gpu.attachShaders(prg,mesh_VS,phong_FS);
+  gpu.setVS2FSType(prg,0,AttributeType::VEC3);
+  gpu.setVS2FSType(prg,1,AttributeType::VEC3);
+  // draws are skipped if the bounding box of mesh is out of frustum
+  gpu.setProgramCullingUniforms(prg,1,0,4);
+  gpu.setVertexPullerBoundingBox(mesh.vertexPuller,mesh.boundsMin,mesh.boundsMax);
+}
+
+/**
+ * @brief Draws mesh
+ *
+ * @param proj projection matrix
+ * @param view view matrix
+ * @param light light position
+ * @param camera camera position
+ */
+void MeshMethod::onDraw(glm::mat4 const&proj,glm::mat4 const&view,glm::vec3 const&light,glm::vec3 const&camera){
+  gpu.clear(.502f,.502f,.502f,1.f);
+  gpu.bindVertexPuller(mesh.vertexPuller);
+  gpu.useProgram(prg);
+  gpu.programUniformMatrix4f(prg,0,view);
+  gpu.programUniformMatrix4f(prg,1,proj);
+  gpu.programUniform3f(prg,2,light);
+  gpu.programUniform3f(prg,3,camera);
+  gpu.programUniformMatrix4f(prg,4,model);
+  gpu.drawTriangles(mesh.nofDrawVertices);
+  gpu.unbindVertexPuller();
+}
+
+/**
+ * @brief Destructor, the mesh file is unmapped when its buffers are released
+ */
+MeshMethod::~MeshMethod(){
+  deleteGPUMesh(gpu,mesh);
+  gpu.deleteProgram(prg);
+}
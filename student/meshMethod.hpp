@@ -0,0 +1,26 @@
+/*!
+ * @file
+ * @brief This file contains rendering method of mesh file
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <student/method.hpp>
+#include <student/meshFile.hpp>
+
+/**
+ * @brief This class draws mesh file (or imported OBJ/PLY) with phong shading, the mesh is scaled to the size of bunny.
+ * Head 0 of mesh has to hold positions and head 1 normals.
+ */
+class MeshMethod: public Method{
+  public:
+    MeshMethod(std::string const&fileName);
+    virtual ~MeshMethod();
+    virtual void onDraw(glm::mat4 const&proj,glm::mat4 const&view,glm::vec3 const&light,glm::vec3 const&camera) override;
+    GPUMesh mesh;///< buffers and vertex puller of mesh
+    ProgramID prg;///< id of program
+    glm::mat4 model = glm::mat4(1.f);///< model matrix that moves bounding box of mesh into <-1, 1>
+};
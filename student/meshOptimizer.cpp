@@ -0,0 +1,350 @@
+/*!
+ * @file
+ * @brief This file contains implementation of mesh optimisation.
+ *
+ * Vertex cache order is computed by Tipsify (Sander, Nehab, Barczak: Fast Triangle Reordering for Vertex Locality and Reduced Overdraw, 2007).
+ * Tipsify targets FIFO cache which is the cache of vertexProcessor, its output is split into clusters that are sorted to reduce overdraw.
+ */
+
+#include <student/meshOptimizer.hpp>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <glm/glm.hpp>
+
+namespace {
+
+/**
+ * @brief FIFO post-transform cache that behaves like the cache of vertexProcessor.
+ */
+class FifoCache {
+    public:
+        explicit FifoCache(uint32_t size):entries(size, ~0u){}
+        /**
+         * @brief Looks vertex up and inserts it if it misses.
+         * @return true if the vertex misses and it would be shaded
+         */
+        bool access(uint32_t vertex){
+            for (uint32_t c = 0; c < nofCached; c++)
+                if (entries[c] == vertex)
+                    return false;
+            entries[head] = vertex;
+            head = (head + 1) % entries.size();
+            nofCached = std::min(nofCached + 1, (uint32_t) entries.size());
+            return true;
+        }
+        void clear(){
+            nofCached = 0;
+            head = 0;
+        }
+    private:
+        std::vector<uint32_t> entries;
+        uint32_t head = 0;
+        uint32_t nofCached = 0;
+};
+
+/**
+ * @brief Triangles adjacent to each vertex.
+ */
+struct Adjacency {
+    std::vector<uint32_t> offsets;   ///< nofVertices + 1 offsets into triangles
+    std::vector<uint32_t> triangles; ///< adjacent triangles of vertices
+    std::vector<uint32_t> live;      ///< number of not emitted adjacent triangles
+};
+
+Adjacency buildAdjacency(uint32_t const *indices, uint32_t nofIndices, uint32_t nofVertices){
+    Adjacency adjacency;
+    adjacency.offsets.assign(nofVertices + 1, 0);
+    for (uint32_t i = 0; i < nofIndices; i++)
+        adjacency.offsets[indices[i] + 1]++;
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+    adjacency.live.resize(nofVertices);
+    for (uint32_t v = 0; v < nofVertices; v++)
+        adjacency.live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    adjacency.triangles.resize(nofIndices);
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (uint32_t i = 0; i < nofIndices; i++)
+        adjacency.triangles[fill[indices[i]]++] = i / 3;
+    return adjacency;
+}
+
+glm::vec3 readPosition(VertexStreamView const &positions, uint32_t vertex){
+    glm::vec3 position;
+    std::memcpy(&position, positions.data + (size_t) vertex * positions.stride, sizeof(position));
+    return position;
+}
+
+}
+
+/**
+ * @brief Simulates FIFO post-transform cache of vertexProcessor over indexed triangles.
+ *
+ * @param indices indices of triangles
+ * @param nofIndices number of indices
+ * @param nofVertices number of vertices, all indices have to be smaller
+ * @param cacheSize number of cached vertices
+ *
+ * @return ACMR and ATVR of index order
+ */
+VertexCacheStatistics analyzeVertexCache(uint32_t const *indices, uint32_t nofIndices, uint32_t nofVertices, uint32_t cacheSize){
+    VertexCacheStatistics statistics;
+    if (nofIndices < 3)
+        return statistics;
+    FifoCache cache(cacheSize);
+    std::vector<bool> used(nofVertices, false);
+    uint32_t nofMisses = 0;
+    uint32_t nofUsed = 0;
+    for (uint32_t i = 0; i < nofIndices; i++){
+        nofMisses += cache.access(indices[i]);
+        if (not used[indices[i]]){
+            used[indices[i]] = true;
+            nofUsed++;
+        }
+    }
+    statistics.acmr = (double) nofMisses / (nofIndices / 3);
+    statistics.atvr = (double) nofMisses / nofUsed;
+    return statistics;
+}
+
+/**
+ * @brief Reorders triangles for FIFO post-transform cache (Tipsify).
+ * Triangles around the fanning vertex are emitted together, the next fanning vertex is the
+ * adjacent vertex that stays longest in cache and that is not evicted by emitting its triangles.
+ *
+ * @param indices indices of triangles, they are reordered in place
+ * @param nofIndices number of indices
+ * @param nofVertices number of vertices, all indices have to be smaller
+ * @param cacheSize number of cached vertices
+ */
+void optimizeVertexCache(uint32_t *indices, uint32_t nofIndices, uint32_t nofVertices, uint32_t cacheSize){
+    uint32_t const nofTriangles = nofIndices / 3;
+    if (nofTriangles == 0)
+        return;
+    Adjacency adjacency = buildAdjacency(indices, nofTriangles * 3, nofVertices);
+    std::vector<uint32_t> output;
+    output.reserve(nofTriangles * 3);
+    std::vector<bool>     emitted(nofTriangles, false);
+    std::vector<uint32_t> timestamps(nofVertices, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;
+
+    auto nextFanningVertex = [&]() -> int64_t {
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates){
+            if (adjacency.live[v] == 0)
+                continue;
+            // vertex whose triangles would push it out of cache gets the lowest priority
+            int64_t priority = 0;
+            if (time - timestamps[v] + 2 * adjacency.live[v] <= cacheSize)
+                priority = time - timestamps[v];
+            if (priority > bestPriority){
+                bestPriority = priority;
+                best = v;
+            }
+        }
+        if (best >= 0)
+            return best;
+        while (not deadEnd.empty()){
+            uint32_t const v = deadEnd.back();
+            deadEnd.pop_back();
+            if (adjacency.live[v] != 0)
+                return v;
+        }
+        for (; cursor < nofVertices; cursor++)
+            if (adjacency.live[cursor] != 0)
+                return cursor;
+        return -1;
+    };
+
+    for (int64_t fanning = nextFanningVertex(); fanning >= 0; fanning = nextFanningVertex()){
+        candidates.clear();
+        for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++){
+            uint32_t const triangle = adjacency.triangles[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+            for (uint32_t k = 0; k < 3; k++){
+                uint32_t const v = indices[triangle * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                adjacency.live[v]--;
+                if (time - timestamps[v] > cacheSize)
+                    timestamps[v] = time++;
+            }
+        }
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+/**
+ * @brief Reorders clusters of triangles so that outer clusters facing away from the mesh center are drawn first.
+ * Clusters start where FIFO cache flushes (all vertices of triangle miss) and they are split further
+ * while ACMR of the cluster part stays under threshold times ACMR of the cluster.
+ * It is meant to run after optimizeVertexCache, cache is not shared between sorted clusters so ACMR grows slightly.
+ *
+ * @param indices indices of triangles, they are reordered in place
+ * @param nofIndices number of indices
+ * @param positions float positions of vertices
+ * @param threshold allowed increase of ACMR
+ * @param cacheSize number of cached vertices
+ *
+ * @return number of clusters
+ */
+uint32_t optimizeOverdraw(uint32_t *indices, uint32_t nofIndices, VertexStreamView const &positions, float threshold, uint32_t cacheSize){
+    uint32_t const nofTriangles = nofIndices / 3;
+    if (nofTriangles == 0)
+        return 0;
+
+    // hard boundaries, each cluster starts with triangle whose all vertices miss
+    FifoCache cache(cacheSize);
+    std::vector<uint32_t> misses(nofTriangles);
+    std::vector<uint32_t> hardClusters;
+    for (uint32_t t = 0; t < nofTriangles; t++){
+        misses[t] = cache.access(indices[t * 3 + 0]) + cache.access(indices[t * 3 + 1]) + cache.access(indices[t * 3 + 2]);
+        if (misses[t] == 3)
+            hardClusters.push_back(t);
+    }
+    if (hardClusters.empty() or hardClusters[0] != 0)
+        hardClusters.insert(hardClusters.begin(), 0);
+    hardClusters.push_back(nofTriangles);
+
+    // soft boundaries, the cache is cleared at the start of each part
+    std::vector<uint32_t> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); c++){
+        uint32_t const begin = hardClusters[c];
+        uint32_t const end   = hardClusters[c + 1];
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = begin; t < end; t++)
+            clusterMisses += misses[t];
+        double const target = threshold * (double) clusterMisses / (end - begin);
+        clusters.push_back(begin);
+        cache.clear();
+        uint32_t partMisses = 0;
+        uint32_t partTriangles = 0;
+        for (uint32_t t = begin; t < end; t++){
+            partMisses += cache.access(indices[t * 3 + 0]) + cache.access(indices[t * 3 + 1]) + cache.access(indices[t * 3 + 2]);
+            partTriangles++;
+            if (t + 1 < end and (double) partMisses / partTriangles <= target){
+                clusters.push_back(t + 1);
+                cache.clear();
+                partMisses = 0;
+                partTriangles = 0;
+            }
+        }
+    }
+    clusters.push_back(nofTriangles);
+    uint32_t const nofClusters = (uint32_t) clusters.size() - 1;
+
+    // area weighted centroids and normals of clusters
+    std::vector<glm::vec3> centroids(nofClusters, glm::vec3(0.f));
+    std::vector<glm::vec3> normals(nofClusters, glm::vec3(0.f));
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (uint32_t c = 0; c < nofClusters; c++){
+        float area = 0.f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++){
+            glm::vec3 const p0 = readPosition(positions, indices[t * 3 + 0]);
+            glm::vec3 const p1 = readPosition(positions, indices[t * 3 + 1]);
+            glm::vec3 const p2 = readPosition(positions, indices[t * 3 + 2]);
+            glm::vec3 const normal = glm::cross(p1 - p0, p2 - p0);
+            float const triangleArea = glm::length(normal);
+            centroids[c] += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normals[c] += normal;
+            area += triangleArea;
+        }
+        meshCentroid += centroids[c];
+        meshArea += area;
+        if (area > 0.f)
+            centroids[c] /= area;
+    }
+    if (meshArea > 0.f)
+        meshCentroid /= meshArea;
+
+    std::vector<float> sortKeys(nofClusters);
+    for (uint32_t c = 0; c < nofClusters; c++){
+        float const length = glm::length(normals[c]);
+        sortKeys[c] = length > 0.f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.f;
+    }
+    std::vector<uint32_t> order(nofClusters);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){return sortKeys[a] > sortKeys[b];});
+
+    std::vector<uint32_t> output;
+    output.reserve(nofTriangles * 3);
+    for (uint32_t c : order)
+        output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    std::copy(output.begin(), output.end(), indices);
+    return nofClusters;
+}
+
+/**
+ * @brief Renumbers vertices in order of their first use so that vertex puller reads buffers sequentially.
+ * Vertices that are not referenced get numbers after all referenced vertices.
+ *
+ * @param indices indices, they are renumbered in place
+ * @param nofIndices number of indices
+ * @param nofVertices number of vertices, all indices have to be smaller
+ * @param remap output new number of each vertex
+ *
+ * @return number of referenced vertices
+ */
+uint32_t optimizeVertexFetch(uint32_t *indices, uint32_t nofIndices, uint32_t nofVertices, std::vector<uint32_t> &remap){
+    remap.assign(nofVertices, ~0u);
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < nofIndices; i++){
+        uint32_t &number = remap[indices[i]];
+        if (number == ~0u)
+            number = next++;
+        indices[i] = number;
+    }
+    uint32_t const nofUsed = next;
+    for (uint32_t &number : remap)
+        if (number == ~0u)
+            number = next++;
+    return nofUsed;
+}
+
+/**
+ * @brief Moves vertices of stream to their new numbers.
+ *
+ * @param stream vertex stream, it is reordered in place
+ * @param nofVertices number of vertices
+ * @param remap new number of each vertex, it has to be permutation
+ */
+void remapVertexStream(VertexStreamView const &stream, uint32_t nofVertices, std::vector<uint32_t> const &remap){
+    std::vector<uint8_t> source(stream.data, stream.data + (size_t) nofVertices * stream.stride);
+    for (uint32_t v = 0; v < nofVertices; v++)
+        std::memcpy(stream.data + (size_t) remap[v] * stream.stride, source.data() + (size_t) v * stream.stride, stream.stride);
+}
+
+/**
+ * @brief Runs vertex cache, overdraw and vertex fetch optimisation of indexed triangles.
+ * Vertices that are not referenced are moved behind referenced ones and they are dropped.
+ *
+ * @param indices indices of triangles, they are reordered and renumbered in place
+ * @param nofIndices number of indices
+ * @param nofVertices number of vertices, it is updated to number of referenced vertices
+ * @param streams vertex streams, the first one holds float positions at offset 0
+ * @param nofStreams number of streams
+ *
+ * @return ACMR and ATVR before and after optimisation
+ */
+MeshOptimizationStatistics optimizeMesh(uint32_t *indices, uint32_t nofIndices, uint32_t &nofVertices,
+                                        VertexStreamView const *streams, uint32_t nofStreams){
+    MeshOptimizationStatistics statistics;
+    statistics.before = analyzeVertexCache(indices, nofIndices, nofVertices);
+    optimizeVertexCache(indices, nofIndices, nofVertices);
+    if (nofStreams != 0)
+        statistics.nofClusters = optimizeOverdraw(indices, nofIndices, streams[0]);
+    std::vector<uint32_t> remap;
+    uint32_t const nofUsed = optimizeVertexFetch(indices, nofIndices, nofVertices, remap);
+    for (uint32_t s = 0; s < nofStreams; s++)
+        remapVertexStream(streams[s], nofVertices, remap);
+    nofVertices = nofUsed;
+    statistics.after = analyzeVertexCache(indices, nofIndices, nofVertices);
+    return statistics;
+}
@@ -0,0 +1,45 @@
+/*!
+ * @file
+ * @brief This file contains optimisation of index and vertex order for post-transform cache, overdraw and vertex fetch.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <student/fwd.hpp>
+
+/**
+ * @brief Efficiency of post-transform vertex cache (FIFO cache of vertexProcessor).
+ */
+struct VertexCacheStatistics {
+    double acmr = 0.0; ///< average cache miss ratio - shaded vertices per triangle (0.5 - 3)
+    double atvr = 0.0; ///< average transformed vertex ratio - shaded vertices per used vertex (1 is optimal)
+};
+
+/**
+ * @brief Statistics of mesh optimisation.
+ */
+struct MeshOptimizationStatistics {
+    VertexCacheStatistics before; ///< cache efficiency of original index order
+    VertexCacheStatistics after;  ///< cache efficiency of optimised index order
+    uint32_t nofClusters = 0;     ///< number of clusters sorted by overdraw pass
+};
+
+/**
+ * @brief Vertex stream that is reordered together with vertices.
+ */
+struct VertexStreamView {
+    uint8_t *data = nullptr; ///< first vertex
+    uint32_t stride = 0;     ///< distance between vertices in bytes
+};
+
+VertexCacheStatistics analyzeVertexCache (uint32_t const *indices, uint32_t nofIndices, uint32_t nofVertices, uint32_t cacheSize = postTransformCacheSize);
+void                  optimizeVertexCache(uint32_t *indices, uint32_t nofIndices, uint32_t nofVertices, uint32_t cacheSize = postTransformCacheSize);
+uint32_t              optimizeOverdraw   (uint32_t *indices, uint32_t nofIndices, VertexStreamView const &positions, float threshold = 1.05f,
+                                          uint32_t cacheSize = postTransformCacheSize);
+uint32_t              optimizeVertexFetch(uint32_t *indices, uint32_t nofIndices, uint32_t nofVertices, std::vector<uint32_t> &remap);
+void                  remapVertexStream  (VertexStreamView const &stream, uint32_t nofVertices, std::vector<uint32_t> const &remap);
+MeshOptimizationStatistics optimizeMesh  (uint32_t *indices, uint32_t nofIndices, uint32_t &nofVertices,
+                                          VertexStreamView const *streams, uint32_t nofStreams);
@@ -0,0 +1,383 @@
+/*!
+ * @file
+ * @brief This file contains implementation of quadric error mesh simplifier.
+ *
+ * Edges are collapsed by error quadrics (Garland, Heckbert: Surface Simplification Using Quadric Error Metrics, 1997).
+ * Collapses move a vertex onto its neighbour (half-edge collapse), so all levels of detail share one vertex buffer.
+ * Each pass collapses independent edges in order of their error, vertices around a collapse are locked until the next pass.
+ */
+
+#include <student/meshSimplifier.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+/**
+ * @brief Sum of squared distances to weighted planes.
+ */
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    static Quadric plane(glm::vec3 const &normal, float distance, double weight){
+        Quadric q;
+        double const n0 = normal.x, n1 = normal.y, n2 = normal.z, d = distance;
+        q.a00 = weight * n0 * n0; q.a01 = weight * n0 * n1; q.a02 = weight * n0 * n2;
+        q.a11 = weight * n1 * n1; q.a12 = weight * n1 * n2; q.a22 = weight * n2 * n2;
+        q.b0 = weight * n0 * d; q.b1 = weight * n1 * d; q.b2 = weight * n2 * d;
+        q.c = weight * d * d;
+        q.weight = weight;
+        return q;
+    }
+    Quadric &operator+=(Quadric const &q){
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+        return *this;
+    }
+    /**
+     * @brief Returns mean squared distance of point to planes.
+     */
+    double error(glm::vec3 const &p) const {
+        double const x = p.x, y = p.y, z = p.z;
+        double const e = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                         2 * (b0 * x + b1 * y + b2 * z) + c;
+        return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+    }
+};
+
+enum class VertexKind : uint8_t { INTERIOR, BORDER, LOCKED };
+
+/**
+ * @brief Possible collapse of vertex from onto vertex to.
+ */
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double   error;
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b){
+    return (uint64_t) a << 32 | b;
+}
+
+/**
+ * @brief Returns sorted directed edges of triangles.
+ */
+std::vector<uint64_t> directedEdges(std::vector<uint32_t> const &indices){
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t t = 0; t < indices.size(); t += 3)
+        for (uint32_t k = 0; k < 3; k++)
+            edges.push_back(edgeKey(indices[t + k], indices[t + (k + 1) % 3]));
+    std::sort(edges.begin(), edges.end());
+    return edges;
+}
+
+bool hasEdge(std::vector<uint64_t> const &edges, uint32_t a, uint32_t b){
+    return std::binary_search(edges.begin(), edges.end(), edgeKey(a, b));
+}
+
+/**
+ * @brief Classifies vertices, vertices on more than two border edges are locked.
+ * Border edge has no opposite edge, it also separates vertices with the same position and different attributes.
+ */
+std::vector<VertexKind> classifyVertices(std::vector<uint64_t> const &edges, uint32_t nofVertices){
+    std::vector<uint32_t> borderEdges(nofVertices, 0);
+    for (uint64_t edge : edges){
+        auto const a = (uint32_t) (edge >> 32);
+        auto const b = (uint32_t) edge;
+        if (not hasEdge(edges, b, a)){
+            borderEdges[a]++;
+            borderEdges[b]++;
+        }
+    }
+    std::vector<VertexKind> kinds(nofVertices, VertexKind::INTERIOR);
+    for (uint32_t v = 0; v < nofVertices; v++)
+        kinds[v] = borderEdges[v] == 0 ? VertexKind::INTERIOR : borderEdges[v] == 2 ? VertexKind::BORDER : VertexKind::LOCKED;
+    // non-manifold edges are used by more triangles in the same direction
+    for (size_t e = 1; e < edges.size(); e++)
+        if (edges[e] == edges[e - 1]){
+            kinds[edges[e] >> 32] = VertexKind::LOCKED;
+            kinds[(uint32_t) edges[e]] = VertexKind::LOCKED;
+        }
+    return kinds;
+}
+
+/**
+ * @brief Tests that moving vertex from onto vertex to does not flip or squash any remaining triangle around it.
+ */
+bool keepsOrientation(std::vector<uint32_t> const &indices, std::vector<uint32_t> const &triangles, uint32_t from, uint32_t to,
+                      VertexStreamView const &positions){
+    auto position = [&](uint32_t v){
+        glm::vec3 p;
+        std::memcpy(&p, positions.data + (size_t) v * positions.stride, sizeof(p));
+        return p;
+    };
+    for (uint32_t t : triangles){
+        uint32_t const *triangle = &indices[t * 3];
+        if (triangle[0] == to or triangle[1] == to or triangle[2] == to)
+            continue;
+        glm::vec3 p[3] = {position(triangle[0]), position(triangle[1]), position(triangle[2])};
+        glm::vec3 const before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        for (uint32_t k = 0; k < 3; k++)
+            if (triangle[k] == from)
+                p[k] = position(to);
+        glm::vec3 const after = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float const lengths = glm::length(before) * glm::length(after);
+        if (lengths == 0.f or glm::dot(before, after) < 0.25f * lengths)
+            return false;
+    }
+    return true;
+}
+
+}
+
+/**
+ * @brief Simplifies indexed triangles by quadric error edge collapses, vertices are not modified.
+ *
+ * @param destination output indices, it has room for nofIndices indices (it may be the same array as indices)
+ * @param indices indices of triangles
+ * @param nofIndices number of indices
+ * @param positions float positions of vertices
+ * @param nofVertices number of vertices, all indices have to be smaller
+ * @param targetIndices wanted number of indices
+ * @param targetError maximal distance of simplified surface from original in object space units
+ * @param resultError output distance of simplified surface, may be nullptr
+ *
+ * @return number of indices written into destination, it is larger than targetIndices if the error limit was reached
+ */
+uint32_t simplifyMesh(uint32_t *destination, uint32_t const *indices, uint32_t nofIndices, VertexStreamView const &positions,
+                      uint32_t nofVertices, uint32_t targetIndices, float targetError, float *resultError){
+    std::vector<uint32_t> result(indices, indices + nofIndices / 3 * 3);
+    auto position = [&](uint32_t v){
+        glm::vec3 p;
+        std::memcpy(&p, positions.data + (size_t) v * positions.stride, sizeof(p));
+        return p;
+    };
+
+    std::vector<uint64_t> edges = directedEdges(result);
+    std::vector<VertexKind> const kinds = classifyVertices(edges, nofVertices);
+
+    // triangle planes weighted by area, border edges get perpendicular planes that keep the border in place
+    std::vector<Quadric> quadrics(nofVertices);
+    for (size_t t = 0; t < result.size(); t += 3){
+        glm::vec3 const p[3] = {position(result[t]), position(result[t + 1]), position(result[t + 2])};
+        glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float const area = glm::length(normal);
+        if (area == 0.f)
+            continue;
+        normal /= area;
+        Quadric const q = Quadric::plane(normal, -glm::dot(normal, p[0]), area);
+        for (uint32_t k = 0; k < 3; k++)
+            quadrics[result[t + k]] += q;
+        for (uint32_t k = 0; k < 3; k++){
+            uint32_t const a = result[t + k];
+            uint32_t const b = result[t + (k + 1) % 3];
+            if (hasEdge(edges, b, a))
+                continue;
+            glm::vec3 const edge = p[(k + 1) % 3] - p[k];
+            float const length = glm::length(edge);
+            if (length == 0.f)
+                continue;
+            glm::vec3 const borderNormal = glm::normalize(glm::cross(edge, normal));
+            Quadric const border = Quadric::plane(borderNormal, -glm::dot(borderNormal, p[k]), 10.f * length * length);
+            quadrics[a] += border;
+            quadrics[b] += border;
+        }
+    }
+
+    double const maxError = (double) targetError * targetError;
+    double reachedError = 0.0;
+    std::vector<uint32_t> remap(nofVertices);
+    std::vector<bool> locked(nofVertices);
+    std::vector<uint32_t> offsets(nofVertices + 1);
+    std::vector<uint32_t> adjacent;
+
+    while (result.size() > targetIndices){
+        // triangles around vertices of current mesh
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (uint32_t v : result)
+            offsets[v + 1]++;
+        for (uint32_t v = 0; v < nofVertices; v++)
+            offsets[v + 1] += offsets[v];
+        adjacent.resize(result.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < result.size(); i++)
+            adjacent[fill[result[i]]++] = (uint32_t) (i / 3);
+
+        // the cheaper direction of each edge, border vertices move only along border
+        edges = directedEdges(result);
+        std::vector<Collapse> collapses;
+        for (uint64_t edge : edges){
+            auto const a = (uint32_t) (edge >> 32);
+            auto const b = (uint32_t) edge;
+            bool const border = not hasEdge(edges, b, a);
+            if (not border and a > b)
+                continue;
+            Collapse best = {a, b, std::numeric_limits<double>::max()};
+            uint32_t const ends[2][2] = {{a, b}, {b, a}};
+            for (auto const &end : ends){
+                uint32_t const from = end[0], to = end[1];
+                bool const allowed = kinds[from] == VertexKind::INTERIOR or
+                                     (kinds[from] == VertexKind::BORDER and kinds[to] != VertexKind::INTERIOR and border);
+                if (not allowed)
+                    continue;
+                Quadric q = quadrics[from];
+                q += quadrics[to];
+                double const error = q.error(position(to));
+                if (error < best.error)
+                    best = {from, to, error};
+            }
+            if (best.error <= maxError)
+                collapses.push_back(best);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](Collapse const &a, Collapse const &b){return a.error < b.error;});
+
+        for (uint32_t v = 0; v < nofVertices; v++)
+            remap[v] = v;
+        std::fill(locked.begin(), locked.end(), false);
+        size_t nofTriangles = result.size() / 3;
+        size_t const targetTriangles = targetIndices / 3;
+        uint32_t nofCollapses = 0;
+        for (Collapse const &collapse : collapses){
+            if (nofTriangles <= targetTriangles)
+                break;
+            if (locked[collapse.from] or locked[collapse.to])
+                continue;
+            std::vector<uint32_t> const triangles(adjacent.begin() + offsets[collapse.from], adjacent.begin() + offsets[collapse.from + 1]);
+            if (not keepsOrientation(result, triangles, collapse.from, collapse.to, positions))
+                continue;
+            for (uint32_t t : triangles){
+                for (uint32_t k = 0; k < 3; k++)
+                    locked[result[t * 3 + k]] = true;
+                if (result[t * 3] == collapse.to or result[t * 3 + 1] == collapse.to or result[t * 3 + 2] == collapse.to)
+                    nofTriangles--;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            reachedError = std::max(reachedError, collapse.error);
+            nofCollapses++;
+        }
+        if (nofCollapses == 0)
+            break;
+
+        size_t write = 0;
+        for (size_t t = 0; t < result.size(); t += 3){
+            uint32_t const a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+            if (a == b or b == c or c == a)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    std::copy(result.begin(), result.end(), destination);
+    if (resultError != nullptr)
+        *resultError = (float) std::sqrt(reachedError);
+    return (uint32_t) result.size();
+}
+
+/**
+ * @brief Appends levels of detail behind the indices of the full mesh, every level has about ratio times triangles of previous one.
+ * The chain ends when the simplifier cannot reach at least 80 % of the wanted reduction.
+ * Each level is ordered for post-transform cache.
+ *
+ * @param indices indices of full mesh, levels are appended
+ * @param positions float positions of vertices
+ * @param nofVertices number of vertices
+ * @param maxLevels maximal number of levels including the full mesh
+ * @param ratio ratio of triangles of next and previous level
+ *
+ * @return levels of detail, the first one is the full mesh
+ */
+std::vector<MeshLod> buildLodChain(std::vector<uint32_t> &indices, VertexStreamView const &positions, uint32_t nofVertices,
+                                   uint32_t maxLevels, float ratio){
+    std::vector<MeshLod> lods = {{0, (uint32_t) indices.size(), 0.f}};
+    BoundingSphere const sphere = computeBoundingSphere(positions, nofVertices);
+    while (lods.size() < maxLevels){
+        MeshLod const &previous = lods.back();
+        auto const target = (uint32_t) (previous.nofIndices * ratio) / 3 * 3;
+        if (target < 3 * 16)
+            break;
+        std::vector<uint32_t> simplified(previous.nofIndices);
+        float error = 0.f;
+        uint32_t const nofIndices = simplifyMesh(simplified.data(), indices.data() + previous.firstIndex, previous.nofIndices, positions,
+                                                 nofVertices, target, sphere.radius, &error);
+        if (previous.nofIndices - nofIndices < 0.8f * (previous.nofIndices - target))
+            break;
+        optimizeVertexCache(simplified.data(), nofIndices, nofVertices);
+        MeshLod lod;
+        lod.firstIndex = (uint32_t) indices.size();
+        lod.nofIndices = nofIndices;
+        // errors of levels are accumulated, each level is simplified from the previous one
+        lod.error = previous.error + error;
+        indices.insert(indices.end(), simplified.begin(), simplified.begin() + nofIndices);
+        lods.push_back(lod);
+    }
+    return lods;
+}
+
+/**
+ * @brief Computes bounding sphere around center of bounding box.
+ * @param positions float positions of vertices
+ * @param nofVertices number of vertices
+ * @return bounding sphere
+ */
+BoundingSphere computeBoundingSphere(VertexStreamView const &positions, uint32_t nofVertices){
+    BoundingSphere sphere;
+    if (nofVertices == 0)
+        return sphere;
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (uint32_t v = 0; v < nofVertices; v++){
+        glm::vec3 p;
+        std::memcpy(&p, positions.data + (size_t) v * positions.stride, sizeof(p));
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+    sphere.center = (boundsMin + boundsMax) * .5f;
+    for (uint32_t v = 0; v < nofVertices; v++){
+        glm::vec3 p;
+        std::memcpy(&p, positions.data + (size_t) v * positions.stride, sizeof(p));
+        sphere.radius = std::max(sphere.radius, glm::length(p - sphere.center));
+    }
+    return sphere;
+}
+
+/**
+ * @brief Selects the coarsest level of detail whose error projected on screen is at most pixelError.
+ * Error is projected at the point of bounding sphere nearest to camera, so the selection is conservative
+ * over the whole mesh. The full mesh is selected if camera is inside of the sphere.
+ *
+ * @param lods levels of detail with growing error
+ * @param sphere bounding sphere in object space
+ * @param modelView transformation from object space to view space
+ * @param proj projection matrix
+ * @param viewportHeight height of viewport in pixels
+ * @param pixelError allowed error in pixels
+ *
+ * @return index of level of detail
+ */
+uint32_t selectLod(std::vector<MeshLod> const &lods, BoundingSphere const &sphere, glm::mat4 const &modelView,
+                   glm::mat4 const &proj, uint32_t viewportHeight, float pixelError){
+    glm::vec3 const axis = glm::vec3(modelView[0]);
+    float const scale = glm::length(axis); // uniform scale of model view matrix
+    float const distance = -(modelView * glm::vec4(sphere.center, 1.f)).z - sphere.radius * scale;
+    if (distance <= 0.f or lods.empty())
+        return 0;
+    float const pixelsPerUnit = proj[1][1] * (float) viewportHeight * .5f * scale / distance;
+    uint32_t selected = 0;
+    for (uint32_t l = 1; l < lods.size(); l++)
+        if (lods[l].error * pixelsPerUnit <= pixelError)
+            selected = l;
+    return selected;
+}
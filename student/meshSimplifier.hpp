@@ -0,0 +1,37 @@
+/*!
+ * @file
+ * @brief This file contains quadric error mesh simplifier and chain of levels of detail.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <student/fwd.hpp>
+#include <student/meshOptimizer.hpp>
+
+/**
+ * @brief Level of detail, it is a range of index buffer that references the same vertices as all other levels.
+ */
+struct MeshLod {
+    uint32_t firstIndex = 0; ///< first index of level in index buffer
+    uint32_t nofIndices = 0; ///< number of indices of level
+    float    error      = 0.f; ///< geometric error against the full mesh in object space units
+};
+
+/**
+ * @brief Bounding sphere in object space.
+ */
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.f);
+    float     radius = 0.f;
+};
+
+uint32_t             simplifyMesh       (uint32_t *destination, uint32_t const *indices, uint32_t nofIndices, VertexStreamView const &positions,
+                                         uint32_t nofVertices, uint32_t targetIndices, float targetError, float *resultError = nullptr);
+std::vector<MeshLod> buildLodChain      (std::vector<uint32_t> &indices, VertexStreamView const &positions, uint32_t nofVertices,
+                                         uint32_t maxLevels = 6, float ratio = 0.5f);
+BoundingSphere       computeBoundingSphere(VertexStreamView const &positions, uint32_t nofVertices);
+uint32_t             selectLod          (std::vector<MeshLod> const &lods, BoundingSphere const &sphere, glm::mat4 const &modelView,
+                                         glm::mat4 const &proj, uint32_t viewportHeight, float pixelError = 1.f);
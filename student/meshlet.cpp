@@ -0,0 +1,219 @@
+/*!
+ * @file
+ * @brief This file contains implementation of meshlet partitioning.
+ *
+ * Triangles of each meshlet are moved next to each other, so meshlets are contiguous ranges of the index buffer
+ * and the vertex puller draws them without any other index buffer.
+ */
+
+#include <student/meshlet.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+glm::vec3 readPosition(VertexStreamView const &positions, uint32_t vertex){
+    glm::vec3 position;
+    std::memcpy(&position, positions.data + (size_t) vertex * positions.stride, sizeof(position));
+    return position;
+}
+
+}
+
+/**
+ * @brief Reorders triangles of index buffer range into meshlets and returns them.
+ * Meshlet grows from a seed triangle by adjacent triangles that add the fewest new vertices and whose normal
+ * stays close to the average normal of meshlet, so meshlets are compact and their cones of normals are narrow.
+ * Meshlet ends when no adjacent triangle fits into maxVertices and maxTriangles.
+ * Triangles inside each meshlet are then reordered for post-transform cache by \ref optimizeVertexCache.
+ *
+ * @param indices the whole index buffer, triangles of the range are reordered in place
+ * @param firstIndex first index of partitioned range (multiple of 3)
+ * @param nofIndices number of indices of partitioned range
+ * @param positions float positions of vertices
+ * @param maxVertices maximal number of unique vertices of meshlet
+ * @param maxTriangles maximal number of triangles of meshlet
+ *
+ * @return meshlets sorted by firstIndex with their bounds
+ */
+std::vector<Meshlet> buildMeshlets(uint32_t *indices, uint32_t firstIndex, uint32_t nofIndices, VertexStreamView const &positions,
+                                   uint32_t maxVertices, uint32_t maxTriangles){
+    uint32_t const *triangles = indices + firstIndex;
+    uint32_t const nofTriangles = nofIndices / 3;
+
+    // triangles around vertices of the range, vertices are renumbered locally
+    std::vector<uint32_t> local(triangles, triangles + nofTriangles * 3);
+    std::vector<uint32_t> globals(local);
+    std::sort(globals.begin(), globals.end());
+    globals.erase(std::unique(globals.begin(), globals.end()), globals.end());
+    for (uint32_t &v : local)
+        v = (uint32_t) (std::lower_bound(globals.begin(), globals.end(), v) - globals.begin());
+    auto const nofVertices = (uint32_t) globals.size();
+    std::vector<uint32_t> offsets(nofVertices + 1, 0);
+    for (uint32_t v : local)
+        offsets[v + 1]++;
+    for (uint32_t v = 0; v < nofVertices; v++)
+        offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> adjacent(local.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t i = 0; i < local.size(); i++)
+        adjacent[fill[local[i]]++] = i / 3;
+
+    std::vector<glm::vec3> normals(nofTriangles, glm::vec3(0.f));
+    for (uint32_t t = 0; t < nofTriangles; t++){
+        glm::vec3 const p0 = readPosition(positions, triangles[t * 3]);
+        glm::vec3 const normal = glm::cross(readPosition(positions, triangles[t * 3 + 1]) - p0, readPosition(positions, triangles[t * 3 + 2]) - p0);
+        float const length = glm::length(normal);
+        if (length > 0.f)
+            normals[t] = normal / length;
+    }
+
+    std::vector<bool> emitted(nofTriangles, false);
+    std::vector<uint32_t> vertexMeshlet(nofVertices, ~0u); // the last meshlet that uses vertex
+    std::vector<uint32_t> order;
+    order.reserve(nofTriangles);
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> candidates;
+    uint32_t seed = 0;
+
+    while (order.size() < nofTriangles){
+        while (emitted[seed])
+            seed++;
+        auto const id = (uint32_t) meshlets.size();
+        Meshlet meshlet{};
+        meshlet.firstIndex = firstIndex + (uint32_t) order.size() * 3;
+        uint32_t nofMeshletVertices = 0;
+        glm::vec3 axis(0.f);
+        candidates.clear();
+        uint32_t next = seed;
+        while (next != ~0u){
+            emitted[next] = true;
+            order.push_back(next);
+            meshlet.count += 3;
+            axis += normals[next];
+            for (uint32_t k = 0; k < 3; k++){
+                uint32_t const v = local[next * 3 + k];
+                if (vertexMeshlet[v] == id)
+                    continue;
+                vertexMeshlet[v] = id;
+                nofMeshletVertices++;
+                for (uint32_t a = offsets[v]; a < offsets[v + 1]; a++)
+                    if (not emitted[adjacent[a]])
+                        candidates.push_back(adjacent[a]);
+            }
+            if (meshlet.count / 3 >= maxTriangles)
+                break;
+
+            // the best candidate adds fewest vertices, normal opposite to axis costs as much as two new vertices
+            float const axisLength = glm::length(axis);
+            glm::vec3 const direction = axisLength > 0.f ? axis / axisLength : axis;
+            next = ~0u;
+            float bestScore = std::numeric_limits<float>::max();
+            size_t write = 0;
+            for (uint32_t t : candidates){
+                if (emitted[t])
+                    continue;
+                candidates[write++] = t;
+                uint32_t nofNew = 0;
+                for (uint32_t k = 0; k < 3; k++)
+                    nofNew += vertexMeshlet[local[t * 3 + k]] != id;
+                if (nofMeshletVertices + nofNew > maxVertices)
+                    continue;
+                float const score = (float) nofNew + 1.f - glm::dot(normals[t], direction);
+                if (score < bestScore){
+                    bestScore = score;
+                    next = t;
+                }
+            }
+            candidates.resize(write);
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    std::vector<uint32_t> reordered(nofTriangles * 3);
+    for (uint32_t t = 0; t < nofTriangles; t++)
+        std::copy(triangles + order[t] * 3, triangles + order[t] * 3 + 3, reordered.begin() + t * 3);
+    std::copy(reordered.begin(), reordered.end(), indices + firstIndex);
+
+    // growth order ignores post-transform cache, which starts empty for each meshlet draw,
+    // so triangles of each meshlet are reordered by Tipsify over vertices renumbered within meshlet
+    std::vector<uint32_t> meshletIndices;
+    std::vector<uint32_t> meshletVertices;
+    for (auto &meshlet : meshlets){
+        uint32_t *range = indices + meshlet.firstIndex;
+        meshletIndices.assign(range, range + meshlet.count);
+        meshletVertices.clear();
+        for (uint32_t &v : meshletIndices){
+            auto const meshletVertex = (uint32_t) (std::find(meshletVertices.begin(), meshletVertices.end(), v) - meshletVertices.begin());
+            if (meshletVertex == meshletVertices.size())
+                meshletVertices.push_back(v);
+            v = meshletVertex;
+        }
+        optimizeVertexCache(meshletIndices.data(), meshlet.count, (uint32_t) meshletVertices.size());
+        for (uint32_t i = 0; i < meshlet.count; i++)
+            range[i] = meshletVertices[meshletIndices[i]];
+        computeMeshletBounds(meshlet, indices, positions);
+    }
+    return meshlets;
+}
+
+/**
+ * @brief Computes bounding sphere and cone of normals of meshlet.
+ * Cone cutoff is the sine of the largest angle between axis and triangle normal,
+ * meshlet whose normals spread over more than about 84 degrees gets cutoff 1 and it is never rejected as back-facing.
+ *
+ * @param meshlet meshlet with firstIndex and count
+ * @param indices the whole index buffer
+ * @param positions float positions of vertices
+ */
+void computeMeshletBounds(Meshlet &meshlet, uint32_t const *indices, VertexStreamView const &positions){
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.count; i++){
+        glm::vec3 const p = readPosition(positions, indices[i]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+    glm::vec3 const center = (boundsMin + boundsMax) * .5f;
+    float radius = 0.f;
+    glm::vec3 axis(0.f);
+    std::vector<glm::vec3> normals;
+    for (uint32_t t = meshlet.firstIndex; t + 3 <= meshlet.firstIndex + meshlet.count; t += 3){
+        glm::vec3 const p[3] = {readPosition(positions, indices[t]), readPosition(positions, indices[t + 1]), readPosition(positions, indices[t + 2])};
+        for (auto const &position : p)
+            radius = std::max(radius, glm::length(position - center));
+        glm::vec3 const normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float const length = glm::length(normal);
+        if (length == 0.f)
+            continue;
+        normals.push_back(normal / length);
+        axis += normals.back();
+    }
+    float const axisLength = glm::length(axis);
+    float minDot = -1.f;
+    if (axisLength > 0.f){
+        axis /= axisLength;
+        minDot = 1.f;
+        for (auto const &normal : normals)
+            minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+    // apex is moved back along axis until every triangle plane is in front of it
+    float apexDistance = 0.f;
+    for (uint32_t t = meshlet.firstIndex; t + 3 <= meshlet.firstIndex + meshlet.count and minDot > .1f; t += 3){
+        glm::vec3 const p0 = readPosition(positions, indices[t]);
+        glm::vec3 normal = glm::cross(readPosition(positions, indices[t + 1]) - p0, readPosition(positions, indices[t + 2]) - p0);
+        float const length = glm::length(normal);
+        if (length == 0.f)
+            continue;
+        normal /= length;
+        apexDistance = std::max(apexDistance, glm::dot(center - p0, normal) / glm::dot(axis, normal));
+    }
+    glm::vec3 const apex = center - axis * apexDistance;
+    std::memcpy(meshlet.center, &center, sizeof(meshlet.center));
+    std::memcpy(meshlet.coneApex, &apex, sizeof(meshlet.coneApex));
+    meshlet.radius = radius;
+    std::memcpy(meshlet.coneAxis, &axis, sizeof(meshlet.coneAxis));
+    meshlet.coneCutoff = minDot <= .1f ? 1.f : std::sqrt(1.f - minDot * minDot);
+}
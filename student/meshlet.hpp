@@ -0,0 +1,19 @@
+/*!
+ * @file
+ * @brief This file contains partitioning of index buffers into meshlets with bounding spheres and normal cones.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <student/fwd.hpp>
+#include <student/meshOptimizer.hpp>
+
+uint32_t const meshletMaxVertices  = 64;  ///< maximal number of unique vertices of meshlet
+uint32_t const meshletMaxTriangles = 124; ///< maximal number of triangles of meshlet
+
+std::vector<Meshlet> buildMeshlets(uint32_t *indices, uint32_t firstIndex, uint32_t nofIndices, VertexStreamView const &positions,
+                                   uint32_t maxVertices = meshletMaxVertices, uint32_t maxTriangles = meshletMaxTriangles);
+void computeMeshletBounds(Meshlet &meshlet, uint32_t const *indices, VertexStreamView const &positions);
@@ -0,0 +1,62 @@
+/*!
+ * @file
+ * @brief This file contains list of rendering methods shared by application and benchmark.
+ */
+
+#include <student/methodRegistry.hpp>
+#include <student/emptyMethod.hpp>
+#include <student/triangleMethod.hpp>
+#include <student/triangleClip1Method.hpp>
+#include <student/triangleClip2Method.hpp>
+#include <student/triangle3DMethod.hpp>
+#include <student/triangleBufferMethod.hpp>
+#include <student/czFlagMethod.hpp>
+#include <student/phongMethod.hpp>
+#include <student/meshMethod.hpp>
+#include <student/sceneMethod.hpp>
+
+namespace {
+
+/**
+ * @brief Appends method that is constructed with arguments.
+ *
+ * @tparam CLASS method class
+ * @tparam ARGS types of constructor arguments
+ * @param methods list of methods
+ * @param name name of the method
+ * @param args constructor arguments, they are copied
+ */
+template<typename CLASS, typename... ARGS>
+void addMethod(std::vector<RegisteredMethod> &methods, std::string const &name, ARGS const &...args){
+    methods.push_back({name, [args...](){ return std::make_shared<CLASS>(args...); }});
+}
+
+}
+
+/**
+ * @brief Returns all rendering methods in the order of application, benchmark measures the same list.
+ *
+ * @param meshFile mesh file drawn by "phong mesh file" method, the method is left out if it is empty
+ *
+ * @return list of names and factories
+ */
+std::vector<RegisteredMethod> registeredMethods(std::string const &meshFile){
+    std::vector<RegisteredMethod> methods;
+    addMethod<EmptyMethod         >(methods, "empty window"                                     );
+    addMethod<TriangleMethod      >(methods, "triangle 2D"                                      );
+    addMethod<TriangleClip1Method >(methods, "triangle clipping (one point behind near plane)"  );
+    addMethod<TriangleClip2Method >(methods, "triangle clipping (two points behind near plane)" );
+    addMethod<Triangle3DMethod    >(methods, "triangle 3D"                                      );
+    addMethod<TriangleBufferMethod>(methods, "triangle stored in buffer"                        );
+    addMethod<CZFlagMethod        >(methods, "czech flag"                                       );
+    addMethod<PhongMethod         >(methods, "phong bunny"                                      );
+    addMethod<PhongMethod         >(methods, "phong bunny (back-face culling)"                  , true);
+    addMethod<PhongMethod         >(methods, "phong bunny (depth prepass)"                      , false, true);
+    addMethod<PhongMethod         >(methods, "phong bunny (visibility buffer)"                  , false, false, true);
+    addMethod<SceneMethod         >(methods, "phong scene (10000 bunnies)"                      );
+    addMethod<SceneMethod         >(methods, "phong scene (occlusion culling)"                  , true);
+    addMethod<SceneMethod         >(methods, "phong scene (visibility buffer)"                  , false, 10000u, true);
+    if (not meshFile.empty())
+        addMethod<MeshMethod      >(methods, "phong mesh file"                                  , meshFile);
+    return methods;
+}
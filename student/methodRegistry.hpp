@@ -0,0 +1,25 @@
+/*!
+ * @file
+ * @brief This file contains list of rendering methods shared by application and benchmark.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <student/method.hpp>
+
+using MethodFactory = std::function<std::shared_ptr<Method>()>;
+
+/**
+ * @brief Rendering method with its name.
+ */
+struct RegisteredMethod {
+    std::string   name;    ///< name of method, application shows it in window title
+    MethodFactory factory; ///< creates new instance of method
+};
+
+std::vector<RegisteredMethod> registeredMethods(std::string const &meshFile = "");
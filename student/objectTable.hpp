@@ -0,0 +1,113 @@
+/*!
+ * @file
+ * @brief This file contains thread-safe table of GPU objects.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <student/fwd.hpp>
+
+uint32_t const nofObjectTableShards = 16;///< number of independently locked parts of object table
+
+/**
+ * @brief Table that maps object ids to objects.
+ * Ids are taken from an atomic counter, so they are unique and never reused.
+ * The table is split into shards with their own mutex, threads that work with different objects rarely wait for each other.
+ * Objects are returned as shared pointers, an object deleted by one thread stays alive until other threads stop using it.
+ *
+ * @tparam T type of object
+ */
+template<typename T>
+class ObjectTable {
+    public:
+        /**
+         * @brief Inserts object into the table.
+         * @param object object
+         * @return new id of the object (never emptyID)
+         */
+        ObjectID insert(std::shared_ptr<T> object){
+            ObjectID id = nextID.fetch_add(1, std::memory_order_relaxed);
+            if (id == emptyID)
+                id = nextID.fetch_add(1, std::memory_order_relaxed);
+            Shard &s = shard(id);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.objects.emplace(id, std::move(object));
+            return id;
+        }
+
+        /**
+         * @brief Returns object.
+         * @param id id of object
+         * @return object or nullptr if the id does not exist
+         */
+        std::shared_ptr<T> get(ObjectID id) const {
+            Shard &s = shard(id);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.objects.find(id);
+            return it != s.objects.end() ? it->second : nullptr;
+        }
+
+        /**
+         * @brief Replaces object stored under existing id.
+         * @param id id of object
+         * @param object new object
+         * @return previous object or nullptr if the id does not exist
+         */
+        std::shared_ptr<T> replace(ObjectID id, std::shared_ptr<T> object){
+            Shard &s = shard(id);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.objects.find(id);
+            if (it == s.objects.end())
+                return nullptr;
+            std::swap(it->second, object);
+            return object;
+        }
+
+        /**
+         * @brief Removes object from the table.
+         * @param id id of object
+         * @return removed object (it is destroyed when the last user releases it) or nullptr if the id does not exist
+         */
+        std::shared_ptr<T> erase(ObjectID id){
+            Shard &s = shard(id);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.objects.find(id);
+            if (it == s.objects.end())
+                return nullptr;
+            auto object = std::move(it->second);
+            s.objects.erase(it);
+            return object;
+        }
+
+        /**
+         * @brief Tests if id exists.
+         * @param id id of object
+         * @return true if the table contains the id
+         */
+        bool contains(ObjectID id) const {
+            Shard &s = shard(id);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            return s.objects.count(id) != 0;
+        }
+
+    private:
+        /**
+         * @brief Part of the table guarded by its own mutex.
+         */
+        struct Shard {
+            std::mutex mutex;
+            std::unordered_map<ObjectID, std::shared_ptr<T>> objects;
+        };
+
+        Shard &shard(ObjectID id) const {
+            return shards[id % nofObjectTableShards];
+        }
+
+        mutable Shard shards[nofObjectTableShards];
+        std::atomic<ObjectID> nextID{1};
+};
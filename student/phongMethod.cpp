@@ -5,10 +5,15 @@
  * @author Tomáš Milet, imilet@fit.vutbr.cz
  */
 #include <cmath>
+#include <iterator>
+#include <vector>
 #include <glm/glm.hpp>
 
 #include <student/phongMethod.hpp>
 #include <student/bunny.hpp>
+#include <student/meshOptimizer.hpp>
+#include <student/meshSimplifier.hpp>
+#include <student/meshlet.hpp>
 
 #include "gpu.hpp"
 
@@ -178,8 +183,13 @@ void phong_FS(OutFragment &outFragment, InFragment const &inFragment, Uniforms c
 
 /**
  * @brief Constructoro f phong method
+ *
+ * @param faceCulling true if back faces are culled, back-facing meshlets are then rejected before vertex shading
+ * @param depthPrepass true if bunny is drawn into depth buffer first and then shaded with EQUAL depth test
+ * @param visibilityBuffer true if bunny is drawn into visibility buffer and each covered pixel is shaded once by resolve
  */
-PhongMethod::PhongMethod(){
+PhongMethod::PhongMethod(bool faceCulling, bool depthPrepass, bool visibilityBuffer):
+    depthPrepass(depthPrepass), visibilityBuffer(visibilityBuffer){
 /// Zde byste měli vytvořit buffery na GPU, nahrát data do bufferů, vytvořit
 /// vertex puller a správně jej nakonfigurovat, vytvořit program, připojit k
 /// němu shadery a nastavit atributy, které se posílají mezi vs a fs.
@@ -202,16 +212,36 @@ PhongMethod::PhongMethod(){
 ///  - gpu.attachShaders()
 ///  - gpu.setVS2FSType()
 
+    // triangles of bunny are reordered for post-transform cache and overdraw, vertices in order of their first use
+    std::vector<BunnyVertex> vertices(std::begin(bunnyVertices), std::end(bunnyVertices));
+    std::vector<VertexIndex> indices(&bunnyIndices[0][0], &bunnyIndices[0][0] + sizeof(bunnyIndices) / sizeof(VertexIndex));
+    uint32_t nofVertices = (uint32_t) vertices.size();
+    VertexStreamView const stream = {(uint8_t *) vertices.data(), sizeof(BunnyVertex)};
+    optimizeMesh(indices.data(), (uint32_t) indices.size(), nofVertices, &stream, 1);
+    // simplified levels of detail are appended behind the full mesh and they share its vertices
+    lods = buildLodChain(indices, stream, nofVertices);
+    boundingSphere = computeBoundingSphere(stream, nofVertices);
+    // meshlets of each level are rejected by GPU before their vertices are shaded
+    std::vector<Meshlet> meshlets;
+    for (auto const &lod : lods){
+        auto const lodMeshlets = buildMeshlets(indices.data(), lod.firstIndex, lod.nofIndices, stream);
+        meshlets.insert(meshlets.end(), lodMeshlets.begin(), lodMeshlets.end());
+    }
+
     bufferVertices = gpu.createBuffer(sizeof(bunnyVertices));
-    gpu.setBufferData(bufferVertices, 0, sizeof(bunnyVertices), bunnyVertices);
-    bufferIndices = gpu.createBuffer(sizeof(bunnyVertices));
-    gpu.setBufferData(bufferIndices, 0, sizeof(bunnyIndices), bunnyIndices);
+    gpu.setBufferData(bufferVertices, 0, sizeof(bunnyVertices), vertices.data());
+    bufferIndices = gpu.createBuffer(indices.size() * sizeof(VertexIndex));
+    gpu.setBufferData(bufferIndices, 0, indices.size() * sizeof(VertexIndex), indices.data());
+    bufferMeshlets = gpu.createBuffer(meshlets.size() * sizeof(Meshlet));
+    gpu.setBufferData(bufferMeshlets, 0, meshlets.size() * sizeof(Meshlet), meshlets.data());
 
     vertexPuller = gpu.createVertexPuller();
     gpu.setVertexPullerHead(vertexPuller, 0, AttributeType::VEC3, sizeof(BunnyVertex), 0, bufferVertices);
     gpu.setVertexPullerHead(vertexPuller, 1, AttributeType::VEC3, sizeof(BunnyVertex), 3*sizeof(float ),bufferVertices);
 
     gpu.setVertexPullerIndexing(vertexPuller, IndexType::UINT32, bufferIndices);
+    gpu.setVertexPullerMeshlets(vertexPuller, bufferMeshlets, (uint32_t) meshlets.size());
+    gpu.setVertexPullerBoundingSphere(vertexPuller, boundingSphere.center, boundingSphere.radius);
 
     gpu.enableVertexPullerHead(vertexPuller, 0);
     gpu.enableVertexPullerHead(vertexPuller, 1);
@@ -220,6 +250,9 @@ PhongMethod::PhongMethod(){
     gpu.attachShaders(program, phong_VS, phong_FS);
     gpu.setVS2FSType(program, 0, AttributeType::VEC3);
     gpu.setVS2FSType(program, 1, AttributeType::VEC3);
+    gpu.setProgramCullingUniforms(program, 1, 0);
+    if (faceCulling)
+        gpu.enableFaceCulling();
 }
 
 
@@ -251,7 +284,28 @@ void PhongMethod::onDraw(glm::mat4 const &proj, glm::mat4 const &view, glm::vec3
     gpu.programUniformMatrix4f(program, 1, proj);
     gpu.programUniform3f(program, 2, light);
     gpu.programUniform3f(program, 3, camera);
-    gpu.drawTriangles(2092 * 3);
+    // the coarsest level whose error stays under one pixel, the full mesh covers the whole screen at start
+    selectedLod = selectLod(lods, boundingSphere, view, proj, gpu.getFramebufferHeight());
+    if (visibilityBuffer){
+        gpu.beginVisibilityBuffer();
+        gpu.drawTrianglesRange(lods[selectedLod].firstIndex, lods[selectedLod].nofIndices);
+        gpu.resolveVisibilityBuffer();
+        gpu.unbindVertexPuller();
+        return;
+    }
+    if (depthPrepass){
+        // only the nearest surface is shaded, hidden fragments of the second pass fail the test before shading
+        gpu.colorMask(false);
+        gpu.drawTrianglesRange(lods[selectedLod].firstIndex, lods[selectedLod].nofIndices);
+        gpu.colorMask(true);
+        gpu.depthMask(false);
+        gpu.depthFunc(DepthFunction::EQUAL);
+    }
+    gpu.drawTrianglesRange(lods[selectedLod].firstIndex, lods[selectedLod].nofIndices);
+    if (depthPrepass){
+        gpu.depthMask(true);
+        gpu.depthFunc(DepthFunction::LESS);
+    }
     gpu.unbindVertexPuller();
 }
 
@@ -266,6 +320,7 @@ PhongMethod::~PhongMethod(){
     ///  - gpu.deleteBuffer()
     gpu.deleteBuffer(bufferVertices);
     gpu.deleteBuffer(bufferIndices);
+    gpu.deleteBuffer(bufferMeshlets);
     gpu.deleteVertexPuller(vertexPuller);
     gpu.deleteProgram(program);
 }
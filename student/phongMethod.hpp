@@ -8,6 +8,7 @@
 #pragma once
 
 #include <student/method.hpp>
+#include <student/meshSimplifier.hpp>
 
 /// \addtogroup cpu_side Úkoly v cpu části
 /// @{
@@ -19,13 +20,20 @@ class PhongMethod: public Method{
   public:
     BufferID bufferVertices;
     BufferID bufferIndices;
+    BufferID bufferMeshlets;
     ObjectID vertexPuller;
     ProgramID program;
+    std::vector<MeshLod> lods;      ///< levels of detail in index buffer, the first one is the full bunny
+    BoundingSphere boundingSphere;  ///< bounding sphere of bunny used for selection of level of detail
+    uint32_t selectedLod = 0;       ///< level of detail of the last draw
+    bool depthPrepass = false;      ///< depth is drawn first, the shading pass then shades only visible pixels
+    bool visibilityBuffer = false;  ///< bunny is drawn into visibility buffer and shaded by its resolve
 
-    PhongMethod();
+    explicit PhongMethod(bool faceCulling = false, bool depthPrepass = false, bool visibilityBuffer = false);
     ~PhongMethod() override;
     void onDraw(glm::mat4 const&proj,glm::mat4 const&view,glm::vec3 const&light,glm::vec3 const&camera) override;
 };
+void phong_FS(OutFragment &outFragment, InFragment const &inFragment, Uniforms const &uniforms);
 /**
  * @brief Same as glm::dot, but trunc dot product into <0.0, 1.0> interval
  */
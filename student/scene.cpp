@@ -0,0 +1,298 @@
+/*!
+ * @file
+ * @brief This file contains implementation of scene of many objects.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <student/scene.hpp>
+
+/**
+ * @brief Vertex shader of bounding boxes, corner of box is selected by bits of gl_VertexID.
+ *
+ * @param outVertex output vertex
+ * @param inVertex input vertex
+ * @param uniforms uniform variables, 0 projection * view * model, 1 minimal and 2 maximal corner of box
+ */
+static void sceneBox_VS(OutVertex &outVertex, InVertex const &inVertex, Uniforms const &uniforms){
+    uint32_t const id = inVertex.gl_VertexID;
+    glm::vec3 const corner((float) (id & 1u), (float) ((id >> 1) & 1u), (float) ((id >> 2) & 1u));
+    glm::vec3 const position = uniforms.uniform[1].v3 + corner * (uniforms.uniform[2].v3 - uniforms.uniform[1].v3);
+    outVertex.gl_Position = uniforms.uniform[0].m4 * glm::vec4(position, 1.f);
+}
+
+/**
+ * @brief Fragment shader of bounding boxes, color is not written.
+ */
+static void sceneBox_FS(OutFragment &outFragment, InFragment const &, Uniforms const &){
+    outFragment.gl_FragColor = glm::vec4(1.f);
+}
+
+/// corners of triangles of unit cube, corner index has bits (x, y, z)
+static uint32_t const boxIndices[36] = {
+    0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+    0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+    0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5,
+};
+
+/**
+ * @brief Adds mesh.
+ *
+ * @param mesh mesh with at least one level of detail
+ *
+ * @return index of mesh
+ */
+uint32_t Scene::addMesh(SceneMesh const &mesh){
+    if (mesh.lods.empty())
+        throw std::range_error("Mesh of scene has no index range.");
+    meshes.push_back(mesh);
+    return (uint32_t) meshes.size() - 1;
+}
+
+/**
+ * @brief Adds material.
+ *
+ * @param material material with program
+ *
+ * @return index of material
+ */
+uint32_t Scene::addMaterial(SceneMaterial const &material){
+    if (material.program == emptyID or material.modelUniform >= maxUniforms)
+        throw std::range_error("Material of scene needs program and model uniform.");
+    materials.push_back(material);
+    return (uint32_t) materials.size() - 1;
+}
+
+/**
+ * @brief Adds object, indices of removed objects are reused.
+ *
+ * @param transform model matrix
+ * @param mesh index of mesh
+ * @param material index of material
+ *
+ * @return index of object
+ */
+uint32_t Scene::addObject(glm::mat4 const &transform, uint32_t mesh, uint32_t material){
+    if (mesh >= meshes.size() or material >= materials.size())
+        throw std::range_error("Mesh or material of object does not exist.");
+    uint32_t object = (uint32_t) objects.size();
+    if (freeObjects.empty())
+        objects.emplace_back();
+    else{
+        object = freeObjects.back();
+        freeObjects.pop_back();
+    }
+    SceneObject &o = objects[object];
+    o.transform = transform;
+    o.mesh = mesh;
+    o.material = material;
+    o.leaf = bvh.insert(transformAabb(meshes[mesh].box, transform), object);
+    return object;
+}
+
+/**
+ * @brief Removes object.
+ *
+ * @param object index of object
+ */
+void Scene::removeObject(uint32_t object){
+    if (object >= objects.size() or objects[object].leaf == emptyID)
+        throw std::range_error("Object does not exist.");
+    bvh.remove(objects[object].leaf);
+    objects[object].leaf = emptyID;
+    freeObjects.push_back(object);
+}
+
+/**
+ * @brief Moves object, the hierarchy changes only if the object leaves its fattened box.
+ *
+ * @param object index of object
+ * @param transform new model matrix
+ */
+void Scene::setObjectTransform(uint32_t object, glm::mat4 const &transform){
+    if (object >= objects.size() or objects[object].leaf == emptyID)
+        throw std::range_error("Object does not exist.");
+    SceneObject &o = objects[object];
+    o.transform = transform;
+    nofReinserted += bvh.update(o.leaf, transformAabb(meshes[o.mesh].box, transform));
+}
+
+/**
+ * @brief Finds objects in frustum and sorts them by program and from front to back.
+ *
+ * @param proj projection matrix
+ * @param view view matrix
+ * @param viewportHeight height of viewport in pixels, it is used for selection of level of detail
+ *
+ * @return draw list
+ */
+std::vector<SceneDraw> const &Scene::buildDrawList(glm::mat4 const &proj, glm::mat4 const &view, uint32_t viewportHeight){
+    glm::vec4 planes[5];
+    frustumPlanes(planes, proj * view);
+    visible.clear();
+    statistics.nodesVisited = bvh.cullFrustum(planes, 5, visible);
+
+    drawList.resize(visible.size());
+    for (size_t i = 0; i < visible.size(); i++){
+        SceneObject const &o = objects[visible[i]];
+        SceneMesh const &mesh = meshes[o.mesh];
+        glm::mat4 const modelView = view * o.transform;
+        glm::vec3 const center = (mesh.box.min + mesh.box.max) * .5f;
+        // objects behind center of camera have zero depth, nonnegative floats compare as their bits
+        float const depth = std::max(-(modelView * glm::vec4(center, 1.f)).z, 0.f);
+        uint32_t depthBits;
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        SceneDraw &draw = drawList[i];
+        draw.key = (uint64_t) materials[o.material].program << 32 | depthBits;
+        draw.object = visible[i];
+        draw.lod = selectLod(mesh.lods, mesh.sphere, modelView, proj, viewportHeight);
+    }
+    std::sort(drawList.begin(), drawList.end(), [](SceneDraw const &a, SceneDraw const &b){ return a.key < b.key; });
+    statistics.objectsVisible = (uint32_t) drawList.size();
+    return drawList;
+}
+
+/**
+ * @brief Draws visible objects.
+ * Uniforms of materials that do not depend on objects have to be set before, program and vertex puller
+ * are changed only between draws that use different ones, the last vertex puller stays bound.
+ *
+ * @param gpu GPU that owns programs and vertex pullers of scene
+ * @param proj projection matrix
+ * @param view view matrix
+ */
+void Scene::draw(GPU &gpu, glm::mat4 const &proj, glm::mat4 const &view){
+    statistics = SceneStatistics{};
+    statistics.leavesReinserted = nofReinserted;
+    nofReinserted = 0;
+    buildDrawList(proj, view, gpu.getFramebufferHeight());
+
+    glm::mat4 const viewProjection = proj * view;
+    ProgramID program = emptyID;
+    VertexPullerID vertexPuller = emptyID;
+    for (auto const &draw : drawList){
+        SceneObject const &o = objects[draw.object];
+        SceneMaterial const &material = materials[o.material];
+        SceneMesh const &mesh = meshes[o.mesh];
+        bool const conditional = occlusion.enabled and testOcclusion(gpu, o, viewProjection);
+        if (conditional){
+            // box test binds its own program and vertex puller
+            program = vertexPuller = emptyID;
+            statistics.objectsOccluded += gpu.getQueryResult(occlusion.query) == 0;
+        }
+        if (material.program != program){
+            program = material.program;
+            gpu.useProgram(program);
+            statistics.programChanges++;
+        }
+        if (mesh.vertexPuller != vertexPuller){
+            vertexPuller = mesh.vertexPuller;
+            gpu.bindVertexPuller(vertexPuller);
+            statistics.vertexPullerBinds++;
+        }
+        gpu.programUniformMatrix4f(program, material.modelUniform, o.transform);
+        if (material.colorUniform != emptyID)
+            gpu.programUniform4f(program, material.colorUniform, material.color);
+        MeshLod const &lod = mesh.lods[draw.lod];
+        if (conditional)
+            gpu.beginConditionalRender(occlusion.query);
+        gpu.drawTrianglesRange(lod.firstIndex, lod.nofIndices);
+        if (conditional)
+            gpu.endConditionalRender();
+    }
+    statistics.nofObjects = bvh.getNofLeaves();
+    statistics.treeHeight = bvh.getHeight();
+}
+
+/**
+ * @brief Creates resources of occlusion culling.
+ *
+ * @param gpu GPU that draws scene
+ */
+void Scene::enableOcclusionCulling(GPU &gpu){
+    if (occlusion.enabled)
+        return;
+    occlusion.boxIndices = gpu.createBuffer(sizeof(boxIndices));
+    gpu.setBufferData(occlusion.boxIndices, 0, sizeof(boxIndices), boxIndices);
+    occlusion.boxPuller = gpu.createVertexPuller();
+    gpu.setVertexPullerIndexing(occlusion.boxPuller, IndexType::UINT32, occlusion.boxIndices);
+    occlusion.boxProgram = gpu.createProgram();
+    gpu.attachShaders(occlusion.boxProgram, sceneBox_VS, sceneBox_FS);
+    occlusion.query = gpu.createQuery();
+    occlusion.enabled = true;
+}
+
+/**
+ * @brief Deletes resources of occlusion culling.
+ *
+ * @param gpu GPU given to enableOcclusionCulling
+ */
+void Scene::disableOcclusionCulling(GPU &gpu){
+    if (not occlusion.enabled)
+        return;
+    gpu.deleteQuery(occlusion.query);
+    gpu.deleteProgram(occlusion.boxProgram);
+    gpu.deleteVertexPuller(occlusion.boxPuller);
+    gpu.deleteBuffer(occlusion.boxIndices);
+    occlusion = OcclusionCulling{};
+}
+
+/**
+ * @brief Draws bounding box of object inside of ANY_SAMPLES_PASSED query without writes into framebuffer.
+ * Boxes that reach in front of near plane are not tested, their clipped faces could hide visible parts of object.
+ *
+ * @param gpu GPU that draws scene
+ * @param object tested object
+ * @param viewProjection projection * view matrix
+ *
+ * @return true if occlusion query holds the result of object
+ */
+bool Scene::testOcclusion(GPU &gpu, SceneObject const &object, glm::mat4 const &viewProjection){
+    Aabb const &box = meshes[object.mesh].box;
+    glm::mat4 const transform = viewProjection * object.transform;
+    for (uint32_t id = 0; id < 8; id++){
+        glm::vec3 const corner(id & 1u ? box.max[0] : box.min[0], id & 2u ? box.max[1] : box.min[1], id & 4u ? box.max[2] : box.min[2]);
+        glm::vec4 const clip = transform * glm::vec4(corner, 1.f);
+        if (clip[2] < -clip[3])
+            return false;
+    }
+    statistics.objectsTested++;
+    // state of the caller (e.g. depth prepass without color writes) is restored after the test
+    bool const faceCulling = gpu.faceCulling;
+    bool const colorWrites = gpu.colorWrites;
+    bool const depthWrites = gpu.depthWrites;
+    gpu.disableFaceCulling();
+    gpu.colorMask(false);
+    gpu.depthMask(false);
+    gpu.useProgram(occlusion.boxProgram);
+    gpu.bindVertexPuller(occlusion.boxPuller);
+    gpu.programUniformMatrix4f(occlusion.boxProgram, 0, transform);
+    gpu.programUniform3f(occlusion.boxProgram, 1, box.min);
+    gpu.programUniform3f(occlusion.boxProgram, 2, box.max);
+    gpu.beginQuery(QueryType::ANY_SAMPLES_PASSED, occlusion.query);
+    gpu.drawTriangles(36);
+    gpu.endQuery(QueryType::ANY_SAMPLES_PASSED);
+    gpu.colorMask(colorWrites);
+    gpu.depthMask(depthWrites);
+    if (faceCulling)
+        gpu.enableFaceCulling();
+    return true;
+}
+
+/**
+ * @brief Returns object.
+ *
+ * @param object index of object
+ */
+SceneObject const &Scene::getObject(uint32_t object) const{
+    return objects.at(object);
+}
+
+/**
+ * @brief Returns statistics of the last draw, reinserted leaves are counted since the previous draw.
+ */
+SceneStatistics Scene::getStatistics() const{
+    return statistics;
+}
@@ -0,0 +1,117 @@
+/*!
+ * @file
+ * @brief This file contains scene of many objects that are culled by bounding volume hierarchy and drawn by GPU.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <student/gpu.hpp>
+#include <student/dynamicBvh.hpp>
+#include <student/meshSimplifier.hpp>
+
+/**
+ * @brief Mesh of scene, it is a range of index buffer of vertex puller, optionally with levels of detail.
+ */
+struct SceneMesh {
+    VertexPullerID       vertexPuller = emptyID; ///< vertex puller with indexing
+    std::vector<MeshLod> lods;                   ///< ranges of index buffer, the first one is the full mesh
+    Aabb                 box;                    ///< bounding box in object space
+    BoundingSphere       sphere;                 ///< bounding sphere in object space used for selection of level of detail
+};
+
+/**
+ * @brief Material of scene, it is a program with uniforms that are set per object.
+ * Uniforms that are the same for all objects (view, projection, light) are set by the user.
+ */
+struct SceneMaterial {
+    ProgramID program      = emptyID;         ///< shader program
+    uint32_t  modelUniform = emptyID;         ///< uniform that receives model matrix of object
+    uint32_t  colorUniform = emptyID;         ///< uniform that receives color, emptyID if it is not used
+    glm::vec4 color        = glm::vec4(1.f);  ///< color of material
+};
+
+/**
+ * @brief Object of scene.
+ */
+struct SceneObject {
+    glm::mat4 transform = glm::mat4(1.f); ///< model matrix
+    uint32_t  mesh      = emptyID;        ///< index of mesh
+    uint32_t  material  = emptyID;        ///< index of material
+    uint32_t  leaf      = emptyID;        ///< leaf in bounding volume hierarchy, emptyID for removed objects
+};
+
+/**
+ * @brief Draw of one visible object.
+ */
+struct SceneDraw {
+    uint64_t key    = 0;  ///< sort key, program in high bits and view depth in low bits
+    uint32_t object = 0;  ///< index of object
+    uint32_t lod    = 0;  ///< selected level of detail of mesh
+};
+
+/**
+ * @brief Statistics of the last frame of scene.
+ */
+struct SceneStatistics {
+    uint32_t nofObjects        = 0; ///< objects in scene
+    uint32_t nodesVisited      = 0; ///< nodes of hierarchy visited by frustum traversal
+    uint32_t objectsVisible    = 0; ///< objects that were drawn
+    uint32_t programChanges    = 0; ///< useProgram calls
+    uint32_t vertexPullerBinds = 0; ///< bindVertexPuller calls
+    uint32_t leavesReinserted  = 0; ///< objects that left their fattened boxes since the last frame
+    uint32_t treeHeight        = 0; ///< height of hierarchy
+    uint32_t objectsTested     = 0; ///< objects whose bounding boxes were drawn with occlusion query
+    uint32_t objectsOccluded   = 0; ///< objects skipped because no fragment of their bounding box passed depth test
+};
+
+/**
+ * @brief Container of objects with transforms, meshes and materials.
+ * Objects are kept in dynamic bounding volume hierarchy, frustum traversal produces draw list
+ * sorted by program and from front to back, the list is drawn by GPU draws of mesh ranges.
+ * With occlusion culling, bounding box of each object is drawn first without writes into framebuffer
+ * and the object is drawn with conditional rendering on its occlusion query.
+ */
+class Scene {
+    public:
+        uint32_t addMesh         (SceneMesh const &mesh);
+        uint32_t addMaterial     (SceneMaterial const &material);
+        uint32_t addObject       (glm::mat4 const &transform, uint32_t mesh, uint32_t material);
+        void     removeObject    (uint32_t object);
+        void     setObjectTransform(uint32_t object, glm::mat4 const &transform);
+
+        std::vector<SceneDraw> const &buildDrawList(glm::mat4 const &proj, glm::mat4 const &view, uint32_t viewportHeight);
+        void     draw            (GPU &gpu, glm::mat4 const &proj, glm::mat4 const &view);
+
+        void     enableOcclusionCulling (GPU &gpu);
+        void     disableOcclusionCulling(GPU &gpu);
+
+        SceneObject const &getObject(uint32_t object) const;
+        SceneStatistics getStatistics() const;
+
+    private:
+        std::vector<SceneMesh>     meshes;
+        std::vector<SceneMaterial> materials;
+        std::vector<SceneObject>   objects;
+        std::vector<uint32_t>      freeObjects;  ///< indices of removed objects that are reused
+        std::vector<uint32_t>      visible;      ///< objects found by the last traversal
+        std::vector<SceneDraw>     drawList;     ///< draws of the last frame
+        DynamicBvh                 bvh;
+        SceneStatistics            statistics;
+        uint32_t                   nofReinserted = 0; ///< leaves reinserted since the last draw
+
+        bool testOcclusion(GPU &gpu, SceneObject const &object, glm::mat4 const &viewProjection);
+
+        /**
+         * @brief Resources of occlusion culling, they belong to GPU given to enableOcclusionCulling.
+         */
+        struct OcclusionCulling {
+            bool           enabled      = false;
+            BufferID       boxIndices   = emptyID; ///< indices of triangles of unit cube
+            VertexPullerID boxPuller    = emptyID; ///< vertex puller without heads, corners come from gl_VertexID
+            ProgramID      boxProgram   = emptyID; ///< program that draws box given by uniforms
+            QueryID        query        = emptyID; ///< ANY_SAMPLES_PASSED query of the last tested object
+        } occlusion;
+};
@@ -0,0 +1,174 @@
+/*!
+ * @file
+ * @brief This file contains implementation of rendering method of scene with many bunnies
+ */
+
+#include <cmath>
+#include <iterator>
+
+#include <student/sceneMethod.hpp>
+#include <student/phongMethod.hpp>
+#include <student/bunny.hpp>
+#include <student/meshOptimizer.hpp>
+
+uint32_t const animationPeriod = 8; ///< every animationPeriod-th object moves
+
+/**
+ * @brief Scene vertex shader, it applies model matrix (rotation and uniform scale) to position and normal.
+ *
+ * @param outVertex output vertex
+ * @param inVertex input vertex
+ * @param uniforms uniform variables, 0 view, 1 projection, 4 model matrix
+ */
+void scene_VS(OutVertex &outVertex, InVertex const &inVertex, Uniforms const &uniforms){
+    auto const &view  = uniforms.uniform[0].m4;
+    auto const &proj  = uniforms.uniform[1].m4;
+    auto const &model = uniforms.uniform[4].m4;
+    glm::vec4 const position = model * glm::vec4(inVertex.attributes[0].v3, 1.f);
+    outVertex.gl_Position = proj * view * position;
+    outVertex.attributes[0].v3 = glm::vec3(position);
+    outVertex.attributes[1].v3 = glm::vec3(model * glm::vec4(inVertex.attributes[1].v3, 0.f));
+}
+
+/**
+ * @brief Scene fragment shader, diffuse lighting of color of material.
+ *
+ * @param outFragment output fragment
+ * @param inFragment input fragment
+ * @param uniforms uniform variables, 2 light position, 5 color of material
+ */
+void sceneColor_FS(OutFragment &outFragment, InFragment const &inFragment, Uniforms const &uniforms){
+    glm::vec3 const lightVec = glm::normalize(uniforms.uniform[2].v3 - inFragment.attributes[0].v3);
+    glm::vec3 const normalVec = glm::normalize(inFragment.attributes[1].v3);
+    glm::vec4 const color = uniforms.uniform[5].v4;
+    float const diffuse = .2f + .8f * dotVec3(normalVec, lightVec);
+    outFragment.gl_FragColor = glm::vec4(glm::vec3(color) * diffuse, color[3]);
+}
+
+/**
+ * @brief Constructor, bunnies are placed into square grid under the camera.
+ *
+ * @param occlusionCulling true if bunnies hidden behind closer ones are skipped by occlusion queries
+ * @param nofObjects number of bunnies
+ * @param visibilityBuffer true if only the nearest triangle of each pixel is shaded by resolve of visibility buffer
+ */
+SceneMethod::SceneMethod(bool occlusionCulling, uint32_t nofObjects, bool visibilityBuffer): visibilityBuffer(visibilityBuffer){
+    std::vector<BunnyVertex> vertices(std::begin(bunnyVertices), std::end(bunnyVertices));
+    std::vector<VertexIndex> indices(&bunnyIndices[0][0], &bunnyIndices[0][0] + sizeof(bunnyIndices) / sizeof(VertexIndex));
+    uint32_t nofVertices = (uint32_t) vertices.size();
+    VertexStreamView const stream = {(uint8_t *) vertices.data(), sizeof(BunnyVertex)};
+    optimizeMesh(indices.data(), (uint32_t) indices.size(), nofVertices, &stream, 1);
+
+    SceneMesh mesh;
+    mesh.lods = buildLodChain(indices, stream, nofVertices);
+    mesh.sphere = computeBoundingSphere(stream, nofVertices);
+    mesh.box = Aabb{glm::vec3(vertices[0].position[0], vertices[0].position[1], vertices[0].position[2]), glm::vec3(0.f)};
+    mesh.box.max = mesh.box.min;
+    for (uint32_t v = 0; v < nofVertices; v++){
+        glm::vec3 const position(vertices[v].position[0], vertices[v].position[1], vertices[v].position[2]);
+        mesh.box.min = glm::min(mesh.box.min, position);
+        mesh.box.max = glm::max(mesh.box.max, position);
+    }
+
+    bufferVertices = gpu.createBuffer(nofVertices * sizeof(BunnyVertex));
+    gpu.setBufferData(bufferVertices, 0, nofVertices * sizeof(BunnyVertex), vertices.data());
+    bufferIndices = gpu.createBuffer(indices.size() * sizeof(VertexIndex));
+    gpu.setBufferData(bufferIndices, 0, indices.size() * sizeof(VertexIndex), indices.data());
+    vertexPuller = gpu.createVertexPuller();
+    gpu.setVertexPullerHead(vertexPuller, 0, AttributeType::VEC3, sizeof(BunnyVertex), 0, bufferVertices);
+    gpu.setVertexPullerHead(vertexPuller, 1, AttributeType::VEC3, sizeof(BunnyVertex), 3 * sizeof(float), bufferVertices);
+    gpu.setVertexPullerIndexing(vertexPuller, IndexType::UINT32, bufferIndices);
+    gpu.enableVertexPullerHead(vertexPuller, 0);
+    gpu.enableVertexPullerHead(vertexPuller, 1);
+    mesh.vertexPuller = vertexPuller;
+    uint32_t const bunny = scene.addMesh(mesh);
+
+    FragmentShader const fragmentShaders[2] = {phong_FS, sceneColor_FS};
+    uint32_t materials[2];
+    for (uint32_t p = 0; p < 2; p++){
+        programs[p] = gpu.createProgram();
+        gpu.attachShaders(programs[p], scene_VS, fragmentShaders[p]);
+        gpu.setVS2FSType(programs[p], 0, AttributeType::VEC3);
+        gpu.setVS2FSType(programs[p], 1, AttributeType::VEC3);
+        SceneMaterial material;
+        material.program = programs[p];
+        material.modelUniform = 4;
+        if (p == 1){
+            material.colorUniform = 5;
+            material.color = glm::vec4(.8f, .3f, .2f, 1.f);
+        }
+        materials[p] = scene.addMaterial(material);
+    }
+
+    // grid of bunnies below the orbit camera, materials alternate in checkerboard pattern
+    auto const side = (uint32_t) std::ceil(std::sqrt((float) nofObjects));
+    float const spacing = 2.f;
+    float const scale = .5f;
+    baseTransforms.resize(nofObjects);
+    for (uint32_t o = 0; o < nofObjects; o++){
+        uint32_t const x = o % side, z = o / side;
+        glm::mat4 transform(scale);
+        transform[3] = glm::vec4(((float) x - .5f * (float) (side - 1)) * spacing, -4.f,
+                                 ((float) z - .5f * (float) (side - 1)) * spacing, 1.f);
+        baseTransforms[o] = transform;
+        scene.addObject(transform, bunny, materials[(x + z) % 2]);
+    }
+    if (occlusionCulling)
+        scene.enableOcclusionCulling(gpu);
+}
+
+/**
+ * @brief Moves every animationPeriod-th bunny up and down and rotates it.
+ *
+ * @param dt elapsed time
+ */
+void SceneMethod::onUpdate(float dt){
+    time += dt;
+    for (uint32_t o = 0; o < baseTransforms.size(); o += animationPeriod){
+        float const phase = time + (float) o * .1f;
+        glm::mat4 rotation(1.f);
+        rotation[0][0] = std::cos(phase);
+        rotation[0][2] = -std::sin(phase);
+        rotation[2][0] = std::sin(phase);
+        rotation[2][2] = std::cos(phase);
+        glm::mat4 transform = baseTransforms[o] * rotation;
+        transform[3][1] += .3f * std::sin(phase);
+        scene.setObjectTransform(o, transform);
+    }
+}
+
+/**
+ * @brief Draws visible bunnies.
+ *
+ * @param proj projection matrix
+ * @param view view matrix
+ * @param light light position
+ * @param camera camera position
+ */
+void SceneMethod::onDraw(glm::mat4 const &proj, glm::mat4 const &view, glm::vec3 const &light, glm::vec3 const &camera){
+    gpu.clear(.502f, .502f, .502f, 1.f);
+    for (auto const program : programs){
+        gpu.programUniformMatrix4f(program, 0, view);
+        gpu.programUniformMatrix4f(program, 1, proj);
+        gpu.programUniform3f(program, 2, light);
+        gpu.programUniform3f(program, 3, camera);
+    }
+    if (visibilityBuffer)
+        gpu.beginVisibilityBuffer();
+    scene.draw(gpu, proj, view);
+    if (visibilityBuffer)
+        gpu.resolveVisibilityBuffer();
+    gpu.unbindVertexPuller();
+}
+
+/**
+ * @brief Destructor.
+ */
+SceneMethod::~SceneMethod(){
+    scene.disableOcclusionCulling(gpu);
+    gpu.deleteBuffer(bufferVertices);
+    gpu.deleteBuffer(bufferIndices);
+    gpu.deleteVertexPuller(vertexPuller);
+    for (auto const program : programs)
+        gpu.deleteProgram(program);
+}
@@ -0,0 +1,31 @@
+/*!
+ * @file
+ * @brief This file contains rendering method of scene with many bunnies
+ */
+
+#pragma once
+
+#include <student/method.hpp>
+#include <student/scene.hpp>
+
+/**
+ * @brief This class draws grid of bunnies with two materials, some of them move.
+ * Bunnies share one vertex puller with levels of detail, scene culls them by its hierarchy.
+ */
+class SceneMethod: public Method{
+  public:
+    explicit SceneMethod(bool occlusionCulling = false, uint32_t nofObjects = 10000, bool visibilityBuffer = false);
+    ~SceneMethod() override;
+    void onDraw(glm::mat4 const&proj,glm::mat4 const&view,glm::vec3 const&light,glm::vec3 const&camera) override;
+    void onUpdate(float dt) override;
+    BufferID bufferVertices;     ///< vertices of bunny
+    BufferID bufferIndices;      ///< indices of all levels of detail of bunny
+    VertexPullerID vertexPuller; ///< vertex puller of bunny
+    ProgramID programs[2];       ///< phong program and program with color of material
+    Scene scene;                 ///< objects of scene
+    std::vector<glm::mat4> baseTransforms; ///< transforms of objects without animation
+    float time = 0.f;            ///< elapsed time
+    bool visibilityBuffer = false; ///< bunnies are drawn into visibility buffer and shaded by its resolve
+};
+void scene_VS(OutVertex &outVertex, InVertex const &inVertex, Uniforms const &uniforms);
+void sceneColor_FS(OutFragment &outFragment, InFragment const &inFragment, Uniforms const &uniforms);
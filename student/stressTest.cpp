@@ -0,0 +1,322 @@
+/*!
+ * @file
+ * @brief This file contains implementation of stress test of GPU objects shared by several threads.
+ *
+ * One thread draws frames, it uploads its vertex buffer asynchronously every frame, measures the draw by occlusion queries,
+ * renders conditionally and deletes its query while the query is active.
+ * Other threads at the same time create, upload, read back and delete buffers, create, wait for and delete syncs,
+ * create and delete queries, vertex pullers and programs, read results of queries of the drawing thread and delete its syncs.
+ * One of them also replaces the shared vertex puller and program that the drawing thread binds every frame,
+ * so they are deleted right before or during its draws.
+ * Every upload is read back and compared, the number of samples of every frame has to be the same.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <student/gpu.hpp>
+#include <student/stressTest.hpp>
+
+namespace {
+
+uint32_t const framebufferSize = 64;  ///< resolution of framebuffer of the drawing thread
+uint32_t const maxUploadSize = 4096;  ///< maximal size of buffer of uploading thread in bytes
+
+/**
+ * @brief State shared by threads of stress test.
+ */
+struct StressState {
+    GPU gpu;
+    std::atomic<uint32_t> failures{0};
+    std::atomic<QueryID> drawQuery{emptyID}; ///< query of the drawing thread, uploaders read its result
+    std::atomic<SyncID> drawSync{emptyID};   ///< fence of the drawing thread, uploaders delete some of them
+    std::atomic<BufferID> drawVertices{emptyID};       ///< vertex buffer of the drawing thread
+    std::atomic<VertexPullerID> sharedPuller{emptyID}; ///< vertex puller replaced by uploader, the drawing thread binds it
+    std::atomic<ProgramID> sharedProgram{emptyID};     ///< program replaced by uploader, the drawing thread uses it
+    std::atomic<uint32_t> sharedDraws{0};              ///< draws with the shared vertex puller and program that were not rejected
+    std::mutex outputMutex;
+};
+
+/**
+ * @brief Reports failure of stress test.
+ * @param state shared state
+ * @param message description of failure
+ */
+void fail(StressState &state, std::string const &message){
+    std::lock_guard<std::mutex> lock(state.outputMutex);
+    if (state.failures.fetch_add(1) < 10)
+        std::cerr << "stress test: " << message << std::endl;
+}
+
+/**
+ * @brief Vertex shader of the drawing thread, it passes 2D position.
+ *
+ * @param outVertex output vertex
+ * @param inVertex input vertex
+ * @param uniforms uniform variables
+ */
+void stress_VS(OutVertex &outVertex, InVertex const &inVertex, Uniforms const &){
+    outVertex.gl_Position = glm::vec4(inVertex.attributes[0].v2, 0.f, 1.f);
+}
+
+/**
+ * @brief Fragment shader of the drawing thread.
+ *
+ * @param outFragment output fragment
+ * @param inFragment input fragment
+ * @param uniforms uniform variables
+ */
+void stress_FS(OutFragment &outFragment, InFragment const &, Uniforms const &){
+    outFragment.gl_FragColor = glm::vec4(1.f);
+}
+
+/**
+ * @brief Creates vertex puller that reads the quad of the drawing thread and program with stress shaders.
+ * @param gpu GPU
+ * @param vertices vertex buffer of the drawing thread
+ * @param vao created vertex puller
+ * @param prg created program
+ */
+void createQuadObjects(GPU &gpu, BufferID vertices, VertexPullerID &vao, ProgramID &prg){
+    vao = gpu.createVertexPuller();
+    gpu.setVertexPullerHead(vao, 0, AttributeType::VEC2, sizeof(glm::vec2), 0, vertices);
+    gpu.enableVertexPullerHead(vao, 0);
+    prg = gpu.createProgram();
+    gpu.attachShaders(prg, stress_VS, stress_FS);
+}
+
+/**
+ * @brief Draws the quad with the shared vertex puller and program that uploader may delete at any time.
+ * Draw either passes all samples or it is rejected because the objects were deleted before it looked them up.
+ * @param state shared state
+ * @param query query of the drawing thread
+ * @param frame index of frame
+ * @param expectedSamples number of samples of the quad, 0 if it is not known yet
+ */
+void drawShared(StressState &state, QueryID query, uint32_t frame, uint64_t expectedSamples){
+    GPU &gpu = state.gpu;
+    gpu.unbindVertexPuller();
+    gpu.bindVertexPuller(state.sharedPuller.load());
+    gpu.useProgram(state.sharedProgram.load());
+    gpu.clear(0.f, 0.f, 0.f, 1.f);
+    gpu.beginQuery(QueryType::SAMPLES_PASSED, query);
+    bool drawn = true;
+    try{
+        gpu.drawTriangles(6);
+    }
+    catch (std::range_error const &){
+        drawn = false;
+    }
+    gpu.endQuery(QueryType::SAMPLES_PASSED);
+    uint64_t const samples = gpu.getQueryResult(query);
+    if (drawn)
+        state.sharedDraws++;
+    if (drawn and expectedSamples != 0 and samples != expectedSamples)
+        fail(state, "frame " + std::to_string(frame) + " passed " + std::to_string(samples) +
+                    " samples with shared objects instead of " + std::to_string(expectedSamples));
+    if (not drawn and samples != 0)
+        fail(state, "rejected draw of frame " + std::to_string(frame) + " passed samples");
+}
+
+/**
+ * @brief Body of the drawing thread.
+ * @param state shared state
+ * @param settings settings of stress test
+ */
+void drawFrames(StressState &state, StressTestSettings const &settings){
+    GPU &gpu = state.gpu;
+    gpu.createFramebuffer(framebufferSize, framebufferSize);
+    BufferID const vertices = gpu.createBuffer(6 * sizeof(glm::vec2));
+    VertexPullerID vao;
+    ProgramID prg;
+    createQuadObjects(gpu, vertices, vao, prg);
+    state.drawVertices.store(vertices);
+    QueryID anyQuery = gpu.createQuery();
+
+    uint64_t expectedSamples = 0;
+    for (uint32_t frame = 0; frame < settings.frames; frame++){
+        // the quad covers the whole framebuffer, the draw has to wait for this upload
+        std::vector<uint8_t> quad(6 * sizeof(glm::vec2));
+        glm::vec2 const positions[6] = {{-1.f, -1.f}, {1.f, -1.f}, {-1.f, 1.f}, {-1.f, 1.f}, {1.f, -1.f}, {1.f, 1.f}};
+        std::copy((uint8_t const *) positions, (uint8_t const *) positions + quad.size(), quad.begin());
+        gpu.setBufferDataAsync(vertices, 0, std::move(quad));
+
+        QueryID const query = gpu.createQuery();
+        state.drawQuery.store(query);
+        gpu.bindVertexPuller(vao);
+        gpu.useProgram(prg);
+        gpu.clear(0.f, 0.f, 0.f, 1.f);
+        gpu.beginQuery(QueryType::SAMPLES_PASSED, query);
+        gpu.drawTriangles(6);
+        // deleted query stays alive until it is ended
+        if (frame % 7 == 0)
+            gpu.deleteQuery(query);
+        gpu.endQuery(QueryType::SAMPLES_PASSED);
+        if (frame % 7 != 0){
+            uint64_t const samples = gpu.getQueryResult(query);
+            if (frame == 1)
+                expectedSamples = samples;
+            if (samples == 0 or samples != expectedSamples)
+                fail(state, "frame " + std::to_string(frame) + " passed " + std::to_string(samples) +
+                            " samples instead of " + std::to_string(expectedSamples));
+        }
+
+        gpu.clear(0.f, 0.f, 0.f, 1.f);
+        gpu.beginQuery(QueryType::ANY_SAMPLES_PASSED, anyQuery);
+        gpu.drawTriangles(6);
+        gpu.endQuery(QueryType::ANY_SAMPLES_PASSED);
+        if (gpu.getQueryResult(anyQuery) != 1)
+            fail(state, "frame " + std::to_string(frame) + " did not pass any sample");
+        gpu.clear(0.f, 0.f, 0.f, 1.f);
+        gpu.beginConditionalRender(anyQuery);
+        if (frame % 5 == 0){
+            gpu.deleteQuery(anyQuery);
+            anyQuery = gpu.createQuery();
+        }
+        gpu.drawTriangles(6);
+        gpu.endConditionalRender();
+        if (gpu.getFramebufferColor()[0] == 0)
+            fail(state, "frame " + std::to_string(frame) + " skipped conditional draw");
+        drawShared(state, anyQuery, frame, expectedSamples);
+        gpu.unbindVertexPuller();
+
+        // uploaders may delete the fence while this thread waits for it
+        SyncID const sync = gpu.fenceSync();
+        state.drawSync.store(sync);
+        SyncStatus const status = gpu.clientWaitSync(sync, timeoutIgnored);
+        if (status == SyncStatus::TIMEOUT_EXPIRED)
+            fail(state, "fence of frame " + std::to_string(frame) + " expired without timeout");
+        gpu.deleteSync(sync);
+        if (frame % 7 != 0)
+            gpu.deleteQuery(query);
+    }
+    state.drawQuery.store(emptyID);
+    state.drawVertices.store(emptyID);
+    gpu.deleteQuery(anyQuery);
+    gpu.deleteProgram(prg);
+    gpu.deleteVertexPuller(vao);
+    gpu.deleteBuffer(vertices);
+}
+
+/**
+ * @brief Body of one uploading thread.
+ * @param state shared state
+ * @param settings settings of stress test
+ * @param thread index of thread
+ */
+void uploadBuffers(StressState &state, StressTestSettings const &settings, uint32_t thread){
+    GPU &gpu = state.gpu;
+    std::vector<uint8_t> readBack;
+    for (uint32_t i = 0; i < settings.iterations; i++){
+        uint32_t const size = 1 + (thread * 7919 + i * 104729) % maxUploadSize;
+        std::vector<uint8_t> data(size);
+        for (uint32_t b = 0; b < size; b++)
+            data[b] = (uint8_t) (thread * 31 + i * 17 + b);
+        BufferID const buffer = gpu.createBuffer(size);
+        uint32_t const half = size / 2;
+        gpu.setBufferDataAsync(buffer, 0, half, data.data());
+        gpu.setBufferDataAsync(buffer, half, std::vector<uint8_t>(data.begin() + half, data.end()));
+
+        SyncID const sync = gpu.fenceSync();
+        if (not gpu.isSync(sync))
+            fail(state, "new sync does not exist");
+        SyncStatus const status = gpu.clientWaitSync(sync, i % 3 == 0 ? 0 : timeoutIgnored);
+        if (status == SyncStatus::WAIT_FAILED or (i % 3 != 0 and status == SyncStatus::TIMEOUT_EXPIRED))
+            fail(state, "wait for sync failed");
+        gpu.deleteSync(sync);
+        if (gpu.isSync(sync) or gpu.clientWaitSync(sync, 0) != SyncStatus::WAIT_FAILED)
+            fail(state, "deleted sync exists");
+
+        readBack.assign(size, 0);
+        gpu.getBufferData(buffer, 0, size, readBack.data());
+        if (readBack != data)
+            fail(state, "thread " + std::to_string(thread) + " read back different data in iteration " + std::to_string(i));
+        gpu.deleteBuffer(buffer);
+
+        QueryID const query = gpu.createQuery();
+        if (not gpu.isQuery(query) or gpu.getQueryResult(query) != 0)
+            fail(state, "new query is not empty");
+        gpu.deleteQuery(query);
+        if (gpu.isQuery(query))
+            fail(state, "deleted query exists");
+
+        VertexPullerID vao;
+        ProgramID prg;
+        createQuadObjects(gpu, buffer, vao, prg);
+        gpu.setVertexPullerIndexing(vao, IndexType::UINT16, buffer);
+        gpu.programUniform1f(prg, 0, (float) i);
+        if (not gpu.isVertexPuller(vao) or not gpu.isProgram(prg))
+            fail(state, "new vertex puller or program does not exist");
+        gpu.deleteVertexPuller(vao);
+        gpu.deleteProgram(prg);
+        if (gpu.isVertexPuller(vao) or gpu.isProgram(prg))
+            fail(state, "deleted vertex puller or program exists");
+
+        // objects of the drawing thread
+        QueryID const drawQuery = state.drawQuery.load();
+        if (drawQuery != emptyID and gpu.getQueryResult(drawQuery) > (uint64_t) framebufferSize * framebufferSize * 2)
+            fail(state, "result of query of the drawing thread is out of range");
+        SyncID const drawSync = state.drawSync.load();
+        if (drawSync != emptyID and thread == 0 and i % 11 == 0)
+            gpu.deleteSync(drawSync);
+        else if (drawSync != emptyID)
+            gpu.clientWaitSync(drawSync, 0);
+        // new shared objects are complete before they are published, the drawing thread may still draw the old ones
+        BufferID const drawVertices = state.drawVertices.load();
+        if (drawVertices != emptyID and thread == 1 % settings.uploaders and i % 3 == 0){
+            VertexPullerID sharedPuller;
+            ProgramID sharedProgram;
+            createQuadObjects(gpu, drawVertices, sharedPuller, sharedProgram);
+            gpu.deleteVertexPuller(state.sharedPuller.exchange(sharedPuller));
+            gpu.deleteProgram(state.sharedProgram.exchange(sharedProgram));
+        }
+    }
+}
+
+/**
+ * @brief Runs thread body and reports its exceptions as failures.
+ * @param state shared state
+ * @param body thread body
+ */
+template<typename BODY>
+void guarded(StressState &state, BODY const &body){
+    try{
+        body();
+    }
+    catch (std::exception const &error){
+        fail(state, std::string("exception: ") + error.what());
+    }
+}
+
+}
+
+/**
+ * @brief Runs the drawing thread next to uploading threads on one GPU and checks results.
+ * @param settings settings of stress test
+ * @return EXIT_SUCCESS if no check failed
+ */
+int runStressTest(StressTestSettings const &settings){
+    StressState state;
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < settings.uploaders; t++)
+        threads.emplace_back([&state, &settings, t](){ guarded(state, [&](){ uploadBuffers(state, settings, t); }); });
+    guarded(state, [&](){ drawFrames(state, settings); });
+    for (auto &thread : threads)
+        thread.join();
+    state.gpu.deleteVertexPuller(state.sharedPuller.load());
+    state.gpu.deleteProgram(state.sharedProgram.load());
+    if (settings.frames != 0 and settings.uploaders != 0 and state.sharedDraws.load() == 0)
+        fail(state, "no draw with shared vertex puller and program passed");
+
+    uint32_t const failures = state.failures.load();
+    std::cout << "stress test: " << settings.uploaders << " uploading threads x " << settings.iterations << " iterations, "
+              << settings.frames << " frames (" << state.sharedDraws.load() << " with shared objects), "
+              << failures << " failures" << std::endl;
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
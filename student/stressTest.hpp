@@ -0,0 +1,19 @@
+/*!
+ * @file
+ * @brief This file contains stress test of GPU objects shared by several threads.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Settings of stress test.
+ */
+struct StressTestSettings {
+    uint32_t uploaders = 8;      ///< number of threads that upload buffers and create syncs, queries, vertex pullers and programs
+    uint32_t iterations = 2000;  ///< number of iterations of each uploading thread
+    uint32_t frames = 500;       ///< number of frames of the drawing thread
+};
+
+int runStressTest(StressTestSettings const &settings);
@@ -0,0 +1,269 @@
+/*!
+ * @file
+ * @brief This file contains implementation of trace instrumentation layer.
+ */
+
+#include <student/trace.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+namespace {
+
+/**
+ * @brief Registry of trace buffers of all threads that have ever recorded an event.
+ */
+struct TraceRegistry {
+    std::mutex mutex; ///< guards buffers, it is locked only when a thread records its first event and during export
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    std::atomic<bool> enabled{true};
+    std::chrono::steady_clock::time_point const epoch = std::chrono::steady_clock::now();
+};
+
+TraceRegistry &registry(){
+    static TraceRegistry traceRegistry;
+    return traceRegistry;
+}
+
+/**
+ * @brief Writes string into JSON, escaping quotes and backslashes.
+ * @param stream output stream
+ * @param string string to write
+ */
+void writeJsonString(std::ostream &stream, char const *string){
+    stream << '"';
+    for (char const *c = string != nullptr ? string : ""; *c != 0; c++){
+        if (*c == '"' or *c == '\\')
+            stream << '\\';
+        stream << *c;
+    }
+    stream << '"';
+}
+
+/**
+ * @brief Writes nanoseconds as microseconds, which is the unit of Chrome trace timestamps.
+ * @param stream output stream
+ * @param nanoseconds time in nanoseconds
+ */
+void writeMicroseconds(std::ostream &stream, uint64_t nanoseconds){
+    stream << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000 << std::setfill(' ');
+}
+
+}
+
+/**
+ * @brief Constructor of trace buffer
+ * @param threadId id of the thread that owns the buffer
+ * @param capacity maximal number of stored events
+ */
+TraceBuffer::TraceBuffer(uint32_t threadId, uint64_t capacity):threadId(threadId), events(capacity){}
+
+/**
+ * @brief Stores event into the buffer, it is called only by the owning thread.
+ * @param event event to store
+ */
+void TraceBuffer::push(TraceEvent const &event){
+    uint64_t position = head.load(std::memory_order_relaxed);
+    events[position % events.size()] = event;
+    head.store(position + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Copies stored events, it can be called from any thread.
+ * Events overwritten by the owning thread during copying are dropped, together with the oldest event
+ * of a full buffer because the owning thread may be writing its slot.
+ * @return events ordered from the oldest one
+ */
+std::vector<TraceEvent> TraceBuffer::snapshot() const {
+    uint64_t const capacity = events.size();
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = std::max(tail.load(std::memory_order_acquire), end > capacity ? end - capacity : 0);
+    std::vector<TraceEvent> result;
+    result.reserve(end - begin);
+    for (uint64_t i = begin; i < end; i++)
+        result.push_back(events[i % capacity]);
+
+    // the owning thread may be writing slot of event newEnd, which is the slot of event newEnd - capacity
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t newEnd = head.load(std::memory_order_relaxed);
+    uint64_t firstValid = newEnd + 1 > capacity ? newEnd + 1 - capacity : 0;
+    if (firstValid > begin)
+        result.erase(result.begin(), result.begin() + std::min<uint64_t>(firstValid - begin, result.size()));
+    return result;
+}
+
+/**
+ * @brief Drops all events stored so far.
+ */
+void TraceBuffer::clear(){
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+/**
+ * @brief Returns current time.
+ * @return nanoseconds elapsed from the trace epoch
+ */
+uint64_t Trace::now(){
+    auto const elapsed = std::chrono::steady_clock::now() - registry().epoch;
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+/**
+ * @brief Returns trace buffer of calling thread, the buffer is created by the first call.
+ * @return trace buffer of calling thread
+ */
+TraceBuffer &Trace::threadBuffer(){
+    thread_local std::shared_ptr<TraceBuffer> buffer;
+    if (!buffer){
+        auto &traceRegistry = registry();
+        std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+        buffer = std::make_shared<TraceBuffer>((uint32_t) traceRegistry.buffers.size(), bufferCapacity);
+        traceRegistry.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+/**
+ * @brief Records complete event.
+ * @param name name of the event (string literal)
+ * @param category category of the event (string literal)
+ * @param start start of the event (Trace::now)
+ * @param end end of the event (Trace::now)
+ * @param draw draw id or emptyID
+ * @param tile tile id or emptyID
+ */
+void Trace::complete(char const *name, char const *category, uint64_t start, uint64_t end, uint32_t draw, uint32_t tile){
+    if (not isEnabled())
+        return;
+    TraceEvent event;
+    event.name = name;
+    event.category = category;
+    event.start = start;
+    event.duration = end > start ? end - start : 0;
+    event.draw = draw;
+    event.tile = tile;
+    event.type = TraceEventType::COMPLETE;
+    threadBuffer().push(event);
+}
+
+/**
+ * @brief Records sample of counter.
+ * @param name name of the counter (string literal)
+ * @param value value of the counter
+ * @param draw draw id or emptyID
+ * @param tile tile id or emptyID
+ */
+void Trace::counter(char const *name, int64_t value, uint32_t draw, uint32_t tile){
+    if (not isEnabled())
+        return;
+    TraceEvent event;
+    event.name = name;
+    event.category = "counter";
+    event.start = now();
+    event.value = value;
+    event.draw = draw;
+    event.tile = tile;
+    event.type = TraceEventType::COUNTER;
+    threadBuffer().push(event);
+}
+
+/**
+ * @brief Enables or disables recording of events.
+ * @param enabled true if events should be recorded
+ */
+void Trace::setEnabled(bool enabled){
+    registry().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Tests if events are recorded.
+ * @return true if events are recorded
+ */
+bool Trace::isEnabled(){
+    return registry().enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Drops events of all threads.
+ */
+void Trace::clear(){
+    auto &traceRegistry = registry();
+    std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+    for (auto &buffer : traceRegistry.buffers)
+        buffer->clear();
+}
+
+/**
+ * @brief Writes events of all threads in Chrome trace-event JSON format.
+ * @param stream output stream
+ */
+void Trace::writeChromeTrace(std::ostream &stream){
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    {
+        auto &traceRegistry = registry();
+        std::lock_guard<std::mutex> lock(traceRegistry.mutex);
+        buffers = traceRegistry.buffers;
+    }
+
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (auto const &buffer : buffers){
+        stream << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+               << ",\"args\":{\"name\":\"thread " << buffer->threadId << "\"}}";
+        first = false;
+        for (auto const &event : buffer->snapshot()){
+            stream << ",\n{\"name\":";
+            writeJsonString(stream, event.name);
+            stream << ",\"cat\":";
+            writeJsonString(stream, event.category);
+            stream << ",\"pid\":1,\"tid\":" << buffer->threadId << ",\"ts\":";
+            writeMicroseconds(stream, event.start);
+            if (event.type == TraceEventType::COMPLETE){
+                stream << ",\"ph\":\"X\",\"dur\":";
+                writeMicroseconds(stream, event.duration);
+                stream << ",\"args\":{";
+                if (event.draw != emptyID)
+                    stream << "\"draw\":" << event.draw;
+                if (event.tile != emptyID)
+                    stream << (event.draw != emptyID ? "," : "") << "\"tile\":" << event.tile;
+                stream << "}}";
+            }
+            else
+                stream << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+        }
+    }
+    stream << "\n]}" << std::endl;
+}
+
+/**
+ * @brief Writes events of all threads into file in Chrome trace-event JSON format.
+ * The file can be opened in chrome://tracing or https://ui.perfetto.dev
+ * @param fileName name of the file
+ * @return true if the file was written
+ */
+bool Trace::dumpChromeTrace(std::string const &fileName){
+    std::ofstream file(fileName);
+    if (not file.is_open())
+        return false;
+    writeChromeTrace(file);
+    return file.good();
+}
+
+/**
+ * @brief Starts the scoped event.
+ * @param name name of the event (string literal)
+ * @param category category of the event (string literal)
+ * @param draw draw id or emptyID
+ * @param tile tile id or emptyID
+ */
+TraceScope::TraceScope(char const *name, char const *category, uint32_t draw, uint32_t tile):
+    name(name), category(category), draw(draw), tile(tile), start(Trace::now()){}
+
+/**
+ * @brief Ends the scoped event and records it.
+ */
+TraceScope::~TraceScope(){
+    Trace::complete(name, category, start, Trace::now(), draw, tile);
+}
@@ -0,0 +1,106 @@
+/*!
+ * @file
+ * @brief This file contains instrumentation layer that records scoped events and counters
+ * into per-thread ring buffers and exports them as Chrome trace-event JSON (viewable in Perfetto).
+ */
+
+#pragma once
+
+#include <student/fwd.hpp>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief This enum represents type of trace event.
+ */
+enum class TraceEventType : uint8_t {
+    COMPLETE = 0, ///< event with start and duration ("X" in Chrome trace)
+    COUNTER  = 1, ///< counter sample ("C" in Chrome trace)
+};
+
+/**
+ * @brief This struct represents one recorded event.
+ * Name and category have to be string literals, only pointers are stored.
+ */
+struct TraceEvent {
+    char const *   name     = nullptr;                  ///< name of the event
+    char const *   category = nullptr;                  ///< category of the event
+    uint64_t       start    = 0;                        ///< start in nanoseconds from the trace epoch
+    uint64_t       duration = 0;                        ///< duration in nanoseconds
+    int64_t        value    = 0;                        ///< value of counter
+    uint32_t       draw     = emptyID;                  ///< draw id or emptyID
+    uint32_t       tile     = emptyID;                  ///< tile id or emptyID
+    TraceEventType type     = TraceEventType::COMPLETE; ///< type of the event
+};
+
+/**
+ * @brief Ring buffer of events of one thread.
+ * Only the owning thread writes into it, readers never block the writer.
+ * When the buffer is full the oldest events are overwritten.
+ */
+class TraceBuffer {
+    public:
+        TraceBuffer(uint32_t threadId, uint64_t capacity);
+        void push(TraceEvent const &event);
+        std::vector<TraceEvent> snapshot() const;
+        void clear();
+        uint32_t threadId;
+    private:
+        std::vector<TraceEvent> events;
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> tail{0};
+};
+
+/**
+ * @brief This class holds trace buffers of all threads and exports them.
+ */
+class Trace {
+    public:
+        static constexpr uint64_t bufferCapacity = 1 << 16; ///< number of events per thread
+
+        static uint64_t now();
+        static TraceBuffer &threadBuffer();
+        static void complete(char const *name, char const *category, uint64_t start, uint64_t end,
+                             uint32_t draw = emptyID, uint32_t tile = emptyID);
+        static void counter(char const *name, int64_t value, uint32_t draw = emptyID, uint32_t tile = emptyID);
+        static void setEnabled(bool enabled);
+        static bool isEnabled();
+        static void clear();
+        static void writeChromeTrace(std::ostream &stream);
+        static bool dumpChromeTrace(std::string const &fileName);
+};
+
+/**
+ * @brief Records complete event spanning lifetime of this object.
+ */
+class TraceScope {
+    public:
+        TraceScope(char const *name, char const *category, uint32_t draw = emptyID, uint32_t tile = emptyID);
+        ~TraceScope();
+    private:
+        char const * name;
+        char const * category;
+        uint32_t draw;
+        uint32_t tile;
+        uint64_t start;
+};
+
+#define TRACE_CONCATENATE_(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_(a, b)
+
+#ifdef ENABLE_TRACING
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCATENATE(traceScope, __LINE__)(name, category)
+#define TRACE_DRAW_SCOPE(name, category, draw) TraceScope TRACE_CONCATENATE(traceScope, __LINE__)(name, category, draw)
+#define TRACE_COMPLETE(name, category, start, end, draw) Trace::complete(name, category, start, end, draw)
+#define TRACE_COUNTER(name, value, draw) Trace::counter(name, value, draw)
+#define TRACE_NOW() Trace::now()
+#else
+#define TRACE_SCOPE(name, category) ((void)0)
+#define TRACE_DRAW_SCOPE(name, category, draw) ((void)0)
+#define TRACE_COMPLETE(name, category, start, end, draw) ((void)0)
+#define TRACE_COUNTER(name, value, draw) ((void)0)
+#define TRACE_NOW() uint64_t(0)
+#endif
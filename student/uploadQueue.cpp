@@ -0,0 +1,111 @@
+/*!
+ * @file
+ * @brief This file contains implementation of queue of asynchronous buffer uploads.
+ */
+
+#include <student/uploadQueue.hpp>
+#include <chrono>
+#include <cstring>
+
+/**
+ * @brief Destructor, it finishes all pushed uploads and stops the worker thread.
+ */
+UploadQueue::~UploadQueue(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    queued.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+/**
+ * @brief Pushes upload of data that the caller may reuse after the function returns.
+ * @param owner object that owns the destination memory, it is released after the upload
+ * @param destination memory that will be written
+ * @param data data to upload, they are copied before the function returns
+ * @param size size of data in bytes
+ * @return sequence number of the upload
+ */
+uint64_t UploadQueue::push(std::shared_ptr<void> owner, void *destination, void const *data, uint64_t size){
+    return push(std::move(owner), destination, std::vector<uint8_t>((uint8_t const *) data, (uint8_t const *) data + size));
+}
+
+/**
+ * @brief Pushes upload that takes ownership of data, the worker thread is started by the first upload.
+ * Data are not copied until the worker writes them into destination.
+ * @param owner object that owns the destination memory, it is released after the upload
+ * @param destination memory that will be written
+ * @param data data to upload, they are released after the upload
+ * @return sequence number of the upload
+ */
+uint64_t UploadQueue::push(std::shared_ptr<void> owner, void *destination, std::vector<uint8_t> &&data){
+    Upload upload{std::move(owner), destination, std::move(data), 0};
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (not worker.joinable())
+            worker = std::thread(&UploadQueue::run, this);
+        sequence = upload.sequence = ++queuedSequence;
+        uploads.push_back(std::move(upload));
+    }
+    queued.notify_one();
+    return sequence;
+}
+
+/**
+ * @brief Returns sequence number of the last pushed upload.
+ * @return sequence number, 0 if nothing was pushed
+ */
+uint64_t UploadQueue::lastQueued() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queuedSequence;
+}
+
+/**
+ * @brief Tests if upload and all older uploads are complete.
+ * @param sequence sequence number of upload
+ * @return true if the upload is complete
+ */
+bool UploadQueue::isComplete(uint64_t sequence) const {
+    return completedSequence.load(std::memory_order_acquire) >= sequence;
+}
+
+/**
+ * @brief Waits for completion of upload.
+ * @param sequence sequence number of upload
+ * @param timeout maximal waiting time in nanoseconds (2^62 and more waits forever)
+ * @return true if the upload is complete
+ */
+bool UploadQueue::wait(uint64_t sequence, uint64_t timeout){
+    if (isComplete(sequence))
+        return true;
+    std::unique_lock<std::mutex> lock(mutex);
+    // timeouts longer than a century would overflow the clock of wait_for
+    if (timeout >= (uint64_t) 1 << 62){
+        finished.wait(lock, [&](){ return isComplete(sequence); });
+        return true;
+    }
+    return finished.wait_for(lock, std::chrono::nanoseconds(timeout), [&](){ return isComplete(sequence); });
+}
+
+/**
+ * @brief Body of the worker thread.
+ */
+void UploadQueue::run(){
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;){
+        queued.wait(lock, [&](){ return stop or not uploads.empty(); });
+        if (uploads.empty())
+            return;
+        Upload upload = std::move(uploads.front());
+        uploads.pop_front();
+        lock.unlock();
+        memcpy(upload.destination, upload.data.data(), upload.data.size());
+        upload.owner.reset();
+        lock.lock();
+        completedSequence.store(upload.sequence, std::memory_order_release);
+        finished.notify_all();
+    }
+}
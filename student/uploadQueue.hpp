@@ -0,0 +1,56 @@
+/*!
+ * @file
+ * @brief This file contains queue of asynchronous buffer uploads.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Queue of buffer uploads processed by a background thread.
+ * Uploads are completed in the order in which they were pushed,
+ * so one sequence number describes completion of all older uploads.
+ */
+class UploadQueue {
+    public:
+        UploadQueue() = default;
+        UploadQueue(UploadQueue const &) = delete;
+        UploadQueue &operator=(UploadQueue const &) = delete;
+        ~UploadQueue();
+
+        uint64_t push(std::shared_ptr<void> owner, void *destination, void const *data, uint64_t size);
+        uint64_t push(std::shared_ptr<void> owner, void *destination, std::vector<uint8_t> &&data);
+        uint64_t lastQueued() const;
+        bool isComplete(uint64_t sequence) const;
+        bool wait(uint64_t sequence, uint64_t timeout);
+
+    private:
+        void run();
+
+        /**
+         * @brief One upload, it owns its data until the worker writes them.
+         */
+        struct Upload {
+            std::shared_ptr<void> owner; ///< keeps the destination alive until the upload is complete
+            void *destination;
+            std::vector<uint8_t> data;
+            uint64_t sequence;
+        };
+
+        mutable std::mutex mutex;
+        std::condition_variable queued;   ///< signals new upload or stop to the worker
+        std::condition_variable finished; ///< signals completed upload to waiting threads
+        std::deque<Upload> uploads;
+        uint64_t queuedSequence = 0;      ///< sequence number of the last pushed upload
+        std::atomic<uint64_t> completedSequence{0}; ///< sequence number of the last completed upload
+        bool stop = false;
+        std::thread worker;
+};